@@ -0,0 +1,102 @@
+#include "autoplayer.h"
+
+#include <math.h>
+
+// NOTE(leo): Keep the ball off the very ends of the paddle, where being a little late misses it
+#define AUTOPLAYER_MIN_HIT 0.15f
+#define AUTOPLAYER_MAX_HIT 0.85f
+
+// NOTE(leo): Bottom middle of the lowest brick left in the column with the most bricks left. Levels can put bricks
+// anywhere, so bricks go into BRICK_COUNT_X columns across the arena by their center
+internal
+V2 autoplayer_target(GameState *game_state)
+{
+  F32 column_width = ARENA_WIDTH/BRICK_COUNT_X;
+  int counts[BRICK_COUNT_X] = { 0 };
+  int lowest_indices[BRICK_COUNT_X];
+  Level *level = &game_state->level;
+  for(int brick_index = 0; brick_index < level->brick_count; brick_index++) {
+    if(!game_state->brick_hps[brick_index])
+      continue;
+    Rect brick = level->brick_rects[brick_index];
+    int column = (int)((brick.pos.x + brick.dim.x/2.0f)/column_width);
+    if(column > BRICK_COUNT_X - 1)
+      column = BRICK_COUNT_X - 1;
+    if(!counts[column] || brick.pos.y < level->brick_rects[lowest_indices[column]].pos.y)
+      lowest_indices[column] = brick_index;
+    counts[column]++;
+  }
+
+  int best_column = -1;
+  for(int column = 0; column < BRICK_COUNT_X; column++) {
+    if(counts[column] && (best_column < 0 || counts[column] > counts[best_column]))
+      best_column = column;
+  }
+  if(best_column < 0)
+    return (V2){ (BRICK_COUNT_X/2 + 0.5f)*column_width, FIRST_BRICK_HEIGHT };
+  Rect brick = level->brick_rects[lowest_indices[best_column]];
+  return (V2){ brick.pos.x + brick.dim.x/2.0f, brick.pos.y };
+}
+
+F32 autoplayer_paddle_control(GameState *game_state)
+{
+  Rect paddle = game_state->paddle;
+
+  // NOTE(leo): Earliest ball to come down
+  BallPrediction prediction = { .is_valid = false };
+  for(int ball_index = 0; ball_index < game_state->ball_count; ball_index++) {
+    BallPrediction ball_prediction = predict_ball_at_paddle(game_state, ball_index);
+    if(ball_prediction.is_valid && (!prediction.is_valid || ball_prediction.time < prediction.time))
+      prediction = ball_prediction;
+  }
+
+  F32 ball_x;
+  F32 hit_normalized = 0.5f;
+  if(prediction.is_valid) {
+    ball_x = prediction.pos.x + BALL_WIDTH/2.0f;
+
+    // NOTE(leo): Inverse of the paddle bounce in simulate_ball: angle = h*45 degs + (1-h)*135 degs
+    F32 PI = 3.14159f;
+    V2 target = autoplayer_target(game_state);
+    F32 height = target.y - (PADDLE_Y + PADDLE_HEIGTH);
+
+    // NOTE(leo): Targets too far to the side are reached off a side wall, which is the same as aiming at the target
+    // mirrored in the wall (the ball center bounces half a ball away from it)
+    F32 target_xs[3] = { target.x, BALL_WIDTH - target.x, 2.0f*ARENA_WIDTH - BALL_WIDTH - target.x };
+    bool is_reachable = false;
+    for(int i = 0; i < 3 && !is_reachable; i++) {
+      F32 angle = atan2f(height, target_xs[i] - ball_x);
+      hit_normalized = (3.0f*PI/4.0f - angle)/(PI/2.0f);
+      is_reachable = hit_normalized >= AUTOPLAYER_MIN_HIT && hit_normalized <= AUTOPLAYER_MAX_HIT;
+    }
+
+    // NOTE(leo): Can't get there from here. Bounce off somewhere else each time (golden ratio sequence over the hit
+    // count), so the ball doesn't settle into a loop and comes down somewhere new
+    if(!is_reachable) {
+      F32 t = (F32)game_state->hit_count*0.618034f;
+      t -= floorf(t);
+      hit_normalized = AUTOPLAYER_MIN_HIT + t*(AUTOPLAYER_MAX_HIT - AUTOPLAYER_MIN_HIT);
+    }
+  }
+  else {
+    // NOTE(leo): Nothing coming down, stay under the first ball
+    ball_x = game_state->balls[0].rect.pos.x + BALL_WIDTH/2.0f;
+  }
+
+  // NOTE(leo): The bounce takes the middle of the part of the ball over the paddle, so towards the ends of the paddle
+  // the ball has to be further out than the hit point
+  F32 hit_x = hit_normalized*paddle.dim.x;
+  F32 half = BALL_WIDTH/2.0f;
+  F32 ball_offset = hit_x;
+  if(ball_offset - half < 0.0f)
+    ball_offset = 2.0f*hit_x - half;
+  else if(ball_offset + half > paddle.dim.x)
+    ball_offset = 2.0f*hit_x + half - paddle.dim.x;
+  F32 paddle_x = ball_x - ball_offset;
+  F32 result = paddle_x/(ARENA_WIDTH - paddle.dim.x);
+  if(result < 0.0f)
+    result = 0.0f;
+  if(result > 1.0f)
+    result = 1.0f;
+  return result;
+}
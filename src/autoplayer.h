@@ -0,0 +1,13 @@
+#pragma once
+
+#include "breakout.h"
+
+/*
+  Bot for headless games. Predicts where the ball comes down (predict_ball_at_paddle) and moves the paddle under it,
+  offset so the ball bounces off towards the column with the most bricks left.
+
+  With several balls it catches the one that arrives first. Doesn't care about power-ups.
+*/
+
+// NOTE(leo): For Input.paddle_control
+F32 autoplayer_paddle_control(GameState *game_state);
@@ -1,23 +1,15 @@
 #include "breakout.h"
 
 #include "util.h"
+#include "particles.h"
 #include "symbol_grids.h"
 
+#include <intrin.h>
 #include <math.h>
 #include <time.h>
 #include <string.h>
 #include <stdlib.h>
-
-internal
-void draw_rectangle(Rect rect, Color color, RenderCmdBuffer *cmd_buffer)
-{
-  assert(cmd_buffer->count < cmd_buffer->capacity);
-
-  cmd_buffer->commands[cmd_buffer->count++] = (RectangleCmd){
-    .rect = rect,
-    .color = color,
-  };
-}
+#include <stddef.h>
 
 internal
 void draw_rectangle_offset(Rect rect, V2 offset, Color color, RenderCmdBuffer *cmd_buffer)
@@ -34,13 +26,6 @@ bool point_inside_rect(V2 point, Rect rect)
       && (point.y <= rect.pos.y + rect.dim.y);
 }
 
-enum {
-  EDGE_LEFT = 1<<0,
-  EDGE_BOTTOM = 1<<1,
-  EDGE_RIGHT = 1<<2,
-  EDGE_TOP = 1<<3
-};
-
 typedef struct Impact {
   F32 time;
   U8 edges;
@@ -111,31 +96,158 @@ void reflect_ball(U8 edges, Rect *ball, V2 *ball_direction)
   }
 }
 
-void choose_random_ball_direction(V2 *ball_direction)
+// NOTE(leo): xorshift32 on GameState.random_state, so games on different threads don't share a sequence and a copy of
+// a GameState plays out the same way as the original
+internal
+U32 game_random(GameState *game_state)
+{
+  U32 x = game_state->random_state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  game_state->random_state = x;
+  return x;
+}
+
+// NOTE(leo): [0, 1)
+internal
+F32 game_random_unilateral(GameState *game_state)
 {
-  ball_direction->x = 1.5f* ((F32)rand()/RAND_MAX) - 1.5f/2.0f;
+  return (F32)(game_random(game_state) >> 8)*(1.0f/16777216.0f);
+}
+
+void choose_random_ball_direction(GameState *game_state, V2 *ball_direction)
+{
+  ball_direction->x = 1.5f*game_random_unilateral(game_state) - 1.5f/2.0f;
   ball_direction->y = sqrtf(1.0f - ball_direction->x*ball_direction->x);
 }
 
+internal
+void invalidate_static_layer(GameState *game_state)
+{
+  game_state->static_layer_version++;
+}
+
 void reset_bricks(GameState *game_state)
 {
-  for(int brick_index = 0; brick_index < BRICK_COUNT; brick_index++)
-    game_state->is_brick_broken[brick_index] = false;
-  game_state->bricks_remaining = BRICK_COUNT;
+  memcpy(game_state->brick_hps, game_state->level.brick_max_hps, game_state->level.brick_count*sizeof(U8));
+  game_state->bricks_remaining = game_state->level.brick_count;
+  invalidate_static_layer(game_state);
+}
+
+// NOTE(leo): Chunks whose top went below the floor free their slots, new chunks stream in on top until there's one
+// above the arena (or the slots run out). Going round the ring from the lowest chunk's slot, the bricks are sorted: the
+// resident chunks bottom up, then the free slots (see SCROLL_FREE_SLOT_Y)
+internal
+void stream_scroll_chunks(GameState *game_state)
+{
+  ScrollField *scroll = &game_state->scroll;
+  Level *level = &game_state->level;
+  while(scroll->first_chunk_index != scroll->next_chunk_index && scroll->first_chunk_y + SCROLL_CHUNK_HEIGHT < SCROLL_FLOOR_Y) {
+    int first_brick_index = (scroll->first_chunk_index%SCROLL_CHUNK_COUNT)*SCROLL_CHUNK_BRICK_COUNT;
+    for(int brick_index = first_brick_index; brick_index < first_brick_index + SCROLL_CHUNK_BRICK_COUNT; brick_index++) {
+      if(game_state->brick_hps[brick_index]) {
+        game_state->brick_hps[brick_index] = 0;
+        game_state->bricks_remaining--;
+      }
+      level->brick_rects[brick_index].pos.y = SCROLL_FREE_SLOT_Y;
+    }
+    scroll->first_chunk_index++;
+    scroll->first_chunk_y += SCROLL_CHUNK_HEIGHT;
+  }
+
+  F32 top_y = scroll->first_chunk_y + (scroll->next_chunk_index - scroll->first_chunk_index)*SCROLL_CHUNK_HEIGHT;
+  while(scroll->next_chunk_index - scroll->first_chunk_index < SCROLL_CHUNK_COUNT && top_y < ARENA_HEIGHT + SCROLL_CHUNK_HEIGHT) {
+    int slot_index = scroll->next_chunk_index%SCROLL_CHUNK_COUNT;
+    U32 brick_mask = level_generate_chunk(level, slot_index, scroll->seed, scroll->next_chunk_index, top_y);
+    int first_brick_index = slot_index*SCROLL_CHUNK_BRICK_COUNT;
+    for(int chunk_brick_index = 0; chunk_brick_index < SCROLL_CHUNK_BRICK_COUNT; chunk_brick_index++) {
+      bool is_there = (brick_mask >> chunk_brick_index) & 1;
+      game_state->brick_hps[first_brick_index + chunk_brick_index] = is_there ? level->brick_max_hps[first_brick_index + chunk_brick_index] : 0;
+      game_state->brick_alpha[first_brick_index + chunk_brick_index] = 1.0f;
+      game_state->bricks_remaining += is_there;
+    }
+    scroll->next_chunk_index++;
+    top_y += SCROLL_CHUNK_HEIGHT;
+  }
+
+  level->bounds = (Rect){
+    .pos = { BRICK_DELTA_X, scroll->first_chunk_y },
+    .dim = { ARENA_WIDTH - 2.0f*BRICK_DELTA_X, top_y - scroll->first_chunk_y },
+  };
+  level->sorted_split_index = (scroll->first_chunk_index%SCROLL_CHUNK_COUNT)*SCROLL_CHUNK_BRICK_COUNT;
+}
+
+internal
+void reset_scroll_field(GameState *game_state)
+{
+  ScrollField *scroll = &game_state->scroll;
+  Level *level = &game_state->level;
+  level->brick_count = MAX_BRICK_COUNT;
+  level->max_brick_height = BRICK_HEIGHT;
+  for(int brick_index = 0; brick_index < MAX_BRICK_COUNT; brick_index++) {
+    game_state->brick_hps[brick_index] = 0;
+    level->brick_rects[brick_index].pos.y = SCROLL_FREE_SLOT_Y;
+  }
+  game_state->bricks_remaining = 0;
+
+  // NOTE(leo): Starts out like a level, with room below the bricks
+  scroll->first_chunk_index = 0;
+  scroll->next_chunk_index = 0;
+  scroll->first_chunk_y = LEVEL_MIN_BRICK_Y;
+  stream_scroll_chunks(game_state);
+  invalidate_static_layer(game_state);
+}
+
+internal
+void scroll_field(GameState *game_state, F32 dt)
+{
+  ScrollField *scroll = &game_state->scroll;
+  F32 dy = scroll->speed*dt;
+  for(U32 chunk_index = scroll->first_chunk_index; chunk_index != scroll->next_chunk_index; chunk_index++) {
+    int first_brick_index = (chunk_index%SCROLL_CHUNK_COUNT)*SCROLL_CHUNK_BRICK_COUNT;
+    for(int brick_index = first_brick_index; brick_index < first_brick_index + SCROLL_CHUNK_BRICK_COUNT; brick_index++)
+      game_state->level.brick_rects[brick_index].pos.y -= dy;
+  }
+  scroll->first_chunk_y -= dy;
+  stream_scroll_chunks(game_state);
+}
+
+GameTuning default_game_tuning(void)
+{
+  GameTuning result = {
+    .paddle_width = PADDLE_WIDTH,
+    .ball_speeds = { BALL_SPEED_1, BALL_SPEED_2, BALL_SPEED_3, BALL_SPEED_4 },
+    .speed_up_hit_counts = { BALL_SPEED_2_HIT_COUNT, BALL_SPEED_3_HIT_COUNT },
+  };
+  return result;
+}
+
+internal
+F32 compute_paddle_width(GameState *game_state)
+{
+  return game_state->tuning.paddle_width/game_state->difficulty_factor;
 }
 
 void reset_ball(GameState *game_state)
 {
-  game_state->ball.pos = INITIAL_BALL_POS;
-  choose_random_ball_direction(&game_state->ball_direction);
-  game_state->ball_speed = 0.0f;
-  game_state->target_ball_speed = BALL_SPEED_1;
+  game_state->ball_count = 1;
+  Ball *ball = &game_state->balls[0];
+  ball->rect = (Rect){ .pos = INITIAL_BALL_POS, .dim = { BALL_WIDTH, BALL_HEIGHT } };
+  choose_random_ball_direction(game_state, &ball->direction);
+  ball->speed = 0.0f;
+  game_state->target_ball_speed = game_state->tuning.ball_speeds[0];
+
+  // NOTE(leo): Power-ups don't carry over into the next round
+  power_ups_clear(&game_state->power_ups);
+  game_state->slow_ball_time = 0.0f;
 }
 
 void reset_paddle(GameState *game_state)
 {
-  game_state->paddle.pos.x = INITIAL_PADDLE_POS(PADDLE_WIDTH(game_state->difficulty_factor));
-  game_state->paddle.dim.x = PADDLE_WIDTH(game_state->difficulty_factor);
+  game_state->paddle.pos.x = INITIAL_PADDLE_POS(compute_paddle_width(game_state));
+  game_state->paddle.dim.x = compute_paddle_width(game_state);
+  game_state->wide_paddle_time = 0.0f;
 }
 
 void game_serve(GameState *game_state)
@@ -144,12 +256,23 @@ void game_serve(GameState *game_state)
 
   reset_ball(game_state);
 
-  game_state->paddle.pos.x = INITIAL_PADDLE_POS(PADDLE_WIDTH(game_state->difficulty_factor));
-  game_state->paddle.dim.x = PADDLE_WIDTH(game_state->difficulty_factor);
+  game_state->paddle.pos.x = INITIAL_PADDLE_POS(compute_paddle_width(game_state));
+  game_state->paddle.dim.x = compute_paddle_width(game_state);
   game_state->is_paddle_shrunk = false;
+  game_state->wide_paddle_time = 0.0f;
 
   game_state->hit_count = 0;
   game_state->balls_remaining--;
+  invalidate_static_layer(game_state);
+}
+
+void game_state_copy(GameState *dest, GameState *source)
+{
+  memcpy(dest, source, offsetof(GameState, level));
+  dest->generated_levels = NULL;
+  level_copy(&dest->level, &source->level);
+  power_up_pool_copy(&dest->power_ups, &source->power_ups);
+  dest->events.write_index = source->events.write_index;
 }
 
 void change_paddle_width(GameState *game_state, F32 new_width)
@@ -159,47 +282,807 @@ void change_paddle_width(GameState *game_state, F32 new_width)
   game_state->paddle.dim.x = new_width;
 }
 
-Rect compute_brick_rect(int brick_index)
+bool select_level(GameState *game_state, int level_index)
 {
-  int x = brick_index%BRICK_COUNT_X;
-  int y = brick_index/BRICK_COUNT_X;
-  F32 xpos = BRICK_DELTA_X + (BRICK_WIDTH + BRICK_DELTA_X) * x;
-  F32 ypos = FIRST_BRICK_HEIGHT + (BRICK_HEIGHT + BRICK_DELTA_Y) * y;
-  Rect result = {
-    .pos = (V2){xpos, ypos},
-    .dim = (V2){BRICK_WIDTH, BRICK_HEIGHT}
-  };
-  return result;
+  LevelPack *pack = game_state->level_pack;
+  if(!pack || !pack->level_count)
+    level_index = 0;
+  else
+    level_index = (U32)level_index%pack->level_count;
+  if(game_state->level.brick_count && level_index == game_state->level_index)
+    return false;
+
+  game_state->level_index = level_index;
+  if(!pack || !level_pack_decode(pack, level_index, &game_state->level))
+    level_make_default(&game_state->level);
+  invalidate_static_layer(game_state);
+  return true;
 }
 
-U32 compute_brick_type(int brick_index)
-{
-  int y = brick_index/BRICK_COUNT_X;
-  U32 result = y/2;
-  return result;
-}
+global_variable Color power_up_colors[POWER_UP_TYPE_COUNT] = { BALL_COLOR, PADDLE_COLOR, (Color){ 0.55f, 0.3f, 0.85f, 1.0f } };
 
 void switch_to_reset_game(GameState *game_state, bool then_switch_to_main_menu, bool erase_score)
 {
-  for(int brick_index = 0; brick_index < BRICK_COUNT; brick_index++) {
-    if(game_state->is_brick_broken[brick_index])
-      game_state->brick_alpha[brick_index] = ((F32)rand() / RAND_MAX) * 0.5f;
+  // NOTE(leo): A new game starts over at the first level, the second set is the level after it (in endless mode the
+  // next generated one). A level that's new fades in completely
+  bool is_new_level;
+  if(game_state->scroll.speed > 0.0f) {
+    // NOTE(leo): Only a new game starts the field over, it never runs out of bricks
+    is_new_level = erase_score;
+    if(erase_score)
+      reset_scroll_field(game_state);
+  }
+  else if(game_state->is_endless && !erase_score) {
+    is_new_level = game_state->generated_levels && spsc_queue_pop(game_state->generated_levels, &game_state->level);
+    if(is_new_level) {
+      game_state->level_index = -1;
+      invalidate_static_layer(game_state);
+    }
+    else {
+      game_state->generated_level_miss_count++;
+    }
+  }
+  else {
+    int level_index = erase_score ? game_state->first_level_index : game_state->level_index + 1;
+    is_new_level = select_level(game_state, level_index);
+  }
+  for(int brick_index = 0; brick_index < game_state->level.brick_count; brick_index++) {
+    if(is_new_level || !game_state->brick_hps[brick_index])
+      game_state->brick_alpha[brick_index] = game_random_unilateral(game_state) * 0.5f;
     else
       game_state->brick_alpha[brick_index] = 1.0f;
   }
-  reset_bricks(game_state);
+  if(game_state->scroll.speed <= 0.0f)
+    reset_bricks(game_state);
 
   game_state->is_erasing_score = erase_score;
   game_state->is_switching_to_main_menu = then_switch_to_main_menu;
   game_state->state = GAME_STATE_RESET_GAME;
 }
 
-void game_update(GameState *game_state, F32 dt, Input *input, RenderCmdBuffer *cmd_buffer)
+internal
+void push_game_event(GameState *game_state, GameEvent event)
+{
+  GameEventRing *ring = &game_state->events;
+  *game_event_at(ring, ring->write_index) = event;
+  ring->write_index++;
+}
+
+// NOTE(leo): Box the ball sweeps moving by ball_delta, with a little margin
+internal
+Rect compute_sweep_box(Rect ball, V2 ball_delta)
+{
+  F32 margin = 0.01f;
+  V2 min = { fminf(ball.pos.x, ball.pos.x + ball_delta.x) - margin, fminf(ball.pos.y, ball.pos.y + ball_delta.y) - margin };
+  V2 max = {
+    fmaxf(ball.pos.x, ball.pos.x + ball_delta.x) + ball.dim.x + margin,
+    fmaxf(ball.pos.y, ball.pos.y + ball_delta.y) + ball.dim.y + margin,
+  };
+  return (Rect){ .pos = min, .dim = v2_sub(max, min) };
+}
+
+void sweep_brick_run(BrickHits *hits, Rect *brick_rects, U8 *brick_hps, int begin, int end, F32 max_brick_height,
+  Rect ball, V2 ball_delta)
+{
+  Rect box = compute_sweep_box(ball, ball_delta);
+  F32 min_x = box.pos.x;
+  F32 max_x = box.pos.x + box.dim.x;
+  F32 min_y = box.pos.y;
+  F32 max_y = box.pos.y + box.dim.y;
+
+  // NOTE(leo): First brick whose pos.y is at least min_y - max_brick_height, the ones before it end below the box
+  F32 first_y = min_y - max_brick_height;
+  int low = begin;
+  int high = end;
+  while(low < high) {
+    int middle = low + (high - low)/2;
+    if(brick_rects[middle].pos.y < first_y)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+
+  // NOTE(leo): Up to the first brick that starts above the box
+  for(int brick_index = low; brick_index < end && brick_rects[brick_index].pos.y <= max_y; brick_index++) {
+    if(!brick_hps[brick_index])
+      continue;
+    Rect brick = brick_rects[brick_index];
+    if(brick.pos.x > max_x || brick.pos.x + brick.dim.x < min_x || brick.pos.y + brick.dim.y < min_y)
+      continue;
+
+    Impact impact = compute_impact(ball, ball_delta, brick, (V2) { 0.0f, 0.0f });
+    if(impact.time < 1.0f && impact.time <= hits->time) {
+      if(impact.time < hits->time) {
+        hits->count = 0;
+        hits->time = impact.time;
+      }
+      // NOTE(leo): Overlapping bricks in a level could be hit more than 3 at once, the rest are hit next time
+      if(hits->count < 3) {
+        hits->indices[hits->count] = brick_index;
+        hits->edges[hits->count] = impact.edges;
+        hits->count++;
+      }
+    }
+  }
+}
+
+// NOTE(leo): Earliest impact of ball moving by ball_delta with bricks of level that aren't broken, up to 3 at once (eg:
+// hit corner). Nothing to sweep while the ball is away from the level's bounds (most of the time)
+internal
+BrickHits compute_brick_hits(Level *level, U8 *brick_hps, Rect ball, V2 ball_delta)
+{
+  BrickHits result = { .time = 1.0f, .indices = { -1, -1, -1 } };
+
+  Rect box = compute_sweep_box(ball, ball_delta);
+  Rect bounds = level->bounds;
+  if(bounds.pos.x > box.pos.x + box.dim.x || bounds.pos.x + bounds.dim.x < box.pos.x
+    || bounds.pos.y > box.pos.y + box.dim.y || bounds.pos.y + bounds.dim.y < box.pos.y)
+    return result;
+
+  // NOTE(leo): Runs in index order, so bricks hit at the same time come out the same as with a plain loop
+  int split_index = level->sorted_split_index;
+  sweep_brick_run(&result, level->brick_rects, brick_hps, 0, split_index, level->max_brick_height, ball, ball_delta);
+  sweep_brick_run(&result, level->brick_rects, brick_hps, split_index, level->brick_count, level->max_brick_height,
+    ball, ball_delta);
+  return result;
+}
+
+// NOTE(leo): Earliest impact of ball moving by ball_delta with the arena walls. edges has all walls hit at that time
+internal
+Impact compute_wall_impact(Rect ball, V2 ball_delta)
+{
+  Impact result = { .time = 1.0f, .edges = 0 };
+  Rect walls[4] = {
+    { .pos = {0.0f, 0.0f}, .dim = {0.0f, ARENA_HEIGHT} },
+    { .pos = {0.0f, 0.0f}, .dim = {ARENA_WIDTH, 0.0f} },
+    { .pos = {ARENA_WIDTH, 0.0f}, .dim = {0.0f, ARENA_HEIGHT} },
+    { .pos = {0.0f, ARENA_HEIGHT}, .dim = {ARENA_WIDTH, 0.0f} },
+  };
+  for(int i = 0; i < 4; i++) {
+    Impact impact = compute_impact(ball, ball_delta, walls[i], (V2) { 0.0f, 0.0f });
+    F32 t = impact.time;
+    if(t < 1.0f && t <= result.time) {
+      if(t < result.time) {
+        result.time = impact.time;
+        result.edges = 0;
+      }
+      result.edges |= impact.edges;
+    }
+  }
+
+  // NOTE(leo): Touching a wall and moving into it is a hit right away. A step can end exactly on a wall (a hit at the
+  // very end of it isn't one), the ball would go through it the next
+  U8 touched_edges = 0;
+  if(ball.pos.x <= 0.0f && ball_delta.x < 0.0f)
+    touched_edges |= EDGE_RIGHT;
+  if(ball.pos.x + ball.dim.x >= ARENA_WIDTH && ball_delta.x > 0.0f)
+    touched_edges |= EDGE_LEFT;
+  if(ball.pos.y <= 0.0f && ball_delta.y < 0.0f)
+    touched_edges |= EDGE_TOP;
+  if(ball.pos.y + ball.dim.y >= ARENA_HEIGHT && ball_delta.y > 0.0f)
+    touched_edges |= EDGE_BOTTOM;
+  if(touched_edges)
+    result = (Impact){ .time = 0.0f, .edges = touched_edges };
+  return result;
+}
+
+// NOTE(leo): Paddle x at time t into a physics step in which it moves with paddle_speed, stopping at the walls
+internal
+F32 compute_paddle_x(GameState *game_state, F32 start_x, F32 paddle_speed, F32 t)
+{
+  F32 x = start_x + paddle_speed*t;
+  if(x < 0.0f)
+    x = 0.0f;
+  else if(x > ARENA_WIDTH - game_state->paddle.dim.x)
+    x = ARENA_WIDTH - game_state->paddle.dim.x;
+  return x;
+}
+
+internal
+F32 compute_target_ball_speed(GameState *game_state)
+{
+  F32 result = game_state->target_ball_speed;
+  if(game_state->slow_ball_time > 0.0f)
+    result *= POWER_UP_SLOW_BALL_FACTOR;
+  return result;
+}
+
+enum {
+  BALL_STEP_DONE,
+  BALL_STEP_LOST, // NOTE(leo): Left the arena, but there are other balls
+  BALL_STEP_STOP, // NOTE(leo): Round over or no bricks left, nothing more to simulate
+};
+
+// NOTE(leo): Moves one ball by dt with continuous collision against bricks, walls and the paddle, which moves from
+// paddle_start_x with paddle_speed meanwhile
+internal
+int simulate_ball(GameState *game_state, Ball *ball, F32 dt, F32 paddle_start_x, F32 paddle_speed)
+{
+  Rect paddle = game_state->paddle;
+  paddle.pos.x = paddle_start_x;
+
+  F32 elapsed = 0.0f;
+  int iterations = 0;
+  while(elapsed < dt) {
+    iterations++;
+
+    F32 step = dt-elapsed;
+
+    V2 ball_delta = v2_smul(step*ball->speed, ball->direction);
+
+    // NOTE(leo): Compute time of impact with up to 3 bricks (eg: hit corner)
+    BrickHits brick_hits = compute_brick_hits(&game_state->level, game_state->brick_hps, ball->rect, ball_delta);
+    F32 toi_bricks = brick_hits.time;
+    int hit_brick_count = brick_hits.count;
+    int *hit_brick_indices = brick_hits.indices;
+    U8 *hit_brick_edges = brick_hits.edges;
+
+    // NOTE(leo): Compute toi for walls
+    Impact wall_impact = compute_wall_impact(ball->rect, ball_delta);
+    F32 toi_walls = wall_impact.time;
+    U8 hit_wall_edges = wall_impact.edges;
+
+    // NOTE(leo): Compute toi_paddle
+    F32 toi_paddle = 1.0f;
+    U8 hit_paddle_edges = 0;
+    {
+      V2 paddle_delta = { compute_paddle_x(game_state, paddle_start_x, paddle_speed, elapsed + step) - paddle.pos.x, 0.0f };
+      Impact impact = compute_impact(ball->rect, ball_delta, paddle, paddle_delta);
+      toi_paddle = impact.time;
+      hit_paddle_edges = impact.edges;
+    }
+
+    // NOTE(leo): choose smallest toi
+    F32 toi_min = 1.0f;
+    bool hit_bricks = false;
+    bool hit_walls = false;
+    bool hit_paddle = false;
+    if(toi_bricks < toi_min) {
+      hit_bricks = true;
+      toi_min = toi_bricks;
+    }
+    if(toi_walls < toi_min) {
+      // NOTE(leo): Impossible to hit bricks and walls at same time
+      hit_bricks = false;
+      hit_walls = true;
+      toi_min = toi_walls;
+    }
+    if(toi_paddle < 1.0f && toi_paddle <= toi_min) {
+      // NOTE(leo) Possible to hit wall and paddle at same time
+      if(toi_paddle < toi_min) {
+        hit_bricks = false;
+        hit_walls = false;
+      }
+      hit_paddle = true;
+      toi_min = toi_paddle;
+    }
+
+    step *= toi_min;
+
+
+    // NOTE(leo): integrate by step
+    ball->rect.pos = v2_add(ball->rect.pos, v2_smul(step*ball->speed, ball->direction));
+    paddle.pos.x = compute_paddle_x(game_state, paddle_start_x, paddle_speed, elapsed + step);
+
+
+    // NOTE(leo): Reflect off bricks
+    if(hit_bricks) {
+      U8 edges = 0;
+      for(int i = 0; i < hit_brick_count; i++)
+        edges |= hit_brick_edges[i];
+      reflect_ball(edges, &ball->rect, &ball->direction);
+    }
+
+    // NOTE(leo): Reflect off walls
+    if(hit_walls) {
+      reflect_ball(hit_wall_edges, &ball->rect, &ball->direction);
+    }
+
+    // NOTE(leo): "Reflect" off paddle
+    if(hit_paddle) {
+      if(hit_paddle_edges & EDGE_TOP) {
+        V2 left = ball->rect.pos;
+        V2 right = v2_add(ball->rect.pos, (V2) { ball->rect.dim.x, 0.0f });
+        if(left.x < paddle.pos.x)
+          left.x = paddle.pos.x;
+        if(right.x > paddle.pos.x + paddle.dim.x)
+          right.x = paddle.pos.x + paddle.dim.x;
+        V2 mid = v2_add(v2_smul(0.5f, left), v2_smul(0.5f, right));
+        F32 hit_normalized = (mid.x - paddle.pos.x)/paddle.dim.x;
+        // NOTE(leo): 0: -45 degs, 1: 45 degs, in between: lerp. Relative to paddle normal
+        F32 PI = 3.14159f;
+        F32 angle = hit_normalized*(PI/2.0f - PI/4.0f) + (1.0f - hit_normalized)*(PI/2.0f + PI/4.0f);
+        ball->direction.x = cosf(angle);
+        ball->direction.y = sinf(angle);
+      }
+      else if(hit_paddle_edges & EDGE_LEFT || hit_paddle_edges & EDGE_RIGHT) {
+        /*
+          Elastic collision:
+            m1 = 1, m2 = inf
+            s1 = ball_speed_x, s2 = paddle_speed
+            u1 = ball_speed_x - paddle_speed, u2 = 0
+            v1 = (m1-m2)/(m1+m2)*u1 + (2*m2)/(m1+m2)*u2 = -1*(ball_speed_x - paddle_speed)
+            v2 = (2*m1)/(m1+m2)*u1 + (m2-m1)/(m1+m2)*u2 = 0
+            v1 = -ball_speed_x + paddle_speed
+            v2 = 0
+            w1 = -ball_speed_x + 2*paddle_speed
+            w2 = paddle_speed
+        */
+        V2 w1 = { -ball->speed*ball->direction.x + 2*paddle_speed, ball->speed*ball->direction.y };
+        ball->speed = sqrtf(w1.x*w1.x + w1.y*w1.y);
+        ball->direction = v2_smul(1.0f/ball->speed, w1);
+        if(hit_paddle_edges & EDGE_LEFT)
+          ball->rect.pos.x += -0.001f;
+        else
+          ball->rect.pos.x += 0.001f;
+
+        // NOTE(leo): Hit towards a wall with hardly any room left between it and the paddle, the ball would bounce
+        // between the two in ever smaller (and faster) steps, or get squeezed. It's pushed out over the paddle instead
+        F32 paddle_end_x = compute_paddle_x(game_state, paddle_start_x, paddle_speed, dt);
+        bool is_left_of_paddle = (hit_paddle_edges & EDGE_LEFT) != 0;
+        bool is_trapped = is_left_of_paddle
+          ? paddle_end_x < 2.0f*ball->rect.dim.x
+          : ARENA_WIDTH - (paddle_end_x + paddle.dim.x) < 2.0f*ball->rect.dim.x;
+        if(is_trapped) {
+          ball->rect.pos.y = paddle.pos.y + paddle.dim.y + 0.001f;
+          if(ball->rect.pos.x < 0.0f)
+            ball->rect.pos.x = 0.0f;
+          else if(ball->rect.pos.x > ARENA_WIDTH - ball->rect.dim.x)
+            ball->rect.pos.x = ARENA_WIDTH - ball->rect.dim.x;
+          if(ball->direction.y < 0.0f)
+            ball->direction.y = -ball->direction.y;
+          // NOTE(leo): Away from the wall, it may be flush against it now
+          if(is_left_of_paddle == (ball->direction.x < 0.0f))
+            ball->direction.x = -ball->direction.x;
+        }
+      }
+      else {
+        reflect_ball(hit_paddle_edges, &ball->rect, &ball->direction);
+      }
+    }
+
+
+    // NOTE(leo): Record hits. Bricks take damage (and break) right away, they take part in collision. Everything else
+    // that follows from a hit is up to apply_gameplay_events
+    V2 ball_center = v2_add(ball->rect.pos, v2_smul(0.5f, ball->rect.dim));
+    if(hit_bricks && game_state->state == GAME_STATE_PLAYING) {
+      for(int i = 0; i < hit_brick_count; i++) {
+        int brick_index = hit_brick_indices[i];
+        game_state->brick_hps[brick_index]--;
+        bool is_broken = game_state->brick_hps[brick_index] == 0;
+        game_state->bricks_remaining -= is_broken;
+        push_game_event(game_state, (GameEvent){
+          .type = is_broken ? GAME_EVENT_BRICK_HIT : GAME_EVENT_BRICK_DAMAGED,
+          .brick_index = (U16)brick_index,
+          .pos = ball_center,
+        });
+      }
+      invalidate_static_layer(game_state);
+
+      // NOTE(leo): Scrolling never clears, bricks_remaining only counts the resident ones
+      if(game_state->bricks_remaining == 0 && game_state->scroll.speed <= 0.0f)
+        return BALL_STEP_STOP;
+    }
+
+    if(hit_walls) {
+      push_game_event(game_state, (GameEvent){ .type = GAME_EVENT_WALL_HIT, .edges = hit_wall_edges, .pos = ball_center });
+
+      if((hit_wall_edges & EDGE_TOP) && game_state->state == GAME_STATE_PLAYING) {
+        if(game_state->ball_count > 1) {
+          push_game_event(game_state, (GameEvent){ .type = GAME_EVENT_BALL_LOST, .pos = ball_center });
+          return BALL_STEP_LOST;
+        }
+        push_game_event(game_state, (GameEvent){ .type = GAME_EVENT_ROUND_OVER, .pos = ball_center });
+        return BALL_STEP_STOP;
+      }
+    }
+
+    if(hit_paddle)
+      push_game_event(game_state, (GameEvent){ .type = GAME_EVENT_PADDLE_HIT, .edges = hit_paddle_edges, .pos = ball_center });
+
+    elapsed += step;
+    if(iterations > 25) {
+      // TODO(leo): Proper time step (why not dt to previous frame?)
+      assert(false);
+      break;
+    }
+  }
+  return BALL_STEP_DONE;
+}
+
+/*
+  Same collision rules as simulate_ball, but on a copy of the ball and of the bricks, and without the paddle: the ball
+  travels in straight pieces of at most PREDICTION_STEP_LENGTH (keeps the brick broadphase small) until its bottom
+  crosses the paddle top on the way down. Bricks it hits on the way take damage in the copy, like they would in play.
+*/
+#define PREDICTION_STEP_LENGTH 16.0f
+#define PREDICTION_MAX_STEP_COUNT 256
+
+BallPrediction predict_ball_at_paddle(GameState *game_state, int ball_index)
+{
+  BallPrediction result = { .is_valid = false };
+
+  Ball ball = game_state->balls[ball_index];
+  U8 brick_hps[MAX_BRICK_COUNT];
+  memcpy(brick_hps, game_state->brick_hps, game_state->level.brick_count*sizeof(U8));
+  bool are_bricks_breaking = game_state->state == GAME_STATE_PLAYING;
+
+  // NOTE(leo): The ball speeds up to the target speed within a fraction of a second, so the distance is timed with that
+  F32 speed = ball.speed;
+  if(speed < compute_target_ball_speed(game_state))
+    speed = compute_target_ball_speed(game_state);
+  if(speed <= 0.0f)
+    return result;
+
+  F32 paddle_top = PADDLE_Y + PADDLE_HEIGTH;
+  F32 distance = 0.0f;
+  for(int step_index = 0; step_index < PREDICTION_MAX_STEP_COUNT; step_index++) {
+    F32 length = PREDICTION_STEP_LENGTH;
+
+    // NOTE(leo): Paddle top crossed within this piece?
+    bool reaches_paddle = false;
+    if(ball.direction.y < 0.0f && ball.rect.pos.y >= paddle_top) {
+      F32 line_length = (ball.rect.pos.y - paddle_top)/-ball.direction.y;
+      if(line_length <= length) {
+        length = line_length;
+        reaches_paddle = true;
+      }
+    }
+
+    V2 ball_delta = v2_smul(length, ball.direction);
+    BrickHits brick_hits = compute_brick_hits(&game_state->level, brick_hps, ball.rect, ball_delta);
+    Impact wall_impact = compute_wall_impact(ball.rect, ball_delta);
+
+    F32 toi = 1.0f;
+    if(brick_hits.time < toi)
+      toi = brick_hits.time;
+    if(wall_impact.time < toi)
+      toi = wall_impact.time;
+
+    ball.rect.pos = v2_add(ball.rect.pos, v2_smul(toi, ball_delta));
+    distance += toi*length;
+
+    if(toi == 1.0f && reaches_paddle) {
+      result.is_valid = true;
+      result.time = distance/speed;
+      result.pos = ball.rect.pos;
+      return result;
+    }
+
+    if(wall_impact.time < brick_hits.time) {
+      // NOTE(leo): Below the paddle already, it's lost
+      if(wall_impact.edges & EDGE_TOP)
+        return result;
+      reflect_ball(wall_impact.edges, &ball.rect, &ball.direction);
+    }
+    else if(brick_hits.time < 1.0f) {
+      U8 edges = 0;
+      for(int i = 0; i < brick_hits.count; i++) {
+        edges |= brick_hits.edges[i];
+        if(are_bricks_breaking)
+          brick_hps[brick_hits.indices[i]]--;
+      }
+      reflect_ball(edges, &ball.rect, &ball.direction);
+    }
+  }
+  return result;
+}
+
+// NOTE(leo): Falling power-ups, swept against the paddle moving by paddle_delta. Collected ones become events
+internal
+void update_power_ups(GameState *game_state, F32 dt, Rect paddle, V2 paddle_delta)
+{
+  U64 start_cycles = __rdtsc();
+
+  PowerUpPool *pool = &game_state->power_ups;
+  V2 delta = { 0.0f, -POWER_UP_FALL_SPEED*dt };
+  F32 paddle_top = paddle.pos.y + paddle.dim.y;
+  for(int index = 0; index < pool->count;) {
+    F32 y = pool->pos_y[index];
+
+    // NOTE(leo): Most are nowhere near the paddle, skip the swept test for them
+    if(y + delta.y <= paddle_top && y + POWER_UP_HEIGHT >= paddle.pos.y) {
+      Rect rect = { .pos = { pool->pos_x[index], y }, .dim = { POWER_UP_WIDTH, POWER_UP_HEIGHT } };
+      Impact impact = compute_impact(rect, delta, paddle, paddle_delta);
+      if(impact.time < 1.0f) {
+        push_game_event(game_state, (GameEvent){
+          .type = GAME_EVENT_POWER_UP_COLLECTED,
+          .power_up_type = pool->type[index],
+          .pos = { rect.pos.x + POWER_UP_WIDTH/2.0f, rect.pos.y + POWER_UP_HEIGHT/2.0f },
+        });
+        power_up_remove_at(pool, index);
+        continue;
+      }
+    }
+
+    y += delta.y;
+    if(y + POWER_UP_HEIGHT < 0.0f) {
+      power_up_remove_at(pool, index);
+      continue;
+    }
+    pool->pos_y[index] = y;
+    index++;
+  }
+
+  pool->update_cycles = __rdtsc() - start_cycles;
+}
+
+// NOTE(leo): Moves paddle, balls and power-ups by dt with continuous collision. Hits are recorded as events (see
+// GameEventRing)
+internal
+void simulate_physics(GameState *game_state, F32 dt, F32 paddle_control)
+{
+  // NOTE(leo): Compute new paddle speed
+  F32 paddle_speed = 0.0f;
+  if(game_state->state == GAME_STATE_PLAYING)
+  {
+    F32 paddle_speed_factor = 20.0f;
+    F32 target_paddle_pos = (F32)paddle_control*(ARENA_WIDTH-game_state->paddle.dim.x);
+    if(target_paddle_pos < 0.0f)
+      target_paddle_pos = 0.0f;
+    if(target_paddle_pos > ARENA_WIDTH)
+      target_paddle_pos = ARENA_WIDTH;
+    F32 add_pos = target_paddle_pos - game_state->paddle.pos.x;
+    F32 dx = paddle_speed_factor*add_pos*dt;
+    if(fabsf(dx) > fabsf(add_pos))
+      dx = add_pos;
+    paddle_speed = dx/dt;
+  }
+
+  F32 target_ball_speed = compute_target_ball_speed(game_state);
+  F32 paddle_start_x = game_state->paddle.pos.x;
+
+  bool is_stopped = false;
+  for(int ball_index = 0; ball_index < game_state->ball_count;) {
+    Ball *ball = &game_state->balls[ball_index];
+
+    // NOTE(leo): Compute new ball speed
+    {
+      bool too_fast = target_ball_speed < ball->speed;
+      F32 ball_add_speed = fabsf(target_ball_speed - ball->speed);
+      F32 ball_acceleration = 100.0f;
+      F32 ball_accelerate_speed = ball_acceleration*dt;
+      if(ball_accelerate_speed > ball_add_speed)
+        ball_accelerate_speed = ball_add_speed;
+      if(too_fast)
+        ball->speed -= ball_accelerate_speed;
+      else
+        ball->speed += ball_accelerate_speed;
+    }
+
+    int result = simulate_ball(game_state, ball, dt, paddle_start_x, paddle_speed);
+    if(result == BALL_STEP_STOP) {
+      is_stopped = true;
+      break;
+    }
+    if(result == BALL_STEP_LOST)
+      *ball = game_state->balls[--game_state->ball_count];
+    else
+      ball_index++;
+  }
+
+  Rect paddle_start = game_state->paddle;
+  game_state->paddle.pos.x = compute_paddle_x(game_state, paddle_start_x, paddle_speed, dt);
+
+  if(!is_stopped && game_state->state == GAME_STATE_PLAYING) {
+    V2 paddle_delta = { game_state->paddle.pos.x - paddle_start.pos.x, 0.0f };
+    update_power_ups(game_state, dt, paddle_start, paddle_delta);
+  }
+}
+
+// NOTE(leo): Scoring, ball speed, paddle shrinking and round transitions for the events in [first_index, write_index)
+internal
+void apply_gameplay_events(GameState *game_state, U32 first_index)
+{
+  GameEventRing *ring = &game_state->events;
+  for(U32 index = first_index; index != ring->write_index; index++) {
+    // NOTE(leo): Events after a round transition are from the bouncing ball that is left over
+    if(game_state->state != GAME_STATE_PLAYING)
+      break;
+
+    GameEvent *event = game_event_at(ring, index);
+    switch(event->type) {
+      case GAME_EVENT_BRICK_HIT:
+      case GAME_EVENT_BRICK_DAMAGED: {
+        game_state->hit_count++;
+
+        // NOTE(leo): Max ball speed if orange or red brick, on every hit
+        U32 brick_type = game_state->level.brick_types[event->brick_index];
+        if(brick_type >= 2 && game_state->target_ball_speed < game_state->tuning.ball_speeds[3])
+          game_state->target_ball_speed = game_state->tuning.ball_speeds[3];
+        invalidate_static_layer(game_state);
+        if(event->type == GAME_EVENT_BRICK_DAMAGED)
+          break;
+
+        // NOTE(leo): Score and power-ups only for breaking it
+        game_state->score += roundf(game_state->level.brick_scores[event->brick_index] * game_state->difficulty_factor);
+
+        if(game_random(game_state) % POWER_UP_DROP_ONE_IN == 0) {
+          Rect brick_rect = game_state->level.brick_rects[event->brick_index];
+          V2 pos = { brick_rect.pos.x + (brick_rect.dim.x - POWER_UP_WIDTH)/2.0f, brick_rect.pos.y };
+          power_up_spawn(&game_state->power_ups, pos, (U8)(game_random(game_state) % POWER_UP_TYPE_COUNT));
+        }
+      } break;
+
+      case GAME_EVENT_WALL_HIT: {
+        if((event->edges & EDGE_LEFT) || (event->edges & EDGE_RIGHT))
+          game_state->hit_count++;
+        if((event->edges & EDGE_BOTTOM) || (event->edges & EDGE_TOP))
+          game_state->hit_count++;
+
+        // NOTE(leo): Paddle shrinking
+        if(event->edges & EDGE_BOTTOM && !game_state->is_paddle_shrunk) {
+          game_state->is_paddle_shrunk = true;
+          change_paddle_width(game_state, game_state->paddle.dim.x/2.0f);
+        }
+      } break;
+
+      case GAME_EVENT_PADDLE_HIT: {
+        game_state->hit_count++;
+      } break;
+
+      case GAME_EVENT_ROUND_OVER: {
+        if(game_state->balls_remaining)
+          game_state->state = GAME_STATE_RESET_PADDLE;
+        else
+          game_state->state = GAME_STATE_GAME_OVER;
+      } break;
+
+      case GAME_EVENT_POWER_UP_COLLECTED: {
+        if(event->power_up_type == POWER_UP_MULTI_BALL) {
+          // NOTE(leo): Two more balls from the first one, 30 degrees to either side of it
+          Ball source = game_state->balls[0];
+          F32 angles[2] = { 0.52f, -0.52f };
+          for(int i = 0; i < 2 && game_state->ball_count < MAX_BALL_COUNT; i++) {
+            F32 c = cosf(angles[i]);
+            F32 s = sinf(angles[i]);
+            Ball ball = source;
+            ball.direction = (V2){ c*source.direction.x - s*source.direction.y, s*source.direction.x + c*source.direction.y };
+            game_state->balls[game_state->ball_count++] = ball;
+          }
+        }
+        else if(event->power_up_type == POWER_UP_WIDE_PADDLE) {
+          if(game_state->wide_paddle_time <= 0.0f)
+            change_paddle_width(game_state, game_state->paddle.dim.x*POWER_UP_WIDE_PADDLE_FACTOR);
+          game_state->wide_paddle_time = POWER_UP_DURATION;
+        }
+        else if(event->power_up_type == POWER_UP_SLOW_BALL) {
+          game_state->slow_ball_time = POWER_UP_DURATION;
+        }
+      } break;
+    }
+
+    // NOTE(leo): Ball speed gameplay logic
+    if(game_state->state == GAME_STATE_PLAYING) {
+      GameTuning *tuning = &game_state->tuning;
+      if(game_state->hit_count == tuning->speed_up_hit_counts[0] && game_state->target_ball_speed < tuning->ball_speeds[1])
+        game_state->target_ball_speed = tuning->ball_speeds[1];
+      else if(game_state->hit_count == tuning->speed_up_hit_counts[1] && game_state->target_ball_speed < tuning->ball_speeds[2])
+        game_state->target_ball_speed = tuning->ball_speeds[2];
+    }
+  }
+
+  // NOTE(leo): Second set of bricks, or the next one in endless mode. The scrolling field has no end
+  if(game_state->state == GAME_STATE_PLAYING && game_state->bricks_remaining == 0 && game_state->scroll.speed <= 0.0f) {
+    if(game_state->has_cleared_bricks && !game_state->is_endless) {
+      game_state->state = GAME_STATE_GAME_OVER;
+    }
+    else {
+      switch_to_reset_game(game_state, false, false);
+      game_state->has_cleared_bricks = true;
+      // TODO(leo): Is this confusing the player? Could think: Why do
+      // they take a ball from me when I serve after I have cleared the
+      // first set of bricks?
+      game_state->balls_remaining++;
+      invalidate_static_layer(game_state);
+    }
+  }
+}
+
+internal
+void spawn_particles_for_events(GameState *game_state, U32 first_index, ParticleSystem *particles)
+{
+  GameEventRing *ring = &game_state->events;
+  for(U32 index = first_index; index != ring->write_index; index++) {
+    GameEvent *event = game_event_at(ring, index);
+    if(event->type == GAME_EVENT_BRICK_HIT) {
+      Rect brick_rect = game_state->level.brick_rects[event->brick_index];
+      V2 brick_center = v2_add(brick_rect.pos, v2_smul(0.5f, brick_rect.dim));
+      particles_spawn_burst(particles, brick_center, 24, 30.0f, 0.8f, color_unpack(game_state->level.brick_colors[event->brick_index]));
+    }
+    else if(event->type == GAME_EVENT_BRICK_DAMAGED) {
+      particles_spawn_burst(particles, event->pos, 8, 15.0f, 0.4f, color_unpack(game_state->level.brick_colors[event->brick_index]));
+    }
+    else if(event->type == GAME_EVENT_WALL_HIT) {
+      particles_spawn_burst(particles, event->pos, 6, 15.0f, 0.3f, COLOR_WHITE);
+    }
+    else if(event->type == GAME_EVENT_PADDLE_HIT) {
+      particles_spawn_burst(particles, event->pos, 10, 20.0f, 0.4f, PADDLE_COLOR);
+    }
+    else if(event->type == GAME_EVENT_POWER_UP_COLLECTED) {
+      particles_spawn_burst(particles, event->pos, 32, 25.0f, 0.6f, power_up_colors[event->power_up_type]);
+    }
+  }
+}
+
+// NOTE(leo): The level's colour on the last hit point, paler for every one more left
+internal
+Color compute_brick_color(GameState *game_state, int brick_index)
+{
+  Color result = color_unpack(game_state->level.brick_colors[brick_index]);
+  F32 t = fminf(0.3f*(game_state->brick_hps[brick_index] - 1), 0.6f);
+  result.r += (1.0f - result.r)*t;
+  result.g += (1.0f - result.g)*t;
+  result.b += (1.0f - result.b)*t;
+  return result;
+}
+
+// NOTE(leo): Only the parts inside the arena (scrolling chunks stream in above it)
+internal
+void draw_bricks(GameState *game_state, V2 arena_offset, RenderCmdBuffer *cmd_buffer)
+{
+  for(int brick_index = 0; brick_index < game_state->level.brick_count; brick_index++) {
+    if(!game_state->brick_hps[brick_index])
+      continue;
+    Rect brick_rect = game_state->level.brick_rects[brick_index];
+    if(brick_rect.pos.y >= ARENA_HEIGHT)
+      continue;
+    if(brick_rect.pos.y + brick_rect.dim.y > ARENA_HEIGHT)
+      brick_rect.dim.y = ARENA_HEIGHT - brick_rect.pos.y;
+    Color color = compute_brick_color(game_state, brick_index);
+    if(game_state->state == GAME_STATE_RESET_GAME)
+      color.a = game_state->brick_alpha[brick_index];
+    draw_rectangle_offset(brick_rect, arena_offset, color, cmd_buffer);
+  }
+}
+
+// NOTE(leo): Everything in here must invalidate_static_layer when it changes
+internal
+void draw_static_layer(GameState *game_state, RenderCmdBuffer *cmd_buffer)
+{
+  // NOTE(leo): Draw arena
+  draw_rectangle((Rect) { (V2) { 0.0f, 0.0f }, (V2) { 2.0f, PLAYING_AREA_HEIGHT } }, COLOR_WHITE, cmd_buffer);
+  draw_rectangle((Rect) { (V2) { 2.0f+ARENA_WIDTH, 0.0f }, (V2) { 2.0f, PLAYING_AREA_HEIGHT } }, COLOR_WHITE, cmd_buffer);
+  draw_rectangle((Rect) { (V2) { 2.0f, ARENA_HEIGHT }, (V2) { ARENA_WIDTH, 2.0f } }, COLOR_WHITE, cmd_buffer);
+
+  V2 arena_offset = { 2.0f, 0.0f };
+
+  // NOTE(leo): Draw bricks. Scrolling bricks move every frame, they are drawn with the paddle instead
+  if(game_state->scroll.speed <= 0.0f)
+    draw_bricks(game_state, arena_offset, cmd_buffer);
+
+  // NOTE(leo): Draw score
+  {
+    char buffer[4];
+    buffer[0] = (game_state->score / 100) % 10 + '0';
+    buffer[1] = (game_state->score / 10) % 10 + '0';
+    buffer[2] = (game_state->score / 1) % 10 + '0';
+    buffer[3] = 0;
+    V2 cursor = (V2){ 2.0f + ARENA_WIDTH/2.0f + ARENA_WIDTH/4.0f, ARENA_HEIGHT + (PLAYING_AREA_HEIGHT-ARENA_HEIGHT)/2.0f };
+    draw_text_centered(buffer, cursor, 1, COLOR_WHITE, cmd_buffer);
+  }
+
+  // NOTE(leo): Draw ball count
+  {
+    char buffer[4];
+    buffer[0] = (game_state->balls_remaining / 100) % 10 + '0';
+    buffer[1] = (game_state->balls_remaining / 10) % 10 + '0';
+    buffer[2] = (game_state->balls_remaining / 1) % 10 + '0';
+    buffer[3] = 0;
+    V2 cursor = (V2){ 2.0f + ARENA_WIDTH/2.0f - ARENA_WIDTH/4.0f, ARENA_HEIGHT + (PLAYING_AREA_HEIGHT-ARENA_HEIGHT)/2.0f };
+    draw_text_centered(buffer, cursor, 1, COLOR_WHITE, cmd_buffer);
+  }
+}
+
+void game_update(GameState *game_state, F32 dt, Input *input, ParticleSystem *particles, RenderLayer *static_layer, RenderCmdBuffer *cmd_buffer)
 {
   // NOTE(leo): initialization
   if(game_state->state == GAME_STATE_UNINITIALIZED)
   {
-    srand(time(0));
+    if(!game_state->random_state)
+      game_state->random_state = (U32)time(0) | 1;
+    if(!game_state->tuning.paddle_width)
+      game_state->tuning = default_game_tuning();
 
     game_state->state = GAME_STATE_MAIN_MENU;
 
@@ -207,19 +1090,22 @@ void game_update(GameState *game_state, F32 dt, Input *input, RenderCmdBuffer *c
 
     // NOTE(leo): Paddle
     game_state->paddle = (Rect){
-      .pos = { INITIAL_PADDLE_POS(PADDLE_WIDTH(game_state->difficulty_factor)), PADDLE_Y },
-      .dim = { PADDLE_WIDTH(game_state->difficulty_factor), PADDLE_HEIGTH }
+      .pos = { INITIAL_PADDLE_POS(compute_paddle_width(game_state)), PADDLE_Y },
+      .dim = { compute_paddle_width(game_state), PADDLE_HEIGTH }
     };
     game_state->is_paddle_shrunk = false;
 
     // NOTE(leo): Ball
-    game_state->ball = (Rect){
-      .pos = INITIAL_BALL_POS,
-      .dim = { BALL_WIDTH, BALL_HEIGHT }
-    };
+    reset_ball(game_state);
 
     // NOTE(leo): Bricks
-    reset_bricks(game_state);
+    if(game_state->scroll.speed > 0.0f) {
+      reset_scroll_field(game_state);
+    }
+    else {
+      select_level(game_state, game_state->first_level_index);
+      reset_bricks(game_state);
+    }
 
     game_state->balls_remaining = 3;
   }
@@ -227,7 +1113,7 @@ void game_update(GameState *game_state, F32 dt, Input *input, RenderCmdBuffer *c
   // NOTE(leo): Animate paddle back
   if(game_state->state == GAME_STATE_RESET_PADDLE) {
     // NOTE(leo): Width
-    F32 target_paddle_width = PADDLE_WIDTH(game_state->difficulty_factor);
+    F32 target_paddle_width = compute_paddle_width(game_state);
     {
       F32 add_width = target_paddle_width - game_state->paddle.dim.x;
       F32 dw = 20.0f*add_width*dt;
@@ -257,7 +1143,7 @@ void game_update(GameState *game_state, F32 dt, Input *input, RenderCmdBuffer *c
     F32 alpha_speed = 6.0f;
     F32 offset = 0.1f;
     int finished_brick_count = 0;
-    for(int brick_index = 0; brick_index < BRICK_COUNT; brick_index++) {
+    for(int brick_index = 0; brick_index < game_state->level.brick_count; brick_index++) {
       F32 alpha = game_state->brick_alpha[brick_index];
       alpha += (1.0f - alpha + offset) * alpha_speed * dt;
       if(alpha >= 1.0f - 0.001f) {
@@ -266,11 +1152,12 @@ void game_update(GameState *game_state, F32 dt, Input *input, RenderCmdBuffer *c
       }
       game_state->brick_alpha[brick_index] = alpha;
     }
+    invalidate_static_layer(game_state);
 
     // NOTE(leo): Width
     bool is_paddle_width_finished = false;
     {
-      F32 target_paddle_width = PADDLE_WIDTH(game_state->difficulty_factor);
+      F32 target_paddle_width = compute_paddle_width(game_state);
       F32 add_width = target_paddle_width - game_state->paddle.dim.x;
       F32 dw = 20.0f*add_width*dt;
       if(fabsf(dw) > fabsf(add_width))
@@ -293,7 +1180,7 @@ void game_update(GameState *game_state, F32 dt, Input *input, RenderCmdBuffer *c
         is_paddle_position_finished = true;
     }
 
-    if(finished_brick_count == BRICK_COUNT && is_paddle_width_finished && is_paddle_position_finished) {
+    if(finished_brick_count == game_state->level.brick_count && is_paddle_width_finished && is_paddle_position_finished) {
       if(game_state->is_switching_to_main_menu)
         game_state->state = GAME_STATE_MAIN_MENU;
       else
@@ -306,303 +1193,57 @@ void game_update(GameState *game_state, F32 dt, Input *input, RenderCmdBuffer *c
         game_state->balls_remaining = 3;
         game_state->has_cleared_bricks = false;
       }
+      invalidate_static_layer(game_state);
     }
   }
 
 
-  // NOTE(leo): Physics
-  if(game_state->state == GAME_STATE_PLAYING || game_state->state == GAME_STATE_GAME_OVER)
-  {
-    // NOTE(leo): Compute new paddle speed
-    F32 paddle_speed = 0.0f;
-    if(game_state->state == GAME_STATE_PLAYING)
-    {
-      F32 paddle_speed_factor = 20.0f;
-      F32 target_paddle_pos = (F32)input->paddle_control*(ARENA_WIDTH-game_state->paddle.dim.x);
-      if(target_paddle_pos < 0.0f)
-        target_paddle_pos = 0.0f;
-      if(target_paddle_pos > ARENA_WIDTH)
-        target_paddle_pos = ARENA_WIDTH;
-      F32 add_pos = target_paddle_pos - game_state->paddle.pos.x;
-      F32 dx = paddle_speed_factor*add_pos*dt;
-      if(fabsf(dx) > fabsf(add_pos))
-        dx = add_pos;
-      paddle_speed = dx/dt;
-    }
-
-    // NOTE(leo): Compute new ball speed
-    {
-      bool too_fast = game_state->target_ball_speed < game_state->ball_speed;
-      F32 ball_add_speed = fabsf(game_state->target_ball_speed - game_state->ball_speed);
-      F32 ball_acceleration = 100.0f;
-      F32 ball_accelerate_speed = ball_acceleration*dt;
-      if(ball_accelerate_speed > ball_add_speed)
-        ball_accelerate_speed = ball_add_speed;
-      if(too_fast)
-        game_state->ball_speed -= ball_accelerate_speed;
-      else
-        game_state->ball_speed += ball_accelerate_speed;
-    }
-
-    F32 elapsed = 0.0f;
-    int iterations = 0;
-    while(elapsed < dt) {
-      iterations++;
-
-      F32 step = dt-elapsed;
-
-      V2 ball_delta = v2_smul(step*game_state->ball_speed, game_state->ball_direction);
-
-      // NOTE(leo): Compute time of impact with up to 3 bricks (eg: hit corner)
-      F32 toi_bricks = 1.0f;
-      int hit_brick_indices[3] = { -1,-1,-1 };
-      U8 hit_brick_edges[3] = { 0, 0, 0 };
-      int hit_brick_count = 0;
-      {
-        for(int brick_index = 0; brick_index < BRICK_COUNT; brick_index++) {
-          if(game_state->is_brick_broken[brick_index])
-            continue;
-
-          Impact impact = compute_impact(game_state->ball, ball_delta, compute_brick_rect(brick_index), (V2) { 0.0f, 0.0f });
-          if(impact.time < 1.0f && impact.time <= toi_bricks) {
-            if(impact.time < toi_bricks) {
-              hit_brick_count = 0;
-              toi_bricks = impact.time;
-            }
-            hit_brick_indices[hit_brick_count] = brick_index;
-            hit_brick_edges[hit_brick_count] = impact.edges;
-            hit_brick_count++;
-            assert(hit_brick_count <= 3);
-          }
-        }
-      }
-
-      // NOTE(leo): Compute toi for walls
-      F32 toi_walls = 1.0f;
-      U8 hit_wall_edges = 0;
-      {
-        Rect walls[4] = {
-          { .pos = {0.0f, 0.0f}, .dim = {0.0f, ARENA_HEIGHT} },
-          { .pos = {0.0f, 0.0f}, .dim = {ARENA_WIDTH, 0.0f} },
-          { .pos = {ARENA_WIDTH, 0.0f}, .dim = {0.0f, ARENA_HEIGHT} },
-          { .pos = {0.0f, ARENA_HEIGHT}, .dim = {ARENA_WIDTH, 0.0f} },
-        };
-        for(int i = 0; i < 4; i++) {
-          Impact impact = compute_impact(game_state->ball, ball_delta, walls[i], (V2) { 0.0f, 0.0f });
-          F32 t = impact.time;
-          if(t < 1.0f && t <= toi_walls) {
-            if(t < toi_walls) {
-              toi_walls = impact.time;
-              hit_wall_edges = 0;
-            }
-            hit_wall_edges |= impact.edges;
-          }
-        }
-      }
-
-      // NOTE(leo): Compute toi_paddle
-      F32 toi_paddle = 1.0f;
-      U8 hit_paddle_edges = 0;
-      {
-        V2 paddle_delta = { step*paddle_speed, 0.0f };
-        if(game_state->paddle.pos.x + paddle_delta.x < 0.0f)
-          paddle_delta.x = 0.0f - game_state->paddle.pos.x;
-        else if(game_state->paddle.pos.x + paddle_delta.x > ARENA_WIDTH - game_state->paddle.dim.x)
-          paddle_delta.x = ARENA_WIDTH - game_state->paddle.dim.x - game_state->paddle.pos.x;
-        Impact impact = compute_impact(game_state->ball, ball_delta, game_state->paddle, paddle_delta);
-        toi_paddle = impact.time;
-        hit_paddle_edges = impact.edges;
-      }
-
-      // NOTE(leo): choose smallest toi
-      F32 toi_min = 1.0f;
-      bool hit_bricks = false;
-      bool hit_walls = false;
-      bool hit_paddle = false;
-      if(toi_bricks < toi_min) {
-        hit_bricks = true;
-        toi_min = toi_bricks;
-      }
-      if(toi_walls < toi_min) {
-        // NOTE(leo): Impossible to hit bricks and walls at same time
-        hit_bricks = false;
-        hit_walls = true;
-        toi_min = toi_walls;
-      }
-      if(toi_paddle < 1.0f && toi_paddle <= toi_min) {
-        // NOTE(leo) Possible to hit wall and paddle at same time
-        if(toi_paddle < toi_min) {
-          hit_bricks = false;
-          hit_walls = false;
-        }
-        hit_paddle = true;
-        toi_min = toi_paddle;
-      }
-
-      step *= toi_min;
-
-
-      // NOTE(leo): integrate by step
-      game_state->ball.pos = v2_add(game_state->ball.pos, v2_smul(step*game_state->ball_speed, game_state->ball_direction));
-
-      V2 paddle_delta = { step*paddle_speed, 0.0f };
-      if(game_state->paddle.pos.x + paddle_delta.x < 0.0f)
-        paddle_delta.x = 0.0f - game_state->paddle.pos.x;
-      else if(game_state->paddle.pos.x + paddle_delta.x > ARENA_WIDTH - game_state->paddle.dim.x)
-        paddle_delta.x = ARENA_WIDTH - game_state->paddle.dim.x - game_state->paddle.pos.x;
-      game_state->paddle.pos = v2_add(game_state->paddle.pos, paddle_delta);
-
-
-      // NOTE(leo): Reflect off bricks
-      if(hit_bricks) {
-        U8 edges = 0;
-        for(int i = 0; i < hit_brick_count; i++)
-          edges |= hit_brick_edges[i];
-        reflect_ball(edges, &game_state->ball, &game_state->ball_direction);
-      }
-
-      // NOTE(leo): Reflect off walls
-      if(hit_walls) {
-        reflect_ball(hit_wall_edges, &game_state->ball, &game_state->ball_direction);
-      }
-
-      // NOTE(leo): "Reflect" off paddle
-      if(hit_paddle) {
-        if(hit_paddle_edges & EDGE_TOP) {
-          V2 left = game_state->ball.pos;
-          V2 right = v2_add(game_state->ball.pos, (V2) { game_state->ball.dim.x, 0.0f });
-          if(left.x < game_state->paddle.pos.x)
-            left.x = game_state->paddle.pos.x;
-          if(right.x > game_state->paddle.pos.x + game_state->paddle.dim.x)
-            right.x = game_state->paddle.pos.x + game_state->paddle.dim.x;
-          V2 mid = v2_add(v2_smul(0.5f, left), v2_smul(0.5f, right));
-          F32 hit_normalized = (mid.x - game_state->paddle.pos.x)/game_state->paddle.dim.x;
-          // NOTE(leo): 0: -45 degs, 1: 45 degs, in between: lerp. Relative to paddle normal
-          F32 PI = 3.14159f;
-          F32 angle = hit_normalized*(PI/2.0f - PI/4.0f) + (1.0f - hit_normalized)*(PI/2.0f + PI/4.0f);
-          game_state->ball_direction.x = cosf(angle);
-          game_state->ball_direction.y = sinf(angle);
-        }
-        else if(hit_paddle_edges & EDGE_LEFT || hit_paddle_edges & EDGE_RIGHT) {
-          /*
-            Elastic collision:
-              m1 = 1, m2 = inf
-              s1 = ball_speed_x, s2 = paddle_speed
-              u1 = ball_speed_x - paddle_speed, u2 = 0
-              v1 = (m1-m2)/(m1+m2)*u1 + (2*m2)/(m1+m2)*u2 = -1*(ball_speed_x - paddle_speed)
-              v2 = (2*m1)/(m1+m2)*u1 + (m2-m1)/(m1+m2)*u2 = 0
-              v1 = -ball_speed_x + paddle_speed
-              v2 = 0
-              w1 = -ball_speed_x + 2*paddle_speed
-              w2 = paddle_speed
-          */
-          V2 w1 = { -game_state->ball_speed*game_state->ball_direction.x + 2*paddle_speed, game_state->ball_speed*game_state->ball_direction.y };
-          game_state->ball_speed = sqrtf(w1.x*w1.x + w1.y*w1.y);
-          game_state->ball_direction = v2_smul(1.0f/game_state->ball_speed, w1);
-          if(hit_paddle_edges & EDGE_LEFT)
-            game_state->ball.pos.x += -0.001f;
-          else
-            game_state->ball.pos.x += 0.001f;
-        }
-        else {
-          reflect_ball(hit_paddle_edges, &game_state->ball, &game_state->ball_direction);
-        }
-      }
-
-
-      // NOTE(leo): Hit bricks gameplay logic
-      if(hit_bricks && game_state->state == GAME_STATE_PLAYING) {
-        game_state->hit_count += hit_brick_count;
-        game_state->bricks_remaining -= hit_brick_count;
-
-        // NOTE(leo): Attribute score for hitting brick; Max ball speed if orange or red brick
-        for(int i = 0; i < hit_brick_count; i++) {
-          game_state->is_brick_broken[hit_brick_indices[i]] = true;
-          U32 brick_type = compute_brick_type(hit_brick_indices[i]);
-          if(brick_type == 0) {
-            game_state->score += roundf(1 * game_state->difficulty_factor);
-          }
-          else if(brick_type == 1) {
-            game_state->score += roundf(3 * game_state->difficulty_factor);
-          }
-          else if(brick_type == 2) {
-            game_state->score += roundf(5 * game_state->difficulty_factor);
-            if(game_state->target_ball_speed < BALL_SPEED_4)
-              game_state->target_ball_speed = BALL_SPEED_4;
-          }
-          else if(brick_type == 3) {
-            game_state->score += roundf(7 * game_state->difficulty_factor);
-            if(game_state->target_ball_speed < BALL_SPEED_4)
-              game_state->target_ball_speed = BALL_SPEED_4;
-          }
-        }
-
-        // NOTE(leo): Second set of bricks
-        if(game_state->bricks_remaining == 0) {
-          if(game_state->has_cleared_bricks) {
-            game_state->state = GAME_STATE_GAME_OVER;
-          }
-          else {
-            switch_to_reset_game(game_state, false, false);
-            game_state->has_cleared_bricks = true;
-            // TODO(leo): Is this confusing the player? Could think: Why do
-            // they take a ball from me when I serve after I have cleared the
-            // first set of bricks?
-            game_state->balls_remaining++;
-          }
-          elapsed = dt;
-          break;
-        }
-      }
-
-      // NOTE(leo): Hit walls gameplay logic
-      if(hit_walls && game_state->state == GAME_STATE_PLAYING) {
-        if((hit_wall_edges & EDGE_LEFT) || (hit_wall_edges & EDGE_RIGHT))
-          game_state->hit_count++;
-        if((hit_wall_edges & EDGE_BOTTOM) || (hit_wall_edges & EDGE_TOP))
-          game_state->hit_count++;
-
-        // NOTE(leo): Paddle shrinking
-        if(hit_wall_edges & EDGE_BOTTOM && !game_state->is_paddle_shrunk) {
-          game_state->is_paddle_shrunk = true;
-          change_paddle_width(game_state, game_state->paddle.dim.x/2.0f);
-        }
-
-        // NOTE(leo): Round over
-        if(hit_wall_edges & EDGE_TOP) {
-          if(game_state->balls_remaining)
-            game_state->state = GAME_STATE_RESET_PADDLE;
-          else
-            game_state->state = GAME_STATE_GAME_OVER;
+  // NOTE(leo): Scrolling field, before the physics see the bricks
+  if(game_state->state == GAME_STATE_PLAYING && game_state->scroll.speed > 0.0f)
+    scroll_field(game_state, dt);
 
-          elapsed = dt;
-          break;
-        }
-      }
+  // NOTE(leo): Power-up timers
+  if(game_state->state == GAME_STATE_PLAYING) {
+    if(game_state->wide_paddle_time > 0.0f) {
+      game_state->wide_paddle_time -= dt;
+      if(game_state->wide_paddle_time <= 0.0f)
+        change_paddle_width(game_state, game_state->paddle.dim.x/POWER_UP_WIDE_PADDLE_FACTOR);
+    }
+    if(game_state->slow_ball_time > 0.0f)
+      game_state->slow_ball_time -= dt;
+  }
 
-      // NOTE(leo): Hit paddle gameplay logic
-      if(hit_paddle && game_state->state == GAME_STATE_PLAYING) {
-        game_state->hit_count++;
+  // NOTE(leo): Physics. Simulated in segments, switching to each paddle sample at the time it was taken within the frame
+  if(game_state->state == GAME_STATE_PLAYING || game_state->state == GAME_STATE_GAME_OVER)
+  {
+    U32 first_event_index = game_state->events.write_index;
+    F32 time = 0.0f;
+    F32 paddle_control = input->paddle_control;
+    for(int sample_index = 0; sample_index <= input->paddle_sample_count; sample_index++) {
+      F32 segment_end = dt;
+      if(sample_index < input->paddle_sample_count) {
+        segment_end = input->paddle_samples[sample_index].time;
+        if(segment_end < time)
+          segment_end = time;
+        if(segment_end > dt)
+          segment_end = dt;
       }
 
-
-      // TODO(leo): Prevent paddle from pushing ball into wall
-
-      // NOTE(leo): Ball speed gameplay logic
-      if(game_state->state == GAME_STATE_PLAYING) {
-        if(game_state->hit_count == 4 && game_state->target_ball_speed < BALL_SPEED_2)
-          game_state->target_ball_speed = BALL_SPEED_2;
-        else if(game_state->hit_count == 12 && game_state->target_ball_speed < BALL_SPEED_3)
-          game_state->target_ball_speed = BALL_SPEED_3;
+      if(segment_end > time) {
+        U32 segment_event_index = game_state->events.write_index;
+        simulate_physics(game_state, segment_end - time, paddle_control);
+        apply_gameplay_events(game_state, segment_event_index);
       }
-
-      elapsed += step;
-      if(iterations > 25) {
-        // TODO(leo): Proper time step (why not dt to previous frame?)
-        assert(false);
+      if(game_state->state != GAME_STATE_PLAYING && game_state->state != GAME_STATE_GAME_OVER)
         break;
-      }
+
+      time = segment_end;
+      if(sample_index < input->paddle_sample_count)
+        paddle_control = input->paddle_samples[sample_index].paddle_control;
     }
+
+    if(particles)
+      spawn_particles_for_events(game_state, first_event_index, particles);
   }
 
   // NOTE(leo): Draw playing area boundaries (only visible if window width is too small)
@@ -611,55 +1252,48 @@ void game_update(GameState *game_state, F32 dt, Input *input, RenderCmdBuffer *c
   draw_rectangle(v2_add(playing_area.pos, (V2) { 0.0f, playing_area.dim.y }), v2_add(playing_area.pos, (V2) { playing_area.dim.x, playing_area.dim.y + scale*2.0f }), COLOR_WHITE, image);
 #endif
 
-  // NOTE(leo): Draw arena
-  draw_rectangle((Rect) { (V2) { 0.0f, 0.0f }, (V2) { 2.0f, PLAYING_AREA_HEIGHT } }, COLOR_WHITE, cmd_buffer);
-  draw_rectangle((Rect) { (V2) { 2.0f+ARENA_WIDTH, 0.0f }, (V2) { 2.0f, PLAYING_AREA_HEIGHT } }, COLOR_WHITE, cmd_buffer);
-  draw_rectangle((Rect) { (V2) { 2.0f, ARENA_HEIGHT }, (V2) { ARENA_WIDTH, 2.0f } }, COLOR_WHITE, cmd_buffer);
+  // NOTE(leo): Effects freeze with the game
+  if(particles && game_state->state != GAME_STATE_PAUSE)
+    particles_update(particles, dt);
 
-  V2 arena_offset = { 2.0f, 0.0f };
+  // NOTE(leo): Headless
+  if(!cmd_buffer)
+    return;
 
-  // NOTE(leo): Draw bricks
-  Color brick_colors[4] = { (Color){ 0.77f, 0.78f, 0.09f, 1.0f }, (Color){ 0.0f, 0.5f, 0.13f, 1.0f }, (Color){ 0.76f, 0.51f, 0.0f, 1.0f }, (Color){ 0.63f, 0.04f, 0.0f, 1.0f } };
-  for(int brick_index = 0; brick_index < BRICK_COUNT; brick_index++) {
-    if(game_state->is_brick_broken[brick_index])
-      continue;
-    Color color = brick_colors[compute_brick_type(brick_index)];
-    if(game_state->state == GAME_STATE_RESET_GAME)
-      color.a = game_state->brick_alpha[brick_index];
-    Rect brick_rect = compute_brick_rect(brick_index);
-    draw_rectangle_offset(brick_rect, arena_offset, color, cmd_buffer);
+  if(static_layer->version != game_state->static_layer_version) {
+    static_layer->cmd_buffer.count = 0;
+    static_layer->cmd_buffer.dropped_count = 0;
+    draw_static_layer(game_state, &static_layer->cmd_buffer);
+    static_layer->version = game_state->static_layer_version;
   }
 
+  V2 arena_offset = { 2.0f, 0.0f };
+
+  if(game_state->scroll.speed > 0.0f)
+    draw_bricks(game_state, arena_offset, cmd_buffer);
+
+  // NOTE(leo): Draw particles (behind paddle and ball)
+  if(particles)
+    particles_draw(particles, arena_offset, PARTICLE_MAX_DRAW_COUNT, cmd_buffer);
+
   // NOTE(leo): Draw paddle
   draw_rectangle_offset(game_state->paddle, arena_offset, PADDLE_COLOR, cmd_buffer);
 
-  // NOTE(leo): Draw ball
-  if((game_state->state == GAME_STATE_WAIT_SERVE) || (game_state->state == GAME_STATE_PLAYING)
-    || (game_state->state == GAME_STATE_GAME_OVER) || (game_state->state == GAME_STATE_PAUSE))
-  {
-    draw_rectangle_offset(game_state->ball, arena_offset, BALL_COLOR, cmd_buffer);
-  }
-
-  // NOTE(leo): Draw score
+  // NOTE(leo): Draw power-ups
   {
-    char buffer[4];
-    buffer[0] = (game_state->score / 100) % 10 + '0';
-    buffer[1] = (game_state->score / 10) % 10 + '0';
-    buffer[2] = (game_state->score / 1) % 10 + '0';
-    buffer[3] = 0;
-    V2 cursor = (V2){ 2.0f + ARENA_WIDTH/2.0f + ARENA_WIDTH/4.0f, ARENA_HEIGHT + (PLAYING_AREA_HEIGHT-ARENA_HEIGHT)/2.0f };
-    draw_text_centered(buffer, cursor, 1, COLOR_WHITE, cmd_buffer);
+    PowerUpPool *pool = &game_state->power_ups;
+    for(int index = 0; index < pool->count; index++) {
+      Rect rect = { .pos = { pool->pos_x[index], pool->pos_y[index] }, .dim = { POWER_UP_WIDTH, POWER_UP_HEIGHT } };
+      draw_rectangle_offset(rect, arena_offset, power_up_colors[pool->type[index]], cmd_buffer);
+    }
   }
 
-  // NOTE(leo): Draw ball count
+  // NOTE(leo): Draw balls
+  if((game_state->state == GAME_STATE_WAIT_SERVE) || (game_state->state == GAME_STATE_PLAYING)
+    || (game_state->state == GAME_STATE_GAME_OVER) || (game_state->state == GAME_STATE_PAUSE))
   {
-    char buffer[4];
-    buffer[0] = (game_state->balls_remaining / 100) % 10 + '0';
-    buffer[1] = (game_state->balls_remaining / 10) % 10 + '0';
-    buffer[2] = (game_state->balls_remaining / 1) % 10 + '0';
-    buffer[3] = 0;
-    V2 cursor = (V2){ 2.0f + ARENA_WIDTH/2.0f - ARENA_WIDTH/4.0f, ARENA_HEIGHT + (PLAYING_AREA_HEIGHT-ARENA_HEIGHT)/2.0f };
-    draw_text_centered(buffer, cursor, 1, COLOR_WHITE, cmd_buffer);
+    for(int ball_index = 0; ball_index < game_state->ball_count; ball_index++)
+      draw_rectangle_offset(game_state->balls[ball_index].rect, arena_offset, BALL_COLOR, cmd_buffer);
   }
 }
 
@@ -2,17 +2,12 @@
 
 #include "util.h"
 #include "renderer.h"
+#include "particles.h"
+#include "power_ups.h"
+#include "levels.h"
+#include "spsc_queue.h"
 
-#define BRICK_COUNT_X 14
-#define BRICK_COUNT_Y 8
-#define BRICK_COUNT (BRICK_COUNT_X*BRICK_COUNT_Y)
-#define FIRST_BRICK_HEIGHT 90.0f
-#define BRICK_WIDTH 7.0f
-#define BRICK_HEIGHT 2.0f
-#define BRICK_DELTA_X 1.0f
-#define BRICK_DELTA_Y 0.8f
-
-#define PADDLE_WIDTH(difficulty_factor) (7.0f/difficulty_factor)
+#define PADDLE_WIDTH 7.0f // NOTE(leo): Default, see GameTuning
 #define PADDLE_HEIGTH 3.0f
 #define PADDLE_Y 6.0f
 
@@ -23,8 +18,8 @@
 
 #define BALL_COLOR ((Color){ 0.82f, 0.82f, 0.82f, 1.0f })
 
-#define ARENA_WIDTH (BRICK_COUNT_X*BRICK_WIDTH + (BRICK_COUNT_X+1)*BRICK_DELTA_X)
-#define ARENA_HEIGHT 140.0f
+#define MAX_BALL_COUNT 8
+
 #define PLAYING_AREA_WIDTH (ARENA_WIDTH + 4.0f)
 #define PLAYING_AREA_HEIGHT (ARENA_HEIGHT + 2.0f + 20.0f)
 
@@ -35,6 +30,15 @@
 #define BALL_SPEED_2 75.0f
 #define BALL_SPEED_3 100.0f
 #define BALL_SPEED_4 125.0f
+// NOTE(leo): Paddle, wall and brick hits within a round until the ball speeds up to BALL_SPEED_2 and BALL_SPEED_3
+#define BALL_SPEED_2_HIT_COUNT 4
+#define BALL_SPEED_3_HIT_COUNT 12
+
+// NOTE(leo): One in this many broken bricks drops a power-up
+#define POWER_UP_DROP_ONE_IN 8
+#define POWER_UP_DURATION 10.0f
+#define POWER_UP_WIDE_PADDLE_FACTOR 1.5f
+#define POWER_UP_SLOW_BALL_FACTOR 0.6f
 
 enum {
   GAME_STATE_UNINITIALIZED = 0,
@@ -74,42 +78,230 @@ enum {
     NOTE(leo): reset_game goes to main menu if game_state->is_switching_to_main_menu is true
 */
 
+enum {
+  EDGE_LEFT = 1<<0,
+  EDGE_BOTTOM = 1<<1,
+  EDGE_RIGHT = 1<<2,
+  EDGE_TOP = 1<<3
+};
+
+enum {
+  GAME_EVENT_BRICK_HIT, // NOTE(leo): The hit broke it
+  GAME_EVENT_WALL_HIT,
+  GAME_EVENT_PADDLE_HIT,
+  GAME_EVENT_ROUND_OVER,
+  GAME_EVENT_BALL_LOST, // NOTE(leo): One of several balls, the round goes on
+  GAME_EVENT_POWER_UP_COLLECTED,
+  GAME_EVENT_BRICK_DAMAGED, // NOTE(leo): Hit, but it has hit points left
+
+  GAME_EVENT_TYPE_COUNT,
+};
+
+typedef struct GameEvent {
+  U8 type;
+  U8 edges; // NOTE(leo): Wall and paddle hits. EDGE_* of the wall or paddle that was hit
+  union {
+    U16 brick_index; // NOTE(leo): Brick hits and damage
+    U16 power_up_type; // NOTE(leo): Power-ups collected
+  };
+  V2 pos; // NOTE(leo): Ball center at the time of the event, arena space
+} GameEvent;
+
+// NOTE(leo): Power of two
+#define GAME_EVENT_CAPACITY 256
+
+/*
+  Physics only records what happened (GameEvent), scoring and effects are applied from the events after the substep
+  loop. The ring is never consumed: each consumer keeps its own read index and walks up to write_index in a batch, so
+  consumers can run at different rates (eg: gameplay after every physics step, audio once per frame). When a consumer
+  falls more than GAME_EVENT_CAPACITY behind, the oldest events are lost to it (see game_events_catch_up).
+*/
+typedef struct GameEventRing {
+  GameEvent events[GAME_EVENT_CAPACITY];
+  U32 write_index; // NOTE(leo): Runs freely, masked when indexing
+} GameEventRing;
+
+inline
+GameEvent *game_event_at(GameEventRing *ring, U32 index)
+{
+  return &ring->events[index & (GAME_EVENT_CAPACITY - 1)];
+}
+
+// NOTE(leo): Moves read_index up to the oldest event still in the ring. Returns the number of events skipped
+inline
+U32 game_events_catch_up(GameEventRing *ring, U32 *read_index)
+{
+  U32 pending_count = ring->write_index - *read_index;
+  if(pending_count <= GAME_EVENT_CAPACITY)
+    return 0;
+  *read_index = ring->write_index - GAME_EVENT_CAPACITY;
+  return pending_count - GAME_EVENT_CAPACITY;
+}
+
+// NOTE(leo): The numbers that make the game hard or easy. The defines above are the defaults (see default_game_tuning)
+typedef struct GameTuning {
+  F32 paddle_width; // NOTE(leo): At difficulty_factor 1, divided by it
+  F32 ball_speeds[4]; // NOTE(leo): Serve, after speed_up_hit_counts[0], [1] hits, after hitting an orange or red brick
+  int speed_up_hit_counts[2];
+} GameTuning;
+
+// NOTE(leo): Chunks go once their top is below this, well above the paddle. Low enough that the chunks there is room
+// for always reach above the arena
+#define SCROLL_FLOOR_Y 30.0f
+#define SCROLL_DEFAULT_SPEED 1.0f
+// NOTE(leo): Bricks of free chunk slots are parked up here, after every resident chunk, so the ring stays in two sorted
+// runs (see Level)
+#define SCROLL_FREE_SLOT_Y 1.0e9f
+
+/*
+  Scrolling mode: an endless brick field moving down at speed. GameState.level holds the chunks resident right now
+  (see level_generate_chunk), from the one just above the floor to one above the top of the arena. The slots are a
+  ring: a chunk that goes below SCROLL_FLOOR_Y frees its slot, which the next chunk streams into right away, so only
+  resident bricks are ever tested for collision and memory doesn't grow however far the field goes. Chunk n is slot
+  n%SCROLL_CHUNK_COUNT.
+
+  Bricks left when their chunk goes are gone, no penalty. Clearing every resident brick doesn't end anything, more keep
+  coming.
+
+  NOTE(leo): Bricks move in a step before the physics of each frame. Collision and predict_ball_at_paddle treat them
+  as standing still, fine at the slow speeds this is meant for.
+*/
+typedef struct ScrollField {
+  F32 speed; // NOTE(leo): Arena units per second. Zero: not scrolling (the normal game)
+  U32 seed;
+  U32 first_chunk_index; // NOTE(leo): Lowest resident chunk. Chunk indices count up forever
+  U32 next_chunk_index; // NOTE(leo): Streamed in next
+  F32 first_chunk_y; // NOTE(leo): Bottom of the lowest resident chunk
+} ScrollField;
+
+typedef struct Ball {
+  Rect rect;
+  V2 direction;
+  F32 speed;
+} Ball;
+
 typedef struct GameState {
   int state;
 
   // NOTE(leo): "Objects"
-  Rect ball;
-  V2 ball_direction;
-  F32 ball_speed;
+  int ball_count;
+  Ball balls[MAX_BALL_COUNT];
   F32 target_ball_speed;
 
   Rect paddle;
   bool is_paddle_shrunk;
 
-  bool is_brick_broken[BRICK_COUNT];
+  U8 brick_hps[MAX_BRICK_COUNT]; // NOTE(leo): Hits left of the level's bricks, 0: broken
   int bricks_remaining;
 
+  F32 wide_paddle_time; // NOTE(leo): Seconds left, power-up active while positive
+  F32 slow_ball_time;
+
   // NOTE(leo): Gameplay
+  GameTuning tuning; // NOTE(leo): Zero before the first game_update sets the defaults; set it before to tune
   F32 difficulty_factor;
   int score;
   int hit_count;
   int balls_remaining;
   bool has_cleared_bricks;
 
+  // NOTE(leo): Optional, read only (shared by copies of the game state). Without a pack both sets are the default
+  // level; with one a game plays first_level_index and the level after it
+  LevelPack *level_pack;
+  int first_level_index;
+  int level_index; // NOTE(leo): -1 while playing a generated level
+
+  // NOTE(leo): Endless mode: every clear goes on to the next level of generated_levels (Level elements made on
+  // another thread, see level_generate_valid; this game state is the consumer) instead of ending the game after the
+  // second set. If none is ready yet, or without a queue, the cleared level is played again rather than waiting
+  bool is_endless;
+  SpscQueue *generated_levels;
+  int generated_level_miss_count; // NOTE(leo): Clears that found no level ready
+
+  // NOTE(leo): Set scroll.speed and scroll.seed before the first game_update for scrolling mode (sets and levels don't
+  // apply then)
+  ScrollField scroll;
+
   // NOTE(leo): Animation
-  F32 brick_alpha[BRICK_COUNT];
+  F32 brick_alpha[MAX_BRICK_COUNT];
   bool is_switching_to_main_menu;
   bool is_erasing_score;
+
+  // NOTE(leo): Rendering. Bumped whenever arena, bricks or HUD change
+  U32 static_layer_version;
+
+  // NOTE(leo): Nonzero. Zero before the first game_update seeds it from the clock; set it before to replay a game
+  U32 random_state;
+
+  // NOTE(leo): Big and mostly unused members last, so game_state_copy can skip the unused parts
+  Level level; // NOTE(leo): Bricks of the current set
+  PowerUpPool power_ups;
+  GameEventRing events;
 } GameState;
 
+#define MAX_PADDLE_SAMPLE_COUNT 64
+
+typedef struct PaddleSample {
+  F32 time; // NOTE(leo): Seconds since the start of the frame
+  F32 paddle_control;
+} PaddleSample;
+
 typedef struct Input {
-  F32 paddle_control; // NOTE(leo): Ranges 0-1; negative value indicates "no user input"
+  F32 paddle_control; // NOTE(leo): Ranges 0-1, at the start of the frame; negative value indicates "no user input"
+
+  // NOTE(leo): Optional. Newer paddle_control values, sorted by the time they were taken at. The physics switch to each
+  // one at its time instead of only seeing the paddle target once per frame
+  int paddle_sample_count;
+  PaddleSample paddle_samples[MAX_PADDLE_SAMPLE_COUNT];
 } Input;
 
-void game_update(GameState *game_state, F32 dt, Input *input, RenderCmdBuffer *cmd_buffer);
+/*
+  Draws arena, bricks and HUD into static_layer only if they changed since static_layer was last built (see
+  GameState.static_layer_version). Everything that moves (paddle, balls, power-ups, particles) goes to cmd_buffer every frame.
+
+  particles is optional (NULL: no effects, eg: headless runs). It isn't part of GameState so copying a GameState stays
+  cheap.
+
+  static_layer and cmd_buffer may both be NULL to skip drawing altogether (headless runs, eg: bots, simulations).
+
+  Hits of this update are left in game_state->events for consumers outside the game (audio, telemetry).
+*/
+void game_update(GameState *game_state, F32 dt, Input *input, ParticleSystem *particles, RenderLayer *static_layer, RenderCmdBuffer *cmd_buffer);
 
 void game_serve(GameState *game_state);
 
+GameTuning default_game_tuning(void);
+
+// NOTE(leo): Copies everything the game needs to continue exactly like source would (eg: to try out moves), but only
+// the bricks the level has, the live power-ups, and none of the events: dest's event ring starts out empty at source's
+// write index. The copy doesn't get generated_levels, it would take levels meant for source
+void game_state_copy(GameState *dest, GameState *source);
+
+typedef struct BallPrediction {
+  bool is_valid; // NOTE(leo): False if the ball won't come back to the paddle (eg: it's below the paddle already)
+  F32 time; // NOTE(leo): Seconds from now
+  V2 pos; // NOTE(leo): Bottom left of the ball when its bottom reaches the paddle top
+} BallPrediction;
+
+// NOTE(leo): Where and when the ball next comes down to the paddle, bouncing off walls and live bricks. Doesn't change
+// game_state. A few microseconds
+BallPrediction predict_ball_at_paddle(GameState *game_state, int ball_index);
+
+typedef struct BrickHits {
+  F32 time;
+  int count;
+  int indices[3];
+  U8 edges[3];
+} BrickHits;
+
+// NOTE(leo): The collision sweep over one sorted run of a brick table (see Level): bricks [begin, end) of brick_rects,
+// sorted by pos.y and none taller than max_brick_height, the ones with hit points left in brick_hps. Earlier impacts
+// of ball moving by ball_delta replace the ones in hits, impacts at the same time add to them (up to 3). Finds the
+// first brick that can reach the ball with a binary search, so it takes about as long for 100 bricks as for 100000
+void sweep_brick_run(BrickHits *hits, Rect *brick_rects, U8 *brick_hps, int begin, int end, F32 max_brick_height,
+  Rect ball, V2 ball_delta);
+
+
 Rect compute_playing_area(V2 image_size);
 
 Rect compute_paddle_rect_in_image(GameState *game_state, Rect playing_area);
@@ -120,6 +312,10 @@ void draw_text_centered(char *text, V2 center, F32 pixel_size, Color color, Rend
 
 void switch_to_reset_game(GameState *game_state, bool then_switch_to_main_menu, bool erase_score);
 
+// NOTE(leo): Decodes level level_index of the pack (wrapping around at the end), or makes the default level without a
+// pack or if the pack's level is broken. Returns false if that level is loaded already. Leaves brick_hps as they are
+bool select_level(GameState *game_state, int level_index);
+
 #define SYMBOL_WIDTH 5
 #define SYMBOL_HEIGHT 7
 #define SYMBOL_SPACING 1
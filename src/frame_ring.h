@@ -0,0 +1,136 @@
+#pragma once
+
+#include "util.h"
+#include "renderer.h"
+
+#include <intrin.h>
+#include <string.h>
+
+/*
+  Ring of finished frames in shared memory (FRAME_RING_NAME), for other processes to record or analyse: the static
+  layer's and the frame's render commands, and the size of the window they were drawn for. One producer (the game with
+  "-frame_ring", or breakout_tools publish_frames), any number of readers, none of which the producer ever waits for.
+
+  Frame n goes into slot n%FRAME_RING_SLOT_COUNT. Each slot has a sequence (a seqlock): odd while the producer writes
+  the slot, 2*(n + 1) once frame n is in it. Readers read frames in place, without copying them out, and check the
+  sequence is still the same after (frame_ring_begin_read, frame_ring_end_read). If it isn't, the producer lapped the
+  reader and what it read is torn; a reader more than FRAME_RING_SLOT_COUNT frames behind misses frames, it never holds
+  up the producer.
+
+  Dropped frames are counted in the ring, for both sides to see: frames with more commands than a slot holds (not
+  published, their slot doesn't get frame n), frames overwritten before the reader that reports how far it got
+  (reader_frame_index) read them, and the frames that reader dropped by its own count (skipped to catch up, torn).
+
+  NOTE(leo): Relies on x64 store ordering plus compiler barriers, like spsc_queue.h. The ring is shared between
+  processes: no pointers in it, and new versions may only add to the end of the header.
+*/
+#define FRAME_RING_NAME "Local\\breakout_frame_ring"
+#define FRAME_RING_MAGIC 0x52464C42 // NOTE(leo): "BLFR"
+#define FRAME_RING_VERSION 1
+#define FRAME_RING_SLOT_COUNT 8 // NOTE(leo): Power of two
+#define FRAME_RING_SLOT_COMMAND_COUNT 32768 // NOTE(leo): A MB a slot. Particles are capped at half of it
+
+typedef struct FrameRingSlot {
+  volatile U32 sequence;
+  U32 static_count; // NOTE(leo): commands[0, static_count) are the static layer's, the frame's after
+  U32 count;
+  U32 static_layer_version; // NOTE(leo): Readers can skip the static commands while it stays the same
+  U64 frame_index;
+  V2 viewport; // NOTE(leo): Window client size, pixels
+  F32 dt;
+  U32 reserved;
+  RectangleCmd commands[FRAME_RING_SLOT_COMMAND_COUNT];
+} FrameRingSlot;
+
+typedef struct FrameRing {
+  U32 magic;
+  U32 version;
+  U32 slot_count;
+  U32 slot_command_count;
+
+  // NOTE(leo): Producer only
+  U8 padding0[64];
+  volatile U64 published_count; // NOTE(leo): Index of the next frame. The last FRAME_RING_SLOT_COUNT may be in the ring
+  volatile U64 too_big_count;
+  volatile U64 overwritten_count;
+
+  // NOTE(leo): Reader only
+  U8 padding1[64];
+  volatile U64 reader_frame_index; // NOTE(leo): The first frame the reader hasn't read yet, plus one. 0: no reader
+  volatile U64 reader_dropped_count; // NOTE(leo): Frames it skipped, or found overwritten or torn
+
+  U8 padding2[64];
+  FrameRingSlot slots[FRAME_RING_SLOT_COUNT];
+} FrameRing;
+
+// NOTE(leo): Producer. ring is the zeroed (or previously used) shared memory
+inline
+void frame_ring_init(FrameRing *ring)
+{
+  memset(ring, 0, sizeof(FrameRing) - sizeof(ring->slots));
+  for(int slot_index = 0; slot_index < FRAME_RING_SLOT_COUNT; slot_index++)
+    ring->slots[slot_index].sequence = 0;
+  ring->slot_count = FRAME_RING_SLOT_COUNT;
+  ring->slot_command_count = FRAME_RING_SLOT_COMMAND_COUNT;
+  ring->version = FRAME_RING_VERSION;
+  _ReadWriteBarrier();
+  ring->magic = FRAME_RING_MAGIC;
+}
+
+// NOTE(leo): Producer. Copies the frame into the next slot, never waits. False if it has too many commands
+inline
+bool frame_ring_publish(FrameRing *ring, RenderLayer *static_layer, RenderCmdBuffer *cmd_buffer, V2 viewport, F32 dt)
+{
+  U64 frame_index = ring->published_count;
+  U32 static_count = (U32)static_layer->cmd_buffer.count;
+  U32 count = static_count + (U32)cmd_buffer->count;
+  if(count > FRAME_RING_SLOT_COMMAND_COUNT) {
+    ring->too_big_count++;
+    ring->published_count = frame_index + 1;
+    return false;
+  }
+
+  // NOTE(leo): The frame this slot had, unless the reporting reader is past it
+  U64 reader_frame_index = ring->reader_frame_index;
+  if(reader_frame_index && frame_index >= FRAME_RING_SLOT_COUNT
+    && reader_frame_index - 1 <= frame_index - FRAME_RING_SLOT_COUNT)
+    ring->overwritten_count++;
+
+  FrameRingSlot *slot = &ring->slots[frame_index & (FRAME_RING_SLOT_COUNT - 1)];
+  slot->sequence = (U32)(2*frame_index + 1);
+  _ReadWriteBarrier();
+  slot->static_count = static_count;
+  slot->count = count;
+  slot->static_layer_version = static_layer->version;
+  slot->frame_index = frame_index;
+  slot->viewport = viewport;
+  slot->dt = dt;
+  memcpy(slot->commands, static_layer->cmd_buffer.commands, static_count*sizeof(RectangleCmd));
+  memcpy(slot->commands + static_count, cmd_buffer->commands, cmd_buffer->count*sizeof(RectangleCmd));
+  _ReadWriteBarrier();
+  slot->sequence = (U32)(2*frame_index + 2);
+  _ReadWriteBarrier();
+  ring->published_count = frame_index + 1;
+  return true;
+}
+
+// NOTE(leo): Reader. Frame frame_index's slot, or NULL if the frame isn't in it (not published yet, too big, or
+// overwritten already). Read it in place, then check with frame_ring_end_read
+inline
+FrameRingSlot *frame_ring_begin_read(FrameRing *ring, U64 frame_index, U32 *sequence)
+{
+  FrameRingSlot *slot = &ring->slots[frame_index & (FRAME_RING_SLOT_COUNT - 1)];
+  *sequence = slot->sequence;
+  _ReadWriteBarrier();
+  if(*sequence != (U32)(2*frame_index + 2))
+    return NULL;
+  return slot;
+}
+
+// NOTE(leo): Reader. False if the producer started overwriting the slot while it was read: what was read is torn
+inline
+bool frame_ring_end_read(FrameRingSlot *slot, U32 sequence)
+{
+  _ReadWriteBarrier();
+  return slot->sequence == sequence;
+}
@@ -0,0 +1,351 @@
+#include "levels.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+global_variable Color default_brick_colors[BRICK_TYPE_COUNT] = {
+  { 0.77f, 0.78f, 0.09f, 1.0f }, { 0.0f, 0.5f, 0.13f, 1.0f }, { 0.76f, 0.51f, 0.0f, 1.0f }, { 0.63f, 0.04f, 0.0f, 1.0f },
+};
+global_variable U16 default_brick_scores[BRICK_TYPE_COUNT] = { 1, 3, 5, 7 };
+
+void level_make_default(Level *level)
+{
+  level->brick_count = BRICK_COUNT;
+  level->sorted_split_index = 0;
+  for(int brick_index = 0; brick_index < BRICK_COUNT; brick_index++) {
+    int x = brick_index%BRICK_COUNT_X;
+    int y = brick_index/BRICK_COUNT_X;
+    level->brick_rects[brick_index] = (Rect){
+      .pos = { BRICK_DELTA_X + (BRICK_WIDTH + BRICK_DELTA_X)*x, FIRST_BRICK_HEIGHT + (BRICK_HEIGHT + BRICK_DELTA_Y)*y },
+      .dim = { BRICK_WIDTH, BRICK_HEIGHT },
+    };
+    level->brick_types[brick_index] = (U8)(y/2);
+    level->brick_max_hps[brick_index] = 1;
+    level->brick_scores[brick_index] = default_brick_scores[y/2];
+    level->brick_colors[brick_index] = color_pack(default_brick_colors[y/2]);
+  }
+  level_compute_bounds(level);
+}
+
+void level_copy(Level *dest, Level *source)
+{
+  int count = source->brick_count;
+  dest->brick_count = count;
+  dest->sorted_split_index = source->sorted_split_index;
+  dest->bounds = source->bounds;
+  dest->max_brick_height = source->max_brick_height;
+  memcpy(dest->brick_rects, source->brick_rects, count*sizeof(Rect));
+  memcpy(dest->brick_types, source->brick_types, count*sizeof(U8));
+  memcpy(dest->brick_max_hps, source->brick_max_hps, count*sizeof(U8));
+  memcpy(dest->brick_scores, source->brick_scores, count*sizeof(U16));
+  memcpy(dest->brick_colors, source->brick_colors, count*sizeof(U32));
+}
+
+void level_compute_bounds(Level *level)
+{
+  if(!level->brick_count) {
+    level->bounds = (Rect){ 0 };
+    level->max_brick_height = 0.0f;
+    return;
+  }
+  V2 min = level->brick_rects[0].pos;
+  V2 max = v2_add(min, level->brick_rects[0].dim);
+  F32 max_height = level->brick_rects[0].dim.y;
+  for(int brick_index = 1; brick_index < level->brick_count; brick_index++) {
+    Rect rect = level->brick_rects[brick_index];
+    min.x = fminf(min.x, rect.pos.x);
+    min.y = fminf(min.y, rect.pos.y);
+    max.x = fmaxf(max.x, rect.pos.x + rect.dim.x);
+    max.y = fmaxf(max.y, rect.pos.y + rect.dim.y);
+    max_height = fmaxf(max_height, rect.dim.y);
+  }
+  level->bounds = (Rect){ .pos = min, .dim = v2_sub(max, min) };
+  level->max_brick_height = max_height;
+}
+
+void level_sort_bricks(Level *level)
+{
+  // NOTE(leo): Insertion sort: packs are written a row at a time, so they're sorted already or close to it
+  for(int brick_index = 1; brick_index < level->brick_count; brick_index++) {
+    Rect rect = level->brick_rects[brick_index];
+    U8 type = level->brick_types[brick_index];
+    U8 max_hp = level->brick_max_hps[brick_index];
+    U16 score = level->brick_scores[brick_index];
+    U32 color = level->brick_colors[brick_index];
+    int index = brick_index;
+    for(; index > 0 && level->brick_rects[index - 1].pos.y > rect.pos.y; index--) {
+      level->brick_rects[index] = level->brick_rects[index - 1];
+      level->brick_types[index] = level->brick_types[index - 1];
+      level->brick_max_hps[index] = level->brick_max_hps[index - 1];
+      level->brick_scores[index] = level->brick_scores[index - 1];
+      level->brick_colors[index] = level->brick_colors[index - 1];
+    }
+    level->brick_rects[index] = rect;
+    level->brick_types[index] = type;
+    level->brick_max_hps[index] = max_hp;
+    level->brick_scores[index] = score;
+    level->brick_colors[index] = color;
+  }
+  level->sorted_split_index = 0;
+}
+
+internal
+U32 level_random(U32 *state)
+{
+  U32 x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+// NOTE(leo): Spreads nearby inputs (eg: consecutive level indices) over all bits
+internal
+U32 level_hash(U32 x)
+{
+  x ^= x >> 16;
+  x *= 0x7FEB352D;
+  x ^= x >> 15;
+  x *= 0x846CA68B;
+  x ^= x >> 16;
+  return x;
+}
+
+enum {
+  LEVEL_PATTERN_RANDOM,
+  LEVEL_PATTERN_CHECKER,
+  LEVEL_PATTERN_DIAMOND,
+  LEVEL_PATTERN_COLUMNS,
+
+  LEVEL_PATTERN_COUNT,
+};
+
+void level_generate(Level *level, U32 seed)
+{
+  U32 random_state = level_hash(seed) | 1;
+
+  // NOTE(leo): Columns are mirrored around the middle, so only the left half (and the middle column) is chosen
+  int column_count = 6 + level_random(&random_state)%11;
+  int row_count = 4 + level_random(&random_state)%9;
+  if(column_count*row_count > MAX_BRICK_COUNT)
+    row_count = MAX_BRICK_COUNT/column_count;
+  F32 delta_x = 1.0f;
+  F32 delta_y = 0.8f;
+  F32 brick_width = (ARENA_WIDTH - (column_count + 1)*delta_x)/column_count;
+  F32 brick_height = 1.5f + (F32)(level_random(&random_state)%4)*0.5f;
+  F32 first_y = LEVEL_MIN_BRICK_Y + (F32)(level_random(&random_state)%41);
+
+  int pattern = level_random(&random_state)%LEVEL_PATTERN_COUNT;
+  U32 fill_percent = 50 + level_random(&random_state)%46;
+  int half_column_count = (column_count + 1)/2;
+  // NOTE(leo): Red bricks take two hits in half the levels
+  U8 red_hp = (U8)(1 + level_random(&random_state)%2);
+
+  level->brick_count = 0;
+  level->sorted_split_index = 0;
+  for(int row = 0; row < row_count; row++) {
+    // NOTE(leo): Decided for the left half only, the right half mirrors it
+    bool is_filled[8];
+    for(int column = 0; column < half_column_count; column++) {
+      int center_distance = abs(2*column - (column_count - 1)) + abs(2*row - (row_count - 1));
+      switch(pattern) {
+        case LEVEL_PATTERN_RANDOM: is_filled[column] = level_random(&random_state)%100 < fill_percent; break;
+        case LEVEL_PATTERN_CHECKER: is_filled[column] = ((row + column)&1) == 0; break;
+        case LEVEL_PATTERN_DIAMOND: is_filled[column] = center_distance <= (column_count + row_count)/2; break;
+        case LEVEL_PATTERN_COLUMNS: is_filled[column] = (column%3) != 2; break;
+      }
+    }
+
+    U8 type = (U8)(row*BRICK_TYPE_COUNT/row_count);
+    for(int column = 0; column < column_count; column++) {
+      int half_column = column < half_column_count ? column : column_count - 1 - column;
+      if(!is_filled[half_column])
+        continue;
+      int brick_index = level->brick_count++;
+      level->brick_rects[brick_index] = (Rect){
+        .pos = { delta_x + (brick_width + delta_x)*column, first_y + (brick_height + delta_y)*row },
+        .dim = { brick_width, brick_height },
+      };
+      level->brick_types[brick_index] = type;
+      level->brick_max_hps[brick_index] = type == BRICK_TYPE_COUNT - 1 ? red_hp : 1;
+      level->brick_scores[brick_index] = default_brick_scores[type];
+      level->brick_colors[brick_index] = color_pack(default_brick_colors[type]);
+    }
+  }
+  level_compute_bounds(level);
+}
+
+bool level_is_valid(Level *level)
+{
+  if(level->brick_count < LEVEL_MIN_BRICK_COUNT || level->brick_count > MAX_BRICK_COUNT)
+    return false;
+  Rect bounds = level->bounds;
+  if(bounds.pos.x < 0.0f || bounds.pos.y < LEVEL_MIN_BRICK_Y
+    || bounds.pos.x + bounds.dim.x > ARENA_WIDTH || bounds.pos.y + bounds.dim.y > ARENA_HEIGHT)
+    return false;
+
+  for(int a = 0; a < level->brick_count; a++) {
+    Rect rect_a = level->brick_rects[a];
+    for(int b = a + 1; b < level->brick_count; b++) {
+      Rect rect_b = level->brick_rects[b];
+      if(rect_a.pos.x < rect_b.pos.x + rect_b.dim.x && rect_b.pos.x < rect_a.pos.x + rect_a.dim.x
+        && rect_a.pos.y < rect_b.pos.y + rect_b.dim.y && rect_b.pos.y < rect_a.pos.y + rect_a.dim.y)
+        return false;
+    }
+  }
+  return true;
+}
+
+int level_generate_valid(Level *level, U32 seed, U32 level_index)
+{
+  int attempt_count = 0;
+  for(;;) {
+    U32 attempt_seed = level_hash(seed ^ level_hash(level_index ^ level_hash((U32)attempt_count)));
+    attempt_count++;
+    level_generate(level, attempt_seed);
+    if(level_is_valid(level))
+      return attempt_count;
+    // NOTE(leo): About 1.1 seeds per level (see bench_generator). Keeps a run of bad seeds from ever hanging
+    if(attempt_count == 64) {
+      level_make_default(level);
+      return attempt_count;
+    }
+  }
+}
+
+U32 level_generate_chunk(Level *level, int slot_index, U32 seed, U32 chunk_index, F32 bottom_y)
+{
+  U32 random_state = level_hash(seed ^ level_hash(chunk_index)) | 1;
+  F32 brick_width = (ARENA_WIDTH - (SCROLL_CHUNK_COLUMN_COUNT + 1)*BRICK_DELTA_X)/SCROLL_CHUNK_COLUMN_COUNT;
+  U32 fill_percent = 60 + level_random(&random_state)%36;
+
+  U32 result = 0;
+  int first_brick_index = slot_index*SCROLL_CHUNK_BRICK_COUNT;
+  // NOTE(leo): Two rows of a type going up, like the classic layout. Red ones take two hits
+  U8 type = (U8)(chunk_index%BRICK_TYPE_COUNT);
+  U8 max_hp = type == BRICK_TYPE_COUNT - 1 ? 2 : 1;
+  for(int row = 0; row < SCROLL_CHUNK_ROW_COUNT; row++) {
+    for(int column = 0; column < SCROLL_CHUNK_COLUMN_COUNT; column++) {
+      int chunk_brick_index = row*SCROLL_CHUNK_COLUMN_COUNT + column;
+      int brick_index = first_brick_index + chunk_brick_index;
+      level->brick_rects[brick_index] = (Rect){
+        .pos = { BRICK_DELTA_X + (brick_width + BRICK_DELTA_X)*column, bottom_y + (BRICK_HEIGHT + BRICK_DELTA_Y)*row },
+        .dim = { brick_width, BRICK_HEIGHT },
+      };
+      level->brick_types[brick_index] = type;
+      level->brick_max_hps[brick_index] = max_hp;
+      level->brick_scores[brick_index] = default_brick_scores[type];
+      level->brick_colors[brick_index] = color_pack(default_brick_colors[type]);
+
+      // NOTE(leo): Mirrored, like level_generate
+      if(column < SCROLL_CHUNK_COLUMN_COUNT/2) {
+        if(level_random(&random_state)%100 < fill_percent)
+          result |= (1u << chunk_brick_index) | (1u << (row*SCROLL_CHUNK_COLUMN_COUNT + SCROLL_CHUNK_COLUMN_COUNT - 1 - column));
+      }
+    }
+  }
+  return result;
+}
+
+bool level_pack_open(LevelPack *pack, void *data, U64 size)
+{
+  memset(pack, 0, sizeof(*pack));
+
+  LevelPackHeader *header = data;
+  if(size < sizeof(LevelPackHeader) || header->magic != LEVEL_PACK_MAGIC)
+    return false;
+  if(header->version < 1 || header->version > LEVEL_PACK_VERSION)
+    return false;
+  U32 min_brick_size = header->version == 1 ? LEVEL_PACK_V1_BRICK_SIZE : sizeof(LevelPackBrick);
+  if(header->brick_size < min_brick_size)
+    return false;
+  U64 index_size = (U64)header->level_count*sizeof(LevelPackEntry);
+  if(header->index_offset > size || index_size > size - header->index_offset)
+    return false;
+
+  pack->data = data;
+  pack->size = size;
+  pack->version = header->version;
+  pack->level_count = header->level_count;
+  pack->brick_size = header->brick_size;
+  pack->index = (LevelPackEntry *)(pack->data + header->index_offset);
+  return true;
+}
+
+bool level_pack_decode(LevelPack *pack, int level_index, Level *level)
+{
+  if(level_index < 0 || (U32)level_index >= pack->level_count)
+    return false;
+
+  LevelPackEntry entry = pack->index[level_index];
+  if(entry.brick_count > MAX_BRICK_COUNT)
+    return false;
+  U64 level_size = (U64)entry.brick_count*pack->brick_size;
+  if(entry.offset > pack->size || level_size > pack->size - entry.offset)
+    return false;
+
+  level->brick_count = entry.brick_count;
+  U8 *at = pack->data + entry.offset;
+  for(U32 brick_index = 0; brick_index < entry.brick_count; brick_index++, at += pack->brick_size) {
+    // NOTE(leo): Version 1 bricks end before score
+    LevelPackBrick brick = { 0 };
+    memcpy(&brick, at, pack->version == 1 ? LEVEL_PACK_V1_BRICK_SIZE : sizeof(brick));
+
+    // NOTE(leo): Also false for NaNs
+    bool is_inside = brick.x >= 0.0f && brick.y >= 0.0f && brick.width > 0.0f && brick.height > 0.0f
+      && brick.x + brick.width <= ARENA_WIDTH && brick.y + brick.height <= ARENA_HEIGHT;
+    if(!is_inside || brick.type >= BRICK_TYPE_COUNT || brick.hp == 0)
+      return false;
+
+    level->brick_rects[brick_index] = (Rect){ .pos = { brick.x, brick.y }, .dim = { brick.width, brick.height } };
+    level->brick_types[brick_index] = brick.type;
+    level->brick_max_hps[brick_index] = brick.hp;
+    level->brick_scores[brick_index] = pack->version == 1 ? default_brick_scores[brick.type] : brick.score;
+    level->brick_colors[brick_index] = brick.color;
+  }
+  level_sort_bricks(level);
+  level_compute_bounds(level);
+  return true;
+}
+
+U64 level_pack_compute_size(Level *levels, int level_count)
+{
+  U64 result = sizeof(LevelPackHeader) + (U64)level_count*sizeof(LevelPackEntry);
+  for(int level_index = 0; level_index < level_count; level_index++)
+    result += (U64)levels[level_index].brick_count*sizeof(LevelPackBrick);
+  return result;
+}
+
+void level_pack_write(Level *levels, int level_count, U8 *out)
+{
+  LevelPackHeader header = {
+    .magic = LEVEL_PACK_MAGIC,
+    .version = LEVEL_PACK_VERSION,
+    .level_count = level_count,
+    .brick_size = sizeof(LevelPackBrick),
+    .index_offset = sizeof(LevelPackHeader),
+  };
+  memcpy(out, &header, sizeof(header));
+
+  U64 offset = sizeof(LevelPackHeader) + (U64)level_count*sizeof(LevelPackEntry);
+  for(int level_index = 0; level_index < level_count; level_index++) {
+    Level *level = &levels[level_index];
+    LevelPackEntry entry = { .offset = offset, .brick_count = level->brick_count };
+    memcpy(out + header.index_offset + level_index*sizeof(LevelPackEntry), &entry, sizeof(entry));
+
+    for(int brick_index = 0; brick_index < level->brick_count; brick_index++) {
+      Rect rect = level->brick_rects[brick_index];
+      LevelPackBrick brick = {
+        .x = rect.pos.x, .y = rect.pos.y, .width = rect.dim.x, .height = rect.dim.y,
+        .type = level->brick_types[brick_index],
+        .hp = level->brick_max_hps[brick_index],
+        .color = level->brick_colors[brick_index],
+        .score = level->brick_scores[brick_index],
+      };
+      memcpy(out + offset, &brick, sizeof(brick));
+      offset += sizeof(brick);
+    }
+  }
+}
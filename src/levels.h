@@ -0,0 +1,175 @@
+#pragma once
+
+#include "util.h"
+
+#define MAX_BRICK_COUNT 256
+
+// NOTE(leo): The classic layout (see level_make_default)
+#define BRICK_COUNT_X 14
+#define BRICK_COUNT_Y 8
+#define BRICK_COUNT (BRICK_COUNT_X*BRICK_COUNT_Y)
+#define FIRST_BRICK_HEIGHT 90.0f
+#define BRICK_WIDTH 7.0f
+#define BRICK_HEIGHT 2.0f
+#define BRICK_DELTA_X 1.0f
+#define BRICK_DELTA_Y 0.8f
+
+#define ARENA_WIDTH (BRICK_COUNT_X*BRICK_WIDTH + (BRICK_COUNT_X+1)*BRICK_DELTA_X)
+#define ARENA_HEIGHT 140.0f
+
+#define BRICK_TYPE_COUNT 4
+
+/*
+  The brick table, one array per field. brick_rects is all the collision sweep reads (with the game's hit points), the
+  other arrays are only read once a brick is hit or drawn, so they stay out of the cache lines the sweep walks.
+
+  Bricks are sorted by pos.y (bottom first) in at most two runs: [0, sorted_split_index) and [sorted_split_index,
+  brick_count), sorted_split_index 0 meaning a single run. The sweep binary searches each run for the first brick that
+  could reach the ball instead of looking at every brick. level_pack_decode sorts, level_make_default and
+  level_generate come out sorted, the scrolling field keeps its chunk ring in two runs (see stream_scroll_chunks).
+*/
+typedef struct Level {
+  int brick_count;
+  int sorted_split_index;
+  Rect bounds; // NOTE(leo): Of all bricks (see level_compute_bounds)
+  F32 max_brick_height; // NOTE(leo): How far below a ball a brick's pos.y can be and still reach it
+  Rect brick_rects[MAX_BRICK_COUNT]; // NOTE(leo): Arena units, same as the game
+  U8 brick_types[MAX_BRICK_COUNT]; // NOTE(leo): Ball speed up and particles. 0: yellow ... 3: red
+  U8 brick_max_hps[MAX_BRICK_COUNT]; // NOTE(leo): Hits to break, at least 1
+  U16 brick_scores[MAX_BRICK_COUNT]; // NOTE(leo): Points for breaking it, before the difficulty factor
+  U32 brick_colors[MAX_BRICK_COUNT]; // NOTE(leo): 0xAABBGGRR (see color_pack), on the last hit point
+} Level;
+
+void level_make_default(Level *level);
+// NOTE(leo): Only the first brick_count bricks
+void level_copy(Level *dest, Level *source);
+// NOTE(leo): Bounds and max_brick_height. Call after changing brick_rects, level_make_default and level_pack_decode
+// already do
+void level_compute_bounds(Level *level);
+// NOTE(leo): Into a single sorted run (see Level). Stable, so bricks on a row keep their order
+void level_sort_bricks(Level *level);
+
+/*
+  Procedural levels. level_generate builds a layout from a seed alone (same seed, same layout): a mirrored grid of
+  bricks with a random size and pattern, brick types in bands from the bottom row up to the top. Not every layout
+  is playable, level_generate_valid tries seeds derived from (seed, level_index, attempt) until level_is_valid
+  passes, so the level_index-th level of a seed is always the same and can be generated on any thread.
+*/
+
+// NOTE(leo): Leave the ball room to come back down between the paddle and the lowest bricks
+#define LEVEL_MIN_BRICK_Y 60.0f
+#define LEVEL_MIN_BRICK_COUNT 24
+
+void level_generate(Level *level, U32 seed);
+// NOTE(leo): Enough bricks, all inside the arena above LEVEL_MIN_BRICK_Y, none overlapping
+bool level_is_valid(Level *level);
+// NOTE(leo): Returns the number of seeds tried
+int level_generate_valid(Level *level, U32 seed, U32 level_index);
+
+/*
+  Chunks of the scrolling brick field (see ScrollField): SCROLL_CHUNK_ROW_COUNT rows of SCROLL_CHUNK_COLUMN_COUNT
+  bricks of one type, the same rows as the classic layout but wider bricks, then an empty row. Chunk n of a seed is
+  always the same. A Level holds SCROLL_CHUNK_COUNT chunks at a time, chunk slot i in bricks
+  [i*SCROLL_CHUNK_BRICK_COUNT, (i+1)*SCROLL_CHUNK_BRICK_COUNT).
+*/
+#define SCROLL_CHUNK_ROW_COUNT 2
+#define SCROLL_CHUNK_COLUMN_COUNT 8
+#define SCROLL_CHUNK_BRICK_COUNT (SCROLL_CHUNK_ROW_COUNT*SCROLL_CHUNK_COLUMN_COUNT) // NOTE(leo): At most 32 (see level_generate_chunk)
+#define SCROLL_CHUNK_COUNT (MAX_BRICK_COUNT/SCROLL_CHUNK_BRICK_COUNT)
+#define SCROLL_CHUNK_HEIGHT ((SCROLL_CHUNK_ROW_COUNT + 1)*(BRICK_HEIGHT + BRICK_DELTA_Y))
+
+// NOTE(leo): Writes the bricks of chunk chunk_index into chunk slot slot_index, bottom row at bottom_y. Returns a mask
+// of the bricks that are there (bit i: brick i of the chunk), the others are holes
+U32 level_generate_chunk(Level *level, int slot_index, U32 seed, U32 chunk_index, F32 bottom_y);
+
+/*
+  Level pack file, version 2. Little endian, no padding:
+
+    LevelPackHeader
+    LevelPackEntry index[level_count], at header.index_offset
+    level data: brick_count LevelPackBrick per level, at entry.offset
+
+  Opening a pack (level_pack_open) only checks the header and that the index is inside the file, so it takes the same
+  time for any number of levels; a level is only looked at (and checked) when it's decoded. Meant to be memory mapped,
+  so nothing is read off disk before it's needed either.
+
+  NOTE(leo): New versions may only add to the end of these structs (and bump the version), so readers can keep
+  reading older packs. Version 2 added LevelPackBrick.score, version 1 bricks score what the classic
+  layout's bricks of their type do.
+*/
+#define LEVEL_PACK_MAGIC 0x4B504C42 // NOTE(leo): "BLPK"
+#define LEVEL_PACK_VERSION 2
+
+#pragma pack(push, 1)
+typedef struct LevelPackHeader {
+  U32 magic;
+  U32 version;
+  U32 level_count;
+  U32 brick_size; // NOTE(leo): sizeof(LevelPackBrick) of the writer, at least LEVEL_PACK_V1_BRICK_SIZE
+  U64 index_offset;
+} LevelPackHeader;
+
+typedef struct LevelPackEntry {
+  U64 offset;
+  U32 brick_count;
+  U32 reserved;
+} LevelPackEntry;
+
+typedef struct LevelPackBrick {
+  F32 x, y, width, height;
+  U8 type;
+  U8 hp;
+  U16 reserved;
+  U32 color;
+  // NOTE(leo): Version 2
+  U16 score;
+  U16 reserved2;
+} LevelPackBrick;
+#pragma pack(pop)
+
+#define LEVEL_PACK_V1_BRICK_SIZE 24
+
+/*
+  Level analysis file (see the analyse_levels tool), version 1. Little endian, no padding: LevelAnalysisHeader, then one
+  LevelAnalysis per level of the pack it was made from, in pack order (record_size bytes each, same rules as the pack
+  for new versions).
+*/
+#define LEVEL_ANALYSIS_MAGIC 0x414C4C42 // NOTE(leo): "BLLA"
+#define LEVEL_ANALYSIS_VERSION 1
+
+#pragma pack(push, 1)
+typedef struct LevelAnalysisHeader {
+  U32 magic;
+  U32 version;
+  U32 level_count;
+  U32 record_size; // NOTE(leo): sizeof(LevelAnalysis) of the writer
+  F32 aim_error; // NOTE(leo): Of the bot, see BotGame
+  F32 dt;
+} LevelAnalysisHeader;
+
+typedef struct LevelAnalysis {
+  U16 game_count; // NOTE(leo): 0: the level is broken (doesn't decode)
+  U16 clear_count; // NOTE(leo): Not 0: the level can be cleared
+  F32 par_time; // NOTE(leo): Seconds, of the fastest clear. 0 if never cleared
+  F32 mean_clear_time;
+} LevelAnalysis;
+#pragma pack(pop)
+
+// NOTE(leo): Doesn't own data. Read only after open, so any number of threads may decode from it
+typedef struct LevelPack {
+  U8 *data;
+  U64 size;
+  U32 version;
+  U32 level_count;
+  U32 brick_size;
+  LevelPackEntry *index;
+} LevelPack;
+
+bool level_pack_open(LevelPack *pack, void *data, U64 size);
+
+// NOTE(leo): False if the level data is broken (out of the file, out of the arena, bad type, ...)
+bool level_pack_decode(LevelPack *pack, int level_index, Level *level);
+
+U64 level_pack_compute_size(Level *levels, int level_count);
+// NOTE(leo): out must hold level_pack_compute_size bytes
+void level_pack_write(Level *levels, int level_count, U8 *out);
@@ -0,0 +1,108 @@
+#include "particles.h"
+
+#include <math.h>
+#include <emmintrin.h>
+
+// NOTE(leo): xorshift32. Own state so effects don't disturb the game's random sequence
+internal
+F32 particles_random_unilateral(ParticleSystem *particles)
+{
+  U32 x = particles->random_state;
+  if(!x)
+    x = 0x9E3779B9;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  particles->random_state = x;
+  return (F32)(x >> 8) * (1.0f/16777216.0f);
+}
+
+void particles_spawn_burst(ParticleSystem *particles, V2 pos, int count, F32 max_speed, F32 lifetime, Color color)
+{
+  U32 packed_color = color_pack(color);
+  F32 PI = 3.14159f;
+  for(int i = 0; i < count; i++) {
+    U32 slot = particles->spawn_cursor;
+    particles->spawn_cursor = (slot + 1) % PARTICLE_CAPACITY;
+
+    F32 angle = 2.0f*PI*particles_random_unilateral(particles);
+    F32 speed = max_speed*(0.5f + 0.5f*particles_random_unilateral(particles));
+    // NOTE(leo): Vary lifetimes a bit so a burst doesn't vanish all at once
+    F32 life = lifetime*(0.75f + 0.25f*particles_random_unilateral(particles));
+
+    particles->pos_x[slot] = pos.x;
+    particles->pos_y[slot] = pos.y;
+    particles->vel_x[slot] = speed*cosf(angle);
+    particles->vel_y[slot] = speed*sinf(angle);
+    particles->life[slot] = life;
+    particles->inv_lifetime[slot] = 1.0f/life;
+    particles->color[slot] = packed_color;
+
+    // NOTE(leo): Keep used_count a multiple of 4; slots in between are zero, ie: dead
+    if(slot >= particles->used_count)
+      particles->used_count = (slot + 4) & ~3u;
+  }
+}
+
+void particles_update(ParticleSystem *particles, F32 dt)
+{
+  local_persist U8 live_counts[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+  __m128 dt_4 = _mm_set1_ps(dt);
+  __m128 gravity_dt_4 = _mm_set1_ps(PARTICLE_GRAVITY*dt);
+  __m128 zero_4 = _mm_setzero_ps();
+
+  U32 live_count = 0;
+  for(U32 i = 0; i < particles->used_count; i += 4) {
+    __m128 pos_x = _mm_loadu_ps(particles->pos_x + i);
+    __m128 pos_y = _mm_loadu_ps(particles->pos_y + i);
+    __m128 vel_x = _mm_loadu_ps(particles->vel_x + i);
+    __m128 vel_y = _mm_loadu_ps(particles->vel_y + i);
+    __m128 life = _mm_loadu_ps(particles->life + i);
+
+    // NOTE(leo): Dead lanes get integrated too, cheaper than branching. Clamping life keeps them dead
+    vel_y = _mm_add_ps(vel_y, gravity_dt_4);
+    pos_x = _mm_add_ps(pos_x, _mm_mul_ps(vel_x, dt_4));
+    pos_y = _mm_add_ps(pos_y, _mm_mul_ps(vel_y, dt_4));
+    life = _mm_max_ps(_mm_sub_ps(life, dt_4), zero_4);
+
+    _mm_storeu_ps(particles->pos_x + i, pos_x);
+    _mm_storeu_ps(particles->pos_y + i, pos_y);
+    _mm_storeu_ps(particles->vel_y + i, vel_y);
+    _mm_storeu_ps(particles->life + i, life);
+
+    live_count += live_counts[_mm_movemask_ps(_mm_cmpgt_ps(life, zero_4))];
+  }
+  particles->live_count = live_count;
+}
+
+void particles_draw(ParticleSystem *particles, V2 offset, int max_count, RenderCmdBuffer *cmd_buffer)
+{
+  int drawn_count = 0;
+  for(U32 i = 0; i < particles->used_count && drawn_count < max_count; i++) {
+    F32 life = particles->life[i];
+    if(life <= 0.0f)
+      continue;
+
+    if(cmd_buffer->count == cmd_buffer->capacity) {
+      if(!cmd_buffer->grow || !cmd_buffer->grow(cmd_buffer))
+        break;
+    }
+
+    // NOTE(leo): Fade to black rather than to transparent, the renderer doesn't blend
+    F32 fade = life*particles->inv_lifetime[i];
+    U32 color = particles->color[i];
+    Color faded = {
+      .r = fade*(F32)(color & 0xFF)/255.0f,
+      .g = fade*(F32)((color >> 8) & 0xFF)/255.0f,
+      .b = fade*(F32)((color >> 16) & 0xFF)/255.0f,
+      .a = 1.0f,
+    };
+    Rect rect = {
+      .pos = { offset.x + particles->pos_x[i] - PARTICLE_SIZE/2.0f, offset.y + particles->pos_y[i] - PARTICLE_SIZE/2.0f },
+      .dim = { PARTICLE_SIZE, PARTICLE_SIZE },
+    };
+    draw_rectangle(rect, faded, cmd_buffer);
+    drawn_count++;
+  }
+}
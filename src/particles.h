@@ -0,0 +1,46 @@
+#pragma once
+
+#include "util.h"
+#include "renderer.h"
+
+// NOTE(leo): Multiple of 4 (simd lanes)
+#define PARTICLE_CAPACITY (128*1024)
+
+// NOTE(leo): Upper bound of particle commands per frame, so effects can't crowd out the rest of the frame
+#define PARTICLE_MAX_DRAW_COUNT (16*1024)
+
+#define PARTICLE_SIZE 0.6f
+#define PARTICLE_GRAVITY -60.0f
+
+/*
+  Fixed pool of particles, one array per attribute so the update streams through memory 4 particles at a time.
+
+  Dead particles (life <= 0) are never compacted away. Spawning writes to the slot under spawn_cursor and advances it,
+  so slots get reused in the order they were handed out: as all effects have similar lifetimes, the slot under the
+  cursor is (almost always) dead already, and if it is not, it holds the oldest particle, which is the one to steal.
+  Only [0, used_count) is ever touched; used_count grows up to PARTICLE_CAPACITY and then stays there.
+
+  NOTE(leo): Allocate from an arena (~3 MiB), zeroed memory is an empty system.
+*/
+typedef struct ParticleSystem {
+  F32 pos_x[PARTICLE_CAPACITY];
+  F32 pos_y[PARTICLE_CAPACITY];
+  F32 vel_x[PARTICLE_CAPACITY];
+  F32 vel_y[PARTICLE_CAPACITY];
+  F32 life[PARTICLE_CAPACITY]; // NOTE(leo): Seconds left
+  F32 inv_lifetime[PARTICLE_CAPACITY]; // NOTE(leo): For fading out
+  U32 color[PARTICLE_CAPACITY]; // NOTE(leo): 0xAABBGGRR
+
+  U32 spawn_cursor;
+  U32 used_count;
+  U32 live_count; // NOTE(leo): As of the last particles_update
+  U32 random_state;
+} ParticleSystem;
+
+// NOTE(leo): count particles flying away from pos in random directions, speed between 0.5 and 1 times max_speed
+void particles_spawn_burst(ParticleSystem *particles, V2 pos, int count, F32 max_speed, F32 lifetime, Color color);
+
+void particles_update(ParticleSystem *particles, F32 dt);
+
+// NOTE(leo): Draws at most max_count live particles. Stops early instead of dropping commands if cmd_buffer is full
+void particles_draw(ParticleSystem *particles, V2 offset, int max_count, RenderCmdBuffer *cmd_buffer);
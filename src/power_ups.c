@@ -0,0 +1,82 @@
+#include "power_ups.h"
+
+#include <string.h>
+
+EntityHandle power_up_spawn(PowerUpPool *pool, V2 pos, U8 type)
+{
+  U16 slot;
+  if(pool->free_slot_count)
+    slot = pool->free_slots[--pool->free_slot_count];
+  else if(pool->slot_count < POWER_UP_CAPACITY)
+    slot = (U16)pool->slot_count++;
+  else
+    return NULL_ENTITY_HANDLE;
+
+  int index = pool->count++;
+  pool->pos_x[index] = pos.x;
+  pool->pos_y[index] = pos.y;
+  pool->type[index] = type;
+  pool->slot[index] = slot;
+  pool->dense_index[slot] = (U16)index;
+
+  return ((U32)pool->generation[slot] << 16) | (U32)(slot + 1);
+}
+
+int power_up_lookup(PowerUpPool *pool, EntityHandle handle)
+{
+  U32 slot = (handle & 0xFFFF) - 1;
+  U16 generation = (U16)(handle >> 16);
+  if(handle == NULL_ENTITY_HANDLE || slot >= (U32)pool->slot_count || pool->generation[slot] != generation)
+    return -1;
+  return pool->dense_index[slot];
+}
+
+void power_up_remove_at(PowerUpPool *pool, int index)
+{
+  assert(index >= 0 && index < pool->count);
+
+  U16 slot = pool->slot[index];
+  pool->generation[slot]++;
+  pool->free_slots[pool->free_slot_count++] = slot;
+
+  int last = --pool->count;
+  if(index != last) {
+    pool->pos_x[index] = pool->pos_x[last];
+    pool->pos_y[index] = pool->pos_y[last];
+    pool->type[index] = pool->type[last];
+    pool->slot[index] = pool->slot[last];
+    pool->dense_index[pool->slot[index]] = (U16)index;
+  }
+}
+
+void power_up_destroy(PowerUpPool *pool, EntityHandle handle)
+{
+  int index = power_up_lookup(pool, handle);
+  if(index >= 0)
+    power_up_remove_at(pool, index);
+}
+
+void power_up_pool_copy(PowerUpPool *dest, PowerUpPool *source)
+{
+  int count = source->count;
+  dest->count = count;
+  memcpy(dest->pos_x, source->pos_x, count*sizeof(F32));
+  memcpy(dest->pos_y, source->pos_y, count*sizeof(F32));
+  memcpy(dest->type, source->type, count*sizeof(U8));
+  memcpy(dest->slot, source->slot, count*sizeof(U16));
+
+  int slot_count = source->slot_count;
+  dest->slot_count = slot_count;
+  memcpy(dest->generation, source->generation, slot_count*sizeof(U16));
+  memcpy(dest->dense_index, source->dense_index, slot_count*sizeof(U16));
+  dest->free_slot_count = source->free_slot_count;
+  memcpy(dest->free_slots, source->free_slots, source->free_slot_count*sizeof(U16));
+
+  dest->update_cycles = source->update_cycles;
+}
+
+void power_ups_clear(PowerUpPool *pool)
+{
+  while(pool->count)
+    power_up_remove_at(pool, pool->count - 1);
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include "util.h"
+
+// NOTE(leo): At most 65535 (handle index is 16 bits). A drop takes about 6 s to fall out of the arena, a game doesn't
+// come close to this; bricks breaking with the pool full drop nothing
+#define POWER_UP_CAPACITY 64
+
+#define POWER_UP_WIDTH 4.0f
+#define POWER_UP_HEIGHT 1.5f
+#define POWER_UP_FALL_SPEED 25.0f
+
+enum {
+  POWER_UP_MULTI_BALL,
+  POWER_UP_WIDE_PADDLE,
+  POWER_UP_SLOW_BALL,
+
+  POWER_UP_TYPE_COUNT,
+};
+
+// NOTE(leo): Slot index + 1 in the low 16 bits (so 0 is never a valid handle), generation of the slot in the high 16
+typedef U32 EntityHandle;
+
+#define NULL_ENTITY_HANDLE 0
+
+/*
+  Pool of falling power-ups. Lives inside GameState, so it never allocates and copying a GameState copies it.
+
+  Live power-ups are packed at the start of the dense arrays ([0, count)), one array per attribute, so the update only
+  ever walks live data. Removing one moves the last one into its place.
+
+  Outside code refers to a power-up by EntityHandle instead of its dense index, which changes when others get removed.
+  A handle names a slot; the slot knows where its power-up currently is in the dense arrays, and its generation is
+  bumped whenever its power-up goes away, so stale handles stop resolving instead of finding whatever reused the slot.
+
+  NOTE(leo): Zeroed memory is an empty pool.
+*/
+typedef struct PowerUpPool {
+  int count;
+
+  // NOTE(leo): Dense, by position in the pool
+  F32 pos_x[POWER_UP_CAPACITY];
+  F32 pos_y[POWER_UP_CAPACITY];
+  U8 type[POWER_UP_CAPACITY];
+  U16 slot[POWER_UP_CAPACITY];
+
+  // NOTE(leo): Sparse, by slot
+  U16 generation[POWER_UP_CAPACITY];
+  U16 dense_index[POWER_UP_CAPACITY];
+  // NOTE(leo): Slots in use so far are [0, slot_count); the free ones among them are on the free stack
+  int slot_count;
+  int free_slot_count;
+  U16 free_slots[POWER_UP_CAPACITY];
+
+  // NOTE(leo): Profiling, last update
+  U64 update_cycles;
+} PowerUpPool;
+
+// NOTE(leo): NULL_ENTITY_HANDLE if the pool is full
+EntityHandle power_up_spawn(PowerUpPool *pool, V2 pos, U8 type);
+
+// NOTE(leo): Dense index, or -1 if the power-up is gone
+int power_up_lookup(PowerUpPool *pool, EntityHandle handle);
+
+void power_up_remove_at(PowerUpPool *pool, int index);
+void power_up_destroy(PowerUpPool *pool, EntityHandle handle);
+
+void power_ups_clear(PowerUpPool *pool);
+
+// NOTE(leo): Only copies the parts of the arrays in use
+void power_up_pool_copy(PowerUpPool *dest, PowerUpPool *source);
@@ -0,0 +1,62 @@
+#pragma once
+
+#include "util.h"
+#include "renderer.h"
+
+#include <math.h>
+
+// NOTE(leo): What the OpenGL renderer uploads: one per rect, expanded to a quad in the vertex shader. Position and size
+// are in playing area units, fixed point with RECT_INSTANCE_UNITS steps per unit
+typedef struct RectInstance {
+  S16 pos[2];
+  U16 dim[2];
+  U32 color; // NOTE(leo): RGBA8
+} RectInstance;
+
+#define RECT_INSTANCE_UNITS 64
+#define RECT_INSTANCE_UNITS_STRING "64.0"
+
+inline
+S16 quantize_position(F32 value)
+{
+  F32 result = roundf(value*RECT_INSTANCE_UNITS);
+  if(result < -32768.0f)
+    result = -32768.0f;
+  if(result > 32767.0f)
+    result = 32767.0f;
+  return (S16)result;
+}
+
+inline
+U16 quantize_size(F32 value)
+{
+  F32 result = roundf(value*RECT_INSTANCE_UNITS);
+  if(result < 0.0f)
+    result = 0.0f;
+  if(result > 65535.0f)
+    result = 65535.0f;
+  return (U16)result;
+}
+
+inline
+U32 pack_color(Color color)
+{
+  U32 r = (U32)(color.r*255.0f + 0.5f);
+  U32 g = (U32)(color.g*255.0f + 0.5f);
+  U32 b = (U32)(color.b*255.0f + 0.5f);
+  U32 a = (U32)(color.a*255.0f + 0.5f);
+  return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+inline
+void put_rect_instances(RectangleCmd *commands, int count, RectInstance *instances)
+{
+  for(int rect_index = 0; rect_index < count; rect_index++) {
+    Rect rect = commands[rect_index].rect;
+    instances[rect_index] = (RectInstance){
+      .pos = { quantize_position(rect.pos.x), quantize_position(rect.pos.y) },
+      .dim = { quantize_size(rect.dim.x), quantize_size(rect.dim.y) },
+      .color = pack_color(commands[rect_index].color),
+    };
+  }
+}
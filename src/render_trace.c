@@ -0,0 +1,157 @@
+#include "render_trace.h"
+
+#include <stddef.h>
+#include <string.h>
+
+#define RENDER_TRACE_MAX_COMMAND_SIZE (1 + sizeof(RectangleCmd))
+
+void render_trace_init(RenderTraceState *state, RectangleCmd *static_commands, RectangleCmd *commands, int capacity)
+{
+  *state = (RenderTraceState){
+    .static_layer = { .cmd_buffer = { .commands = static_commands, .capacity = capacity } },
+    .cmd_buffer = { .commands = commands, .capacity = capacity },
+  };
+}
+
+U32 render_trace_max_frame_size(int static_count, int count)
+{
+  return sizeof(RenderTraceFrameHeader) + (U32)(static_count + count)*RENDER_TRACE_MAX_COMMAND_SIZE;
+}
+
+// NOTE(leo): Encodes commands against previous, then makes them the previous ones
+internal
+U8 *render_trace_encode_commands(RenderCmdBuffer *previous, RectangleCmd *commands, int count, U8 *at)
+{
+  RectangleCmd zero = { 0 };
+  int index = 0;
+  while(index < count) {
+    U32 *fields = (U32 *)&commands[index];
+    U32 *previous_fields = (U32 *)(index < previous->count ? &previous->commands[index] : &zero);
+    U8 mask = 0;
+    for(int field_index = 0; field_index < RENDER_TRACE_FIELD_COUNT; field_index++) {
+      if(fields[field_index] != previous_fields[field_index])
+        mask |= (U8)(1 << field_index);
+    }
+    *at++ = mask;
+
+    if(mask) {
+      for(int field_index = 0; field_index < RENDER_TRACE_FIELD_COUNT; field_index++) {
+        if(mask & (1 << field_index)) {
+          memcpy(at, &fields[field_index], sizeof(U32));
+          at += sizeof(U32);
+        }
+      }
+      index++;
+    }
+    else {
+      int run_count = 1;
+      while(run_count < RENDER_TRACE_MAX_RUN_COUNT && index + run_count < count && index + run_count < previous->count
+        && !memcmp(&commands[index + run_count], &previous->commands[index + run_count], sizeof(RectangleCmd)))
+        run_count++;
+      *at++ = (U8)(run_count - 1);
+      index += run_count;
+    }
+  }
+
+  memcpy(previous->commands, commands, count*sizeof(RectangleCmd));
+  previous->count = count;
+  return at;
+}
+
+U32 render_trace_encode(RenderTraceState *state, RenderLayer *static_layer, RenderCmdBuffer *cmd_buffer, V2 viewport,
+  F32 dt, U8 *data)
+{
+  if(static_layer->cmd_buffer.count > state->static_layer.cmd_buffer.capacity
+    || cmd_buffer->count > state->cmd_buffer.capacity) {
+    state->skipped_count++;
+    return 0;
+  }
+
+  bool is_static_changed = !state->frame_count || static_layer->version != state->static_layer.version;
+  U8 *at = data + sizeof(RenderTraceFrameHeader);
+  if(is_static_changed) {
+    at = render_trace_encode_commands(&state->static_layer.cmd_buffer, static_layer->cmd_buffer.commands,
+      static_layer->cmd_buffer.count, at);
+    state->static_layer.version = static_layer->version;
+  }
+  at = render_trace_encode_commands(&state->cmd_buffer, cmd_buffer->commands, cmd_buffer->count, at);
+  state->viewport = viewport;
+  state->dt = dt;
+  state->frame_count++;
+
+  RenderTraceFrameHeader header = {
+    .size = (U32)(at - data) - sizeof(RenderTraceFrameHeader),
+    .flags = is_static_changed ? RENDER_TRACE_STATIC_CHANGED : 0,
+    .static_count = (U32)static_layer->cmd_buffer.count,
+    .static_version = static_layer->version,
+    .count = (U32)cmd_buffer->count,
+    .viewport = viewport,
+    .dt = dt,
+  };
+  memcpy(data, &header, sizeof(header));
+  return (U32)(at - data);
+}
+
+// NOTE(leo): Decodes count commands over the previous ones, in place. NULL if they go past end
+internal
+U8 *render_trace_decode_commands(RenderCmdBuffer *cmd_buffer, U32 count, U8 *at, U8 *end)
+{
+  if(count > (U32)cmd_buffer->count)
+    memset(cmd_buffer->commands + cmd_buffer->count, 0, (count - cmd_buffer->count)*sizeof(RectangleCmd));
+  cmd_buffer->count = (int)count;
+
+  U32 index = 0;
+  while(index < count) {
+    if(at == end)
+      return NULL;
+    U8 mask = *at++;
+    if(mask) {
+      U32 *fields = (U32 *)&cmd_buffer->commands[index];
+      for(int field_index = 0; field_index < RENDER_TRACE_FIELD_COUNT; field_index++) {
+        if(mask & (1 << field_index)) {
+          if(end - at < (ptrdiff_t)sizeof(U32))
+            return NULL;
+          memcpy(&fields[field_index], at, sizeof(U32));
+          at += sizeof(U32);
+        }
+      }
+      index++;
+    }
+    else {
+      // NOTE(leo): The commands stay as they are
+      if(at == end)
+        return NULL;
+      index += 1 + (U32)*at++;
+      if(index > count)
+        return NULL;
+    }
+  }
+  return at;
+}
+
+bool render_trace_decode(RenderTraceState *state, RenderTraceFrameHeader *header, U8 *data)
+{
+  if(header->static_count > (U32)state->static_layer.cmd_buffer.capacity
+    || header->count > (U32)state->cmd_buffer.capacity)
+    return false;
+
+  U8 *at = data;
+  U8 *end = data + header->size;
+  if(header->flags & RENDER_TRACE_STATIC_CHANGED) {
+    at = render_trace_decode_commands(&state->static_layer.cmd_buffer, header->static_count, at, end);
+    if(!at)
+      return false;
+    state->static_layer.version = header->static_version;
+  }
+  else if(header->static_count != (U32)state->static_layer.cmd_buffer.count) {
+    return false;
+  }
+  at = render_trace_decode_commands(&state->cmd_buffer, header->count, at, end);
+  if(!at || at != end)
+    return false;
+
+  state->viewport = header->viewport;
+  state->dt = header->dt;
+  state->frame_count++;
+  return true;
+}
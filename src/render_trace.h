@@ -0,0 +1,75 @@
+#pragma once
+
+#include "util.h"
+#include "renderer.h"
+
+/*
+  Render trace: the exact render commands of every frame, the static layer's and the frame's, and the size of the
+  window they were drawn for, so renderers can be benchmarked offline on real frames (breakout_tools
+  replay_render_trace). Written by the game with "-render_trace path", or breakout_tools record_render_trace.
+
+  A trace is a RenderTraceHeader, then every frame: a RenderTraceFrameHeader, then size bytes of commands. If the frame
+  has RENDER_TRACE_STATIC_CHANGED, static_count static layer commands first (the static layer is only in the trace
+  when its version changes), then count frame commands. Commands are deltas against the command at the same index the
+  frame before (in the static layer: the last static layer in the trace), or a zeroed one past the end of that:
+
+    U8                      mask of the changed fields (a RectangleCmd is RENDER_TRACE_FIELD_COUNT F32s, bit n is
+                            field n), compared bit for bit
+    4 bytes each            the new value of every changed field, in order
+  or if the mask is 0:
+    U8                      how many commands stay the same, minus 1: this one and the ones after it
+
+  Frames with more commands than the encoder holds are left out, and counted.
+*/
+#define RENDER_TRACE_MAGIC 0x54524C42 // NOTE(leo): "BLRT"
+#define RENDER_TRACE_VERSION 1
+
+#define RENDER_TRACE_FIELD_COUNT (int)(sizeof(RectangleCmd)/sizeof(F32))
+#define RENDER_TRACE_MAX_RUN_COUNT 256
+#define RENDER_TRACE_STATIC_CHANGED 0x1
+
+// NOTE(leo): The changed field mask is a U8 (static assert, the array size is negative otherwise)
+typedef U8 RenderTraceFieldCountCheck[RENDER_TRACE_FIELD_COUNT <= 8 ? 1 : -1];
+
+#pragma pack(push, 1)
+typedef struct RenderTraceHeader {
+  U32 magic;
+  U32 version;
+} RenderTraceHeader;
+
+typedef struct RenderTraceFrameHeader {
+  U32 size; // NOTE(leo): Bytes of commands after the header
+  U32 flags;
+  U32 static_count;
+  U32 static_version;
+  U32 count;
+  V2 viewport; // NOTE(leo): Window client size, pixels
+  F32 dt;
+} RenderTraceFrameHeader;
+#pragma pack(pop)
+
+// NOTE(leo): The last frame in the trace. The encoder's is what it diffs against; the decoder's is the frame it decoded
+// last, updated in place, which renderers take as is (the static layer's version changes along with it)
+typedef struct RenderTraceState {
+  RenderLayer static_layer;
+  RenderCmdBuffer cmd_buffer;
+  V2 viewport;
+  F32 dt;
+  U64 frame_count;
+  U64 skipped_count; // NOTE(leo): Encoder: frames left out, too many commands
+} RenderTraceState;
+
+// NOTE(leo): Both layers get capacity commands, static_commands and commands must hold that many
+void render_trace_init(RenderTraceState *state, RectangleCmd *static_commands, RectangleCmd *commands, int capacity);
+
+// NOTE(leo): Most an encoded frame takes, with its header
+U32 render_trace_max_frame_size(int static_count, int count);
+
+// NOTE(leo): Writes the frame, header and all, to data, which must hold render_trace_max_frame_size. Returns the size,
+// 0 if the frame is left out
+U32 render_trace_encode(RenderTraceState *state, RenderLayer *static_layer, RenderCmdBuffer *cmd_buffer, V2 viewport,
+  F32 dt, U8 *data);
+
+// NOTE(leo): Decodes the frame after header (size bytes at data) into state. False if it's broken or has more commands
+// than state holds, state is of no use then
+bool render_trace_decode(RenderTraceState *state, RenderTraceFrameHeader *header, U8 *data);
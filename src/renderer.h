@@ -7,8 +7,42 @@ typedef struct RectangleCmd {
   Color color;
 } RectangleCmd;
 
-typedef struct RenderCmdBuffer {
+typedef struct RenderCmdBuffer RenderCmdBuffer;
+
+// NOTE(leo): Supplied by the platform. Makes room for at least one more command without moving the existing ones
+typedef bool (RenderCmdBufferGrow)(RenderCmdBuffer *cmd_buffer);
+
+struct RenderCmdBuffer {
   RectangleCmd *commands;
   int count;
   int capacity;
-} RenderCmdBuffer;
+
+  RenderCmdBufferGrow *grow; // NOTE(leo): Optional, buffer has a fixed capacity if NULL
+  void *grow_context;
+
+  int dropped_count; // NOTE(leo): Commands that didn't fit, even after growing
+};
+
+typedef struct RenderLayer {
+  RenderCmdBuffer cmd_buffer;
+  // NOTE(leo): Matches GameState.static_layer_version the commands were built from. Lets both the game and the platform
+  // skip rebuilding (commands, vertices) while nothing in the layer changed
+  U32 version;
+} RenderLayer;
+
+inline
+void draw_rectangle(Rect rect, Color color, RenderCmdBuffer *cmd_buffer)
+{
+  if(cmd_buffer->count == cmd_buffer->capacity) {
+    if(!cmd_buffer->grow || !cmd_buffer->grow(cmd_buffer)) {
+      cmd_buffer->dropped_count++;
+      return;
+    }
+  }
+  assert(cmd_buffer->count < cmd_buffer->capacity);
+
+  cmd_buffer->commands[cmd_buffer->count++] = (RectangleCmd){
+    .rect = rect,
+    .color = color,
+  };
+}
@@ -0,0 +1,251 @@
+#include "snapshot.h"
+
+#include <math.h>
+#include <string.h>
+
+internal
+void snapshot_write(U8 **at, void *data, size_t size)
+{
+  memcpy(*at, data, size);
+  *at += size;
+}
+
+internal
+bool snapshot_read(U8 **at, U8 *end, void *data, size_t size)
+{
+  if((size_t)(end - *at) < size)
+    return false;
+  memcpy(data, *at, size);
+  *at += size;
+  return true;
+}
+
+U32 game_snapshot_encode(GameState *game_state, U8 *out)
+{
+  Level *level = &game_state->level;
+  PowerUpPool *power_ups = &game_state->power_ups;
+
+  GameTuning default_tuning = default_game_tuning();
+  bool is_tuned = memcmp(&game_state->tuning, &default_tuning, sizeof(GameTuning)) != 0;
+  bool is_scrolling = game_state->scroll.speed > 0.0f;
+  // NOTE(leo): The fade can be paused, so not just GAME_STATE_RESET_GAME
+  bool is_animating = false;
+  for(int brick_index = 0; brick_index < level->brick_count && !is_animating; brick_index++)
+    is_animating = game_state->brick_alpha[brick_index] < 1.0f;
+
+  U8 *at = out + sizeof(GameSnapshotHeader);
+  if(is_tuned)
+    snapshot_write(&at, &game_state->tuning, sizeof(GameTuning));
+
+  if(is_scrolling) {
+    ScrollField *scroll = &game_state->scroll;
+    snapshot_write(&at, scroll, sizeof(ScrollField));
+    snapshot_write(&at, &level->bounds, sizeof(Rect));
+    for(U32 chunk_index = scroll->first_chunk_index; chunk_index != scroll->next_chunk_index; chunk_index++) {
+      int first_brick_index = (chunk_index%SCROLL_CHUNK_COUNT)*SCROLL_CHUNK_BRICK_COUNT;
+      for(int row = 0; row < SCROLL_CHUNK_ROW_COUNT; row++)
+        snapshot_write(&at, &level->brick_rects[first_brick_index + row*SCROLL_CHUNK_COLUMN_COUNT].pos.y, sizeof(F32));
+    }
+  }
+
+  for(int ball_index = 0; ball_index < game_state->ball_count; ball_index++) {
+    Ball *ball = &game_state->balls[ball_index];
+    GameSnapshotBall snapshot_ball = { .pos = ball->rect.pos, .direction = ball->direction, .speed = ball->speed };
+    snapshot_write(&at, &snapshot_ball, sizeof(snapshot_ball));
+  }
+
+  U8 *brick_bits = at;
+  int brick_byte_count = (level->brick_count + 7)/8;
+  memset(brick_bits, 0, brick_byte_count);
+  at += brick_byte_count;
+  for(int brick_index = 0; brick_index < level->brick_count; brick_index++) {
+    if(game_state->brick_hps[brick_index])
+      brick_bits[brick_index >> 3] |= (U8)(1 << (brick_index & 7));
+  }
+  for(int brick_index = 0; brick_index < level->brick_count; brick_index++) {
+    if(game_state->brick_hps[brick_index] && level->brick_max_hps[brick_index] > 1)
+      *at++ = game_state->brick_hps[brick_index];
+  }
+
+  for(int index = 0; index < power_ups->count; index++) {
+    GameSnapshotPowerUp power_up = { .x = power_ups->pos_x[index], .y = power_ups->pos_y[index], .type = power_ups->type[index] };
+    snapshot_write(&at, &power_up, sizeof(power_up));
+  }
+
+  if(is_animating) {
+    for(int brick_index = 0; brick_index < level->brick_count; brick_index++) {
+      F32 alpha = fminf(fmaxf(game_state->brick_alpha[brick_index], 0.0f), 1.0f);
+      *at++ = (U8)(alpha*255.0f + 0.5f);
+    }
+  }
+
+  GameSnapshotHeader header = {
+    .version = GAME_SNAPSHOT_VERSION,
+    .state = (U8)game_state->state,
+    .flags = (U8)((game_state->is_paddle_shrunk ? GAME_SNAPSHOT_PADDLE_SHRUNK : 0)
+      | (game_state->has_cleared_bricks ? GAME_SNAPSHOT_CLEARED_BRICKS : 0)
+      | (game_state->is_endless ? GAME_SNAPSHOT_ENDLESS : 0)
+      | (game_state->is_switching_to_main_menu ? GAME_SNAPSHOT_SWITCHING_TO_MAIN_MENU : 0)
+      | (game_state->is_erasing_score ? GAME_SNAPSHOT_ERASING_SCORE : 0)
+      | (is_tuned ? GAME_SNAPSHOT_TUNED : 0)
+      | (is_scrolling ? GAME_SNAPSHOT_SCROLLING : 0)
+      | (is_animating ? GAME_SNAPSHOT_ANIMATING : 0)),
+    .ball_count = (U8)game_state->ball_count,
+    .size = (U16)(at - out),
+    .power_up_count = (U16)power_ups->count,
+    .brick_count = (U16)level->brick_count,
+    .bricks_remaining = (U16)game_state->bricks_remaining,
+    .balls_remaining = game_state->balls_remaining,
+    .score = game_state->score,
+    .hit_count = game_state->hit_count,
+    .first_level_index = game_state->first_level_index,
+    .level_index = game_state->level_index,
+    .random_state = game_state->random_state,
+    .difficulty_factor = game_state->difficulty_factor,
+    .target_ball_speed = game_state->target_ball_speed,
+    .paddle_x = game_state->paddle.pos.x,
+    .paddle_width = game_state->paddle.dim.x,
+    .wide_paddle_time = game_state->wide_paddle_time,
+    .slow_ball_time = game_state->slow_ball_time,
+  };
+  memcpy(out, &header, sizeof(header));
+  return header.size;
+}
+
+bool game_snapshot_decode(GameState *game_state, U8 *data, U32 size)
+{
+  GameSnapshotHeader header;
+  if(size < sizeof(header))
+    return false;
+  memcpy(&header, data, sizeof(header));
+  if(header.version != GAME_SNAPSHOT_VERSION || header.size != size || header.state >= GAME_STATE_COUNT
+    || header.ball_count > MAX_BALL_COUNT || header.brick_count > MAX_BRICK_COUNT
+    || header.power_up_count > POWER_UP_CAPACITY || header.bricks_remaining > header.brick_count)
+    return false;
+  U8 *at = data + sizeof(header);
+  U8 *end = data + size;
+
+  GameTuning tuning = default_game_tuning();
+  if((header.flags & GAME_SNAPSHOT_TUNED) && !snapshot_read(&at, end, &tuning, sizeof(tuning)))
+    return false;
+
+  // NOTE(leo): The bricks first, everything after depends on brick_count
+  Level *level = &game_state->level;
+  if(header.flags & GAME_SNAPSHOT_SCROLLING) {
+    ScrollField scroll;
+    Rect bounds;
+    if(!snapshot_read(&at, end, &scroll, sizeof(scroll)) || !snapshot_read(&at, end, &bounds, sizeof(bounds)))
+      return false;
+    if(scroll.next_chunk_index - scroll.first_chunk_index > SCROLL_CHUNK_COUNT || header.brick_count != MAX_BRICK_COUNT)
+      return false;
+
+    // NOTE(leo): Like reset_scroll_field and stream_scroll_chunks did, with the rows where they have scrolled to since
+    level->brick_count = MAX_BRICK_COUNT;
+    level->max_brick_height = BRICK_HEIGHT;
+    for(int brick_index = 0; brick_index < MAX_BRICK_COUNT; brick_index++)
+      level->brick_rects[brick_index].pos.y = SCROLL_FREE_SLOT_Y;
+    for(U32 chunk_index = scroll.first_chunk_index; chunk_index != scroll.next_chunk_index; chunk_index++) {
+      F32 row_ys[SCROLL_CHUNK_ROW_COUNT];
+      if(!snapshot_read(&at, end, row_ys, sizeof(row_ys)))
+        return false;
+      int slot_index = chunk_index%SCROLL_CHUNK_COUNT;
+      level_generate_chunk(level, slot_index, scroll.seed, chunk_index, row_ys[0]);
+      for(int row = 0; row < SCROLL_CHUNK_ROW_COUNT; row++) {
+        Rect *rects = &level->brick_rects[slot_index*SCROLL_CHUNK_BRICK_COUNT + row*SCROLL_CHUNK_COLUMN_COUNT];
+        for(int column = 0; column < SCROLL_CHUNK_COLUMN_COUNT; column++)
+          rects[column].pos.y = row_ys[row];
+      }
+    }
+    level->bounds = bounds;
+    level->sorted_split_index = (scroll.first_chunk_index%SCROLL_CHUNK_COUNT)*SCROLL_CHUNK_BRICK_COUNT;
+    game_state->scroll = scroll;
+  }
+  else {
+    // NOTE(leo): A scrolling field isn't any level, even if level_index says so
+    if(game_state->scroll.speed > 0.0f)
+      level->brick_count = 0;
+    game_state->scroll = (ScrollField){ 0 };
+    if(header.level_index >= 0)
+      select_level(game_state, header.level_index);
+    else if(game_state->level_index != -1)
+      return false;
+    if(level->brick_count != header.brick_count)
+      return false;
+  }
+
+  for(int ball_index = 0; ball_index < header.ball_count; ball_index++) {
+    GameSnapshotBall snapshot_ball;
+    if(!snapshot_read(&at, end, &snapshot_ball, sizeof(snapshot_ball)))
+      return false;
+    game_state->balls[ball_index] = (Ball){
+      .rect = { .pos = snapshot_ball.pos, .dim = { BALL_WIDTH, BALL_HEIGHT } },
+      .direction = snapshot_ball.direction,
+      .speed = snapshot_ball.speed,
+    };
+  }
+
+  int brick_byte_count = (header.brick_count + 7)/8;
+  if(end - at < brick_byte_count)
+    return false;
+  U8 *brick_bits = at;
+  at += brick_byte_count;
+  int unbroken_count = 0;
+  for(int brick_index = 0; brick_index < header.brick_count; brick_index++) {
+    U8 hp = (brick_bits[brick_index >> 3] >> (brick_index & 7)) & 1;
+    if(hp && level->brick_max_hps[brick_index] > 1) {
+      if(at == end || *at == 0 || *at > level->brick_max_hps[brick_index])
+        return false;
+      hp = *at++;
+    }
+    game_state->brick_hps[brick_index] = hp;
+    unbroken_count += hp != 0;
+  }
+  if(unbroken_count != header.bricks_remaining)
+    return false;
+
+  PowerUpPool *power_ups = &game_state->power_ups;
+  power_ups_clear(power_ups);
+  for(int index = 0; index < header.power_up_count; index++) {
+    GameSnapshotPowerUp power_up;
+    if(!snapshot_read(&at, end, &power_up, sizeof(power_up)) || power_up.type >= POWER_UP_TYPE_COUNT)
+      return false;
+    power_up_spawn(power_ups, (V2){ power_up.x, power_up.y }, power_up.type);
+  }
+
+  for(int brick_index = 0; brick_index < header.brick_count; brick_index++)
+    game_state->brick_alpha[brick_index] = 1.0f;
+  if(header.flags & GAME_SNAPSHOT_ANIMATING) {
+    if(end - at < header.brick_count)
+      return false;
+    for(int brick_index = 0; brick_index < header.brick_count; brick_index++)
+      game_state->brick_alpha[brick_index] = (F32)*at++/255.0f;
+  }
+  if(at != end)
+    return false;
+
+  game_state->state = header.state;
+  game_state->is_paddle_shrunk = (header.flags & GAME_SNAPSHOT_PADDLE_SHRUNK) != 0;
+  game_state->has_cleared_bricks = (header.flags & GAME_SNAPSHOT_CLEARED_BRICKS) != 0;
+  game_state->is_endless = (header.flags & GAME_SNAPSHOT_ENDLESS) != 0;
+  game_state->is_switching_to_main_menu = (header.flags & GAME_SNAPSHOT_SWITCHING_TO_MAIN_MENU) != 0;
+  game_state->is_erasing_score = (header.flags & GAME_SNAPSHOT_ERASING_SCORE) != 0;
+  game_state->ball_count = header.ball_count;
+  game_state->bricks_remaining = header.bricks_remaining;
+  game_state->balls_remaining = header.balls_remaining;
+  game_state->score = header.score;
+  game_state->hit_count = header.hit_count;
+  game_state->first_level_index = header.first_level_index;
+  game_state->level_index = header.level_index;
+  game_state->random_state = header.random_state;
+  game_state->tuning = tuning;
+  game_state->difficulty_factor = header.difficulty_factor;
+  game_state->target_ball_speed = header.target_ball_speed;
+  game_state->paddle = (Rect){
+    .pos = { header.paddle_x, PADDLE_Y },
+    .dim = { header.paddle_width, PADDLE_HEIGTH },
+  };
+  game_state->wide_paddle_time = header.wide_paddle_time;
+  game_state->slow_ball_time = header.slow_ball_time;
+  game_state->static_layer_version++;
+  return true;
+}
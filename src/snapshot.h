@@ -0,0 +1,90 @@
+#pragma once
+
+#include "breakout.h"
+
+/*
+  Game state snapshots, small enough to keep one of every frame (replays, rollback, rewind, spectators). Version 1.
+  Little endian, no padding:
+
+    GameSnapshotHeader                  everything that's one number, 60 bytes
+    GameTuning                          if GAME_SNAPSHOT_TUNED (not default_game_tuning)
+    ScrollField, Rect bounds,           if GAME_SNAPSHOT_SCROLLING: the field, and the y of every row of the resident
+      F32 row_y[chunks][ROW_COUNT]      chunks, bottom chunk first
+    GameSnapshotBall[ball_count]
+    U8 brick_bits[(brick_count+7)/8]    bit i (of byte i/8, lowest bit first): brick i isn't broken
+    U8 brick_hps[]                      hits left of the unbroken bricks that take more than one, in brick order
+    GameSnapshotPowerUp[power_up_count] in pool order
+    U8 brick_alpha[brick_count]         if GAME_SNAPSHOT_ANIMATING (the reset game fade), alpha*255 rounded
+
+  The level isn't in it, a snapshot refers to it by level_index like the game does: decoding switches to that level of
+  game_state's pack (or the default level). The scrolling field regenerates its resident chunks from the seed. A
+  generated level (level_index -1) has to be loaded in game_state already.
+
+  Decoding gives back a game that goes on exactly like the one encoded would, except during the reset game fade, where
+  the quantised alphas can end the fade a frame off. Not in a snapshot: the event ring (game_state keeps its own, so
+  its readers don't see old events again), the level pack, the generated level queue and its miss count, power-up
+  handles (the pool is rebuilt in the same order, handles from before don't resolve).
+
+  NOTE(leo): Like the level pack, new versions may only add to the end of the header and of the per item structs.
+*/
+#define GAME_SNAPSHOT_VERSION 1
+
+enum {
+  GAME_SNAPSHOT_PADDLE_SHRUNK = 1<<0,
+  GAME_SNAPSHOT_CLEARED_BRICKS = 1<<1,
+  GAME_SNAPSHOT_ENDLESS = 1<<2,
+  GAME_SNAPSHOT_SWITCHING_TO_MAIN_MENU = 1<<3,
+  GAME_SNAPSHOT_ERASING_SCORE = 1<<4,
+  GAME_SNAPSHOT_TUNED = 1<<5,
+  GAME_SNAPSHOT_SCROLLING = 1<<6,
+  GAME_SNAPSHOT_ANIMATING = 1<<7,
+};
+
+#pragma pack(push, 1)
+typedef struct GameSnapshotHeader {
+  U8 version;
+  U8 state;
+  U8 flags; // NOTE(leo): GAME_SNAPSHOT_*
+  U8 ball_count;
+  U16 size; // NOTE(leo): Of the whole snapshot
+  U16 power_up_count;
+  U16 brick_count;
+  U16 bricks_remaining;
+  S32 balls_remaining;
+  S32 score;
+  S32 hit_count;
+  S32 first_level_index;
+  S32 level_index;
+  U32 random_state;
+  F32 difficulty_factor;
+  F32 target_ball_speed;
+  F32 paddle_x; // NOTE(leo): The paddle's y and height never change
+  F32 paddle_width;
+  F32 wide_paddle_time;
+  F32 slow_ball_time;
+} GameSnapshotHeader;
+
+// NOTE(leo): Balls are all BALL_WIDTH by BALL_HEIGHT
+typedef struct GameSnapshotBall {
+  V2 pos;
+  V2 direction;
+  F32 speed;
+} GameSnapshotBall;
+
+typedef struct GameSnapshotPowerUp {
+  F32 x, y;
+  U8 type;
+} GameSnapshotPowerUp;
+#pragma pack(pop)
+
+#define GAME_SNAPSHOT_MAX_SIZE (sizeof(GameSnapshotHeader) + sizeof(GameTuning) + sizeof(ScrollField) + sizeof(Rect) \
+  + SCROLL_CHUNK_COUNT*SCROLL_CHUNK_ROW_COUNT*sizeof(F32) + MAX_BALL_COUNT*sizeof(GameSnapshotBall) \
+  + MAX_BRICK_COUNT/8 + MAX_BRICK_COUNT + POWER_UP_CAPACITY*sizeof(GameSnapshotPowerUp) + MAX_BRICK_COUNT)
+
+// NOTE(leo): out must hold GAME_SNAPSHOT_MAX_SIZE bytes. Returns the size of the snapshot. A hundred bytes or so while
+// playing a level, without power-ups
+U32 game_snapshot_encode(GameState *game_state, U8 *out);
+
+// NOTE(leo): False if the snapshot is broken, of another version, or of a generated level that isn't game_state's.
+// game_state may be half decoded then
+bool game_snapshot_decode(GameState *game_state, U8 *data, U32 size);
@@ -0,0 +1,80 @@
+#include "software_renderer.h"
+#include "breakout.h"
+#include "rect_instance.h"
+
+#include <math.h>
+#include <string.h>
+
+#define SOFTWARE_INSTANCE_CHUNK_COUNT 256
+#define SOFTWARE_CLEAR_COLOR 0xFF000000
+
+// NOTE(leo): First pixel whose center is at or right of edge (or above), like the rasterizer's fill rule
+internal
+int software_first_pixel(F32 edge, int pixel_count)
+{
+  int result = (int)ceilf(edge - 0.5f);
+  if(result < 0)
+    result = 0;
+  if(result > pixel_count)
+    result = pixel_count;
+  return result;
+}
+
+internal
+void software_draw_commands(SoftwareRenderer *renderer, U32 *pixels, RectangleCmd *commands, int count,
+  Rect playing_area)
+{
+  F32 scale_x = playing_area.dim.x/(PLAYING_AREA_WIDTH*RECT_INSTANCE_UNITS);
+  F32 scale_y = playing_area.dim.y/(PLAYING_AREA_HEIGHT*RECT_INSTANCE_UNITS);
+
+  // NOTE(leo): Quantised in chunks, the way the OpenGL renderer uploads them
+  RectInstance instances[SOFTWARE_INSTANCE_CHUNK_COUNT];
+  for(int first_index = 0; first_index < count; first_index += SOFTWARE_INSTANCE_CHUNK_COUNT) {
+    int chunk_count = count - first_index;
+    if(chunk_count > SOFTWARE_INSTANCE_CHUNK_COUNT)
+      chunk_count = SOFTWARE_INSTANCE_CHUNK_COUNT;
+    put_rect_instances(commands + first_index, chunk_count, instances);
+
+    for(int instance_index = 0; instance_index < chunk_count; instance_index++) {
+      RectInstance *instance = &instances[instance_index];
+      int x0 = software_first_pixel(playing_area.pos.x + instance->pos[0]*scale_x, renderer->width);
+      int x1 = software_first_pixel(playing_area.pos.x + (instance->pos[0] + instance->dim[0])*scale_x, renderer->width);
+      int y0 = software_first_pixel(playing_area.pos.y + instance->pos[1]*scale_y, renderer->height);
+      int y1 = software_first_pixel(playing_area.pos.y + (instance->pos[1] + instance->dim[1])*scale_y, renderer->height);
+      U32 color = instance->color;
+      for(int y = y0; y < y1; y++) {
+        U32 *row = pixels + y*renderer->width;
+        for(int x = x0; x < x1; x++)
+          row[x] = color;
+      }
+    }
+  }
+}
+
+bool software_render(SoftwareRenderer *renderer, RenderLayer *static_layer, RenderCmdBuffer *cmd_buffer, V2 viewport)
+{
+  int width = (int)viewport.x;
+  int height = (int)viewport.y;
+  if(width < 0 || height < 0 || (S64)width*height > renderer->max_pixel_count)
+    return false;
+  renderer->width = width;
+  renderer->height = height;
+  int pixel_count = width*height;
+  Rect playing_area = compute_playing_area(viewport);
+
+  if(!renderer->has_static_pixels || static_layer->version != renderer->static_version
+    || width != renderer->static_width || height != renderer->static_height) {
+    for(int pixel_index = 0; pixel_index < pixel_count; pixel_index++)
+      renderer->static_pixels[pixel_index] = SOFTWARE_CLEAR_COLOR;
+    software_draw_commands(renderer, renderer->static_pixels, static_layer->cmd_buffer.commands,
+      static_layer->cmd_buffer.count, playing_area);
+    renderer->has_static_pixels = true;
+    renderer->static_version = static_layer->version;
+    renderer->static_width = width;
+    renderer->static_height = height;
+  }
+
+  memcpy(renderer->pixels, renderer->static_pixels, pixel_count*sizeof(U32));
+  software_draw_commands(renderer, renderer->pixels, cmd_buffer->commands, cmd_buffer->count, playing_area);
+  return true;
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "util.h"
+#include "renderer.h"
+
+/*
+  Draws render commands into memory, pixel for pixel what the OpenGL renderer draws: the same playing area transform
+  and instance quantisation (rect_instance.h), pixels whose centers are inside a rect get its color, cleared to black.
+  Like the OpenGL renderer it doesn't blend, color alpha is written as is.
+
+  The static layer is drawn into its own image, only again when its version or the image size changes; every frame
+  starts from a copy of it.
+*/
+typedef struct SoftwareRenderer {
+  U32 *pixels; // NOTE(leo): RGBA8 like RectInstance.color, rows bottom to top. max_pixel_count of them
+  U32 *static_pixels; // NOTE(leo): Just the static layer, max_pixel_count of them too
+  int max_pixel_count;
+
+  int width;
+  int height;
+
+  bool has_static_pixels;
+  U32 static_version;
+  int static_width;
+  int static_height;
+} SoftwareRenderer;
+
+// NOTE(leo): False if viewport has more than max_pixel_count pixels
+bool software_render(SoftwareRenderer *renderer, RenderLayer *static_layer, RenderCmdBuffer *cmd_buffer, V2 viewport);
@@ -0,0 +1,343 @@
+#include "spectator.h"
+
+#include <intrin.h>
+#include <math.h>
+#include <string.h>
+
+typedef struct SpectatorBits {
+  U8 *at;
+  U8 *end;
+  U64 bits; // NOTE(leo): Not written out yet (writing), or read in and not used yet (reading)
+  int bit_count;
+  bool is_overrun; // NOTE(leo): Reading: went past end
+} SpectatorBits;
+
+// NOTE(leo): count up to 32
+internal
+void spectator_put(SpectatorBits *writer, U32 value, int count)
+{
+  writer->bits |= (U64)value << writer->bit_count;
+  writer->bit_count += count;
+  while(writer->bit_count >= 8) {
+    *writer->at++ = (U8)writer->bits;
+    writer->bits >>= 8;
+    writer->bit_count -= 8;
+  }
+}
+
+internal
+U32 spectator_get(SpectatorBits *reader, int count)
+{
+  while(reader->bit_count < count) {
+    if(reader->at == reader->end) {
+      reader->is_overrun = true;
+      reader->bit_count += 8;
+    }
+    else {
+      reader->bits |= (U64)*reader->at++ << reader->bit_count;
+      reader->bit_count += 8;
+    }
+  }
+  U32 result = (U32)(reader->bits & ((1ull << count) - 1));
+  reader->bits >>= count;
+  reader->bit_count -= count;
+  return result;
+}
+
+global_variable int spectator_varbits_sizes[4] = { 4, 8, 16, 32 };
+
+internal
+void spectator_put_varbits(SpectatorBits *writer, U32 value)
+{
+  U32 size_class = value < (1 << 4) ? 0 : value < (1 << 8) ? 1 : value < (1 << 16) ? 2 : 3;
+  spectator_put(writer, size_class, 2);
+  spectator_put(writer, value, spectator_varbits_sizes[size_class]);
+}
+
+internal
+U32 spectator_get_varbits(SpectatorBits *reader)
+{
+  U32 size_class = spectator_get(reader, 2);
+  return spectator_get(reader, spectator_varbits_sizes[size_class]);
+}
+
+// NOTE(leo): 1 bit changed, then the difference zigzagged (small either way is short)
+internal
+void spectator_put_field(SpectatorBits *writer, S32 value, S32 baseline)
+{
+  U32 difference = (U32)value - (U32)baseline;
+  spectator_put(writer, difference != 0, 1);
+  if(difference)
+    spectator_put_varbits(writer, (difference << 1) ^ (U32)((S32)difference >> 31));
+}
+
+internal
+S32 spectator_get_field(SpectatorBits *reader, S32 baseline)
+{
+  if(!spectator_get(reader, 1))
+    return baseline;
+  U32 zigzag = spectator_get_varbits(reader);
+  return (S32)((U32)baseline + ((zigzag >> 1) ^ (0u - (zigzag & 1))));
+}
+
+internal
+S32 spectator_quantise(F32 value)
+{
+  return (S32)floorf(value*SPECTATOR_POS_SCALE + 0.5f);
+}
+
+// NOTE(leo): FNV-1a over the fields, not the struct's bytes
+U32 spectator_state_checksum(SpectatorState *state)
+{
+  S32 fields[] = {
+    (S32)state->sequence, state->state, state->level_index, state->score, state->balls_remaining, state->paddle_x,
+    state->paddle_width, state->ball_count, state->brick_count,
+  };
+  U32 result = 2166136261u;
+  for(int index = 0; index < (int)array_count(fields); index++)
+    result = (result ^ (U32)fields[index])*16777619u;
+  for(int index = 0; index < state->ball_count; index++) {
+    result = (result ^ (U32)state->ball_x[index])*16777619u;
+    result = (result ^ (U32)state->ball_y[index])*16777619u;
+  }
+  for(int index = 0; index < SPECTATOR_BRICK_WORD_COUNT; index++)
+    result = (result ^ state->brick_bits[index])*16777619u;
+  return result;
+}
+
+void spectator_encoder_init(SpectatorEncoder *encoder, U32 keyframe_interval, bool has_checksums)
+{
+  memset(encoder, 0, sizeof(*encoder));
+  encoder->keyframe_interval = keyframe_interval;
+  encoder->has_checksums = has_checksums;
+}
+
+void spectator_encoder_ack(SpectatorEncoder *encoder, U32 sequence)
+{
+  // NOTE(leo): Only newer acks of frames sent count. Differences, so sequence can wrap around
+  if(sequence - encoder->sequence < 0x80000000u)
+    return;
+  if(encoder->has_ack && sequence - encoder->acked_sequence >= 0x80000000u)
+    return;
+  encoder->acked_sequence = sequence;
+  encoder->has_ack = true;
+}
+
+internal
+void spectator_capture(SpectatorState *state, GameState *game_state, U32 sequence)
+{
+  memset(state, 0, sizeof(*state));
+  state->sequence = sequence;
+  state->state = game_state->state;
+  state->level_index = game_state->level_index;
+  state->score = game_state->score;
+  state->balls_remaining = game_state->balls_remaining;
+  state->paddle_x = spectator_quantise(game_state->paddle.pos.x);
+  state->paddle_width = spectator_quantise(game_state->paddle.dim.x);
+  state->ball_count = game_state->ball_count;
+  state->brick_count = game_state->level.brick_count;
+  for(int ball_index = 0; ball_index < game_state->ball_count; ball_index++) {
+    state->ball_x[ball_index] = spectator_quantise(game_state->balls[ball_index].rect.pos.x);
+    state->ball_y[ball_index] = spectator_quantise(game_state->balls[ball_index].rect.pos.y);
+  }
+  for(int brick_index = 0; brick_index < state->brick_count; brick_index++)
+    state->brick_bits[brick_index >> 5] |= (U32)(game_state->brick_hps[brick_index] != 0) << (brick_index & 31);
+}
+
+// NOTE(leo): Fields in stream order, so encoding and decoding can't disagree on it
+#define SPECTATOR_FIELD_COUNT 8
+internal
+S32 *spectator_fields(SpectatorState *state, int index)
+{
+  S32 *fields[SPECTATOR_FIELD_COUNT] = {
+    &state->state, &state->level_index, &state->score, &state->balls_remaining, &state->paddle_x,
+    &state->paddle_width, &state->ball_count, &state->brick_count,
+  };
+  return fields[index];
+}
+
+// NOTE(leo): previous is the frame before (NULL for a keyframe). A ball that's new has no speed, nor one after the ball
+// count changed (balls get swapped around then)
+internal
+void spectator_derive_ball_speeds(SpectatorState *state, SpectatorState *previous)
+{
+  bool is_same_balls = previous && previous->ball_count == state->ball_count;
+  for(int ball_index = 0; ball_index < MAX_BALL_COUNT; ball_index++) {
+    bool has_speed = is_same_balls && ball_index < state->ball_count;
+    state->ball_dx[ball_index] = has_speed ? state->ball_x[ball_index] - previous->ball_x[ball_index] : 0;
+    state->ball_dy[ball_index] = has_speed ? state->ball_y[ball_index] - previous->ball_y[ball_index] : 0;
+  }
+}
+
+internal
+void spectator_put_state(SpectatorBits *writer, SpectatorState *state, SpectatorState *baseline, S32 baseline_age)
+{
+  for(int index = 0; index < SPECTATOR_FIELD_COUNT; index++)
+    spectator_put_field(writer, *spectator_fields(state, index), *spectator_fields(baseline, index));
+  // NOTE(leo): Balls mostly fly straight. The baseline's are zero past its ball_count
+  for(int ball_index = 0; ball_index < state->ball_count; ball_index++) {
+    spectator_put_field(writer, state->ball_x[ball_index],
+      baseline->ball_x[ball_index] + baseline->ball_dx[ball_index]*baseline_age);
+    spectator_put_field(writer, state->ball_y[ball_index],
+      baseline->ball_y[ball_index] + baseline->ball_dy[ball_index]*baseline_age);
+  }
+
+  // NOTE(leo): Usually a brick or two flipped, sent by index. After a level switch most of them, sent whole
+  int flipped_indices[MAX_BRICK_COUNT];
+  int flipped_count = 0;
+  for(int word_index = 0; word_index < SPECTATOR_BRICK_WORD_COUNT; word_index++) {
+    U32 flipped = state->brick_bits[word_index] ^ baseline->brick_bits[word_index];
+    unsigned long bit;
+    while(_BitScanForward(&bit, flipped)) {
+      flipped_indices[flipped_count++] = word_index*32 + (int)bit;
+      flipped &= flipped - 1;
+    }
+  }
+  spectator_put(writer, flipped_count != 0, 1);
+  if(!flipped_count)
+    return;
+  bool is_whole = flipped_count*8 > state->brick_count;
+  spectator_put(writer, is_whole, 1);
+  if(is_whole) {
+    for(int brick_index = 0; brick_index < state->brick_count; brick_index += 32) {
+      int count = state->brick_count - brick_index < 32 ? state->brick_count - brick_index : 32;
+      spectator_put(writer, state->brick_bits[brick_index >> 5], count);
+    }
+  }
+  else {
+    spectator_put_varbits(writer, flipped_count);
+    int previous = -1;
+    for(int index = 0; index < flipped_count; index++) {
+      spectator_put_varbits(writer, flipped_indices[index] - previous - 1);
+      previous = flipped_indices[index];
+    }
+  }
+}
+
+internal
+bool spectator_get_state(SpectatorBits *reader, SpectatorState *state, SpectatorState *baseline, S32 baseline_age)
+{
+  for(int index = 0; index < SPECTATOR_FIELD_COUNT; index++)
+    *spectator_fields(state, index) = spectator_get_field(reader, *spectator_fields(baseline, index));
+  if(state->ball_count < 0 || state->ball_count > MAX_BALL_COUNT || state->brick_count < 0
+    || state->brick_count > MAX_BRICK_COUNT)
+    return false;
+  for(int ball_index = 0; ball_index < state->ball_count; ball_index++) {
+    state->ball_x[ball_index] = spectator_get_field(reader,
+      baseline->ball_x[ball_index] + baseline->ball_dx[ball_index]*baseline_age);
+    state->ball_y[ball_index] = spectator_get_field(reader,
+      baseline->ball_y[ball_index] + baseline->ball_dy[ball_index]*baseline_age);
+  }
+
+  memcpy(state->brick_bits, baseline->brick_bits, sizeof(state->brick_bits));
+  if(spectator_get(reader, 1)) {
+    if(spectator_get(reader, 1)) {
+      memset(state->brick_bits, 0, sizeof(state->brick_bits));
+      for(int brick_index = 0; brick_index < state->brick_count; brick_index += 32) {
+        int count = state->brick_count - brick_index < 32 ? state->brick_count - brick_index : 32;
+        state->brick_bits[brick_index >> 5] = spectator_get(reader, count);
+      }
+    }
+    else {
+      U32 flipped_count = spectator_get_varbits(reader);
+      if(flipped_count > MAX_BRICK_COUNT)
+        return false;
+      U32 brick_index = (U32)-1;
+      for(U32 index = 0; index < flipped_count; index++) {
+        brick_index += spectator_get_varbits(reader) + 1;
+        if(brick_index >= MAX_BRICK_COUNT)
+          return false;
+        state->brick_bits[brick_index >> 5] ^= 1u << (brick_index & 31);
+      }
+    }
+  }
+  return !reader->is_overrun;
+}
+
+U32 spectator_encode(SpectatorEncoder *encoder, GameState *game_state, U8 *out)
+{
+  U32 sequence = encoder->sequence++;
+  SpectatorState *state = &encoder->history[sequence%SPECTATOR_HISTORY_COUNT];
+  spectator_capture(state, game_state, sequence);
+
+  // NOTE(leo): The latest ack if it's past the latest keyframe (watchers that joined there have it), else the keyframe
+  bool is_keyframe = sequence == 0 || (encoder->keyframe_interval
+    && sequence - encoder->keyframe_sequence >= encoder->keyframe_interval);
+  U32 baseline_sequence = encoder->keyframe_sequence;
+  if(encoder->has_ack && encoder->acked_sequence - encoder->keyframe_sequence < 0x80000000u)
+    baseline_sequence = encoder->acked_sequence;
+  if(sequence - baseline_sequence >= SPECTATOR_HISTORY_COUNT)
+    is_keyframe = true;
+
+  local_persist SpectatorState empty_state;
+  SpectatorState *baseline = &encoder->history[baseline_sequence%SPECTATOR_HISTORY_COUNT];
+  if(is_keyframe) {
+    baseline = &empty_state;
+    encoder->keyframe_sequence = sequence;
+    encoder->keyframe_count++;
+  }
+  spectator_derive_ball_speeds(state, is_keyframe ? NULL : &encoder->history[(sequence - 1)%SPECTATOR_HISTORY_COUNT]);
+
+  SpectatorBits writer = { .at = out };
+  spectator_put(&writer, is_keyframe, 1);
+  if(is_keyframe)
+    spectator_put(&writer, sequence, 32);
+  else
+    spectator_put_varbits(&writer, sequence - baseline_sequence);
+  spectator_put(&writer, encoder->has_checksums, 1);
+  spectator_put_state(&writer, state, baseline, is_keyframe ? 0 : (S32)(sequence - baseline_sequence));
+  if(encoder->has_checksums)
+    spectator_put(&writer, spectator_state_checksum(state), 32);
+  if(writer.bit_count)
+    *writer.at++ = (U8)writer.bits;
+  return (U32)(writer.at - out);
+}
+
+SpectatorDecodeResult spectator_decode(SpectatorDecoder *decoder, U8 *data, U32 size)
+{
+  SpectatorBits reader = { .at = data, .end = data + size };
+  bool is_keyframe = spectator_get(&reader, 1);
+  U32 sequence;
+  U32 baseline_age = 0;
+  SpectatorState *baseline;
+  local_persist SpectatorState empty_state;
+  if(is_keyframe) {
+    sequence = spectator_get(&reader, 32);
+    baseline = &empty_state;
+  }
+  else {
+    if(!decoder->has_keyframe)
+      return SPECTATOR_WAITING_FOR_KEYFRAME;
+    sequence = decoder->sequence + 1;
+    baseline_age = spectator_get_varbits(&reader);
+    if(baseline_age == 0 || baseline_age >= SPECTATOR_HISTORY_COUNT) {
+      decoder->has_keyframe = false;
+      return SPECTATOR_BROKEN;
+    }
+    baseline = &decoder->history[(sequence - baseline_age)%SPECTATOR_HISTORY_COUNT];
+  }
+
+  // NOTE(leo): Into a scratch state, so a broken frame leaves the history as it was
+  SpectatorState state = { .sequence = sequence };
+  bool has_checksum = spectator_get(&reader, 1);
+  if(!spectator_get_state(&reader, &state, baseline, (S32)baseline_age)) {
+    decoder->has_keyframe = false;
+    return SPECTATOR_BROKEN;
+  }
+  U32 checksum = has_checksum ? spectator_get(&reader, 32) : 0;
+  if(reader.is_overrun) {
+    decoder->has_keyframe = false;
+    return SPECTATOR_BROKEN;
+  }
+
+  // NOTE(leo): A delta's frame before is this decoder's latest
+  spectator_derive_ball_speeds(&state, is_keyframe ? NULL : &decoder->history[(sequence - 1)%SPECTATOR_HISTORY_COUNT]);
+  decoder->history[sequence%SPECTATOR_HISTORY_COUNT] = state;
+  decoder->sequence = sequence;
+  decoder->has_keyframe = true;
+  if(has_checksum && checksum != spectator_state_checksum(&state)) {
+    decoder->has_keyframe = false;
+    return SPECTATOR_CHECKSUM_MISMATCH;
+  }
+  return SPECTATOR_DECODED;
+}
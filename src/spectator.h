@@ -0,0 +1,106 @@
+#pragma once
+
+#include "breakout.h"
+
+/*
+  Spectator stream: what a watcher needs to follow a game (the level by index, which of its bricks stand, balls, paddle,
+  score, balls left), a few bytes a frame. Unlike a snapshot (snapshot.h) it can't be played on from, and positions are
+  quantised to 1/SPECTATOR_POS_SCALE of an arena unit.
+
+  Every frame is a delta against a baseline, an earlier frame the watchers have: the latest one acked
+  (spectator_encoder_ack), or the latest keyframe if that's newer. Keyframes are deltas against the empty state, so
+  they stand alone; watchers join the stream at one, and nothing after a keyframe refers back past it. An ack older
+  than the encoder remembers gets a keyframe too.
+
+  A frame is bit packed, lowest bit of each byte first:
+
+    1 bit                   keyframe
+    32 bits / varbits       keyframe: its sequence; otherwise how many frames back the baseline is (sequence is the
+                            previous frame's plus one)
+    1 bit                   has checksum
+    fields                  state, level_index, score, balls_remaining, paddle x and width, ball_count, brick_count,
+                            then x and y of every ball: 1 bit changed, and if so zigzag varbits of the difference to the
+                            baseline's; for balls, to where the baseline's would be moving on as it did the frame before
+                            the baseline (a ball the baseline doesn't have: to 0)
+    1 bit                   bricks changed, then if so 1 bit mode:
+                              0: varbits count, then varbits gap before each flipped brick index (in order)
+                              1: brick_count bits, the bricks standing
+    32 bits                 if has checksum: spectator_state_checksum of the state this frame decodes to
+
+  varbits: 2 bits size class, then 4, 8, 16 or 32 bits of value.
+
+  A stream (a file, a pipe) is a SpectatorStreamHeader, then every frame with a U16 size before it.
+*/
+#define SPECTATOR_STREAM_MAGIC 0x50534C42 // NOTE(leo): "BLSP"
+#define SPECTATOR_STREAM_VERSION 1
+
+#define SPECTATOR_POS_SCALE 32.0f
+#define SPECTATOR_HISTORY_COUNT 64 // NOTE(leo): Power of two. Frames the encoder and decoder keep to diff against
+#define SPECTATOR_BRICK_WORD_COUNT (MAX_BRICK_COUNT/32)
+#define SPECTATOR_MAX_FRAME_SIZE 256 // NOTE(leo): A keyframe with everything at its biggest is under 150
+
+#pragma pack(push, 1)
+typedef struct SpectatorStreamHeader {
+  U32 magic;
+  U32 version;
+} SpectatorStreamHeader;
+#pragma pack(pop)
+
+typedef struct SpectatorState {
+  U32 sequence;
+  S32 state;
+  S32 level_index;
+  S32 score;
+  S32 balls_remaining;
+  S32 paddle_x; // NOTE(leo): Positions and sizes in 1/SPECTATOR_POS_SCALE arena units
+  S32 paddle_width;
+  S32 ball_count;
+  S32 brick_count;
+  S32 ball_x[MAX_BALL_COUNT]; // NOTE(leo): Bottom left. Zero past ball_count
+  S32 ball_y[MAX_BALL_COUNT];
+  S32 ball_dx[MAX_BALL_COUNT]; // NOTE(leo): Since the frame before, not sent (0 in a keyframe and for new balls)
+  S32 ball_dy[MAX_BALL_COUNT];
+  U32 brick_bits[SPECTATOR_BRICK_WORD_COUNT]; // NOTE(leo): Bit i%32 of word i/32: brick i stands. Zero past brick_count
+} SpectatorState;
+
+typedef struct SpectatorEncoder {
+  U32 keyframe_interval; // NOTE(leo): Frames between keyframes (joining points), 0: only the first frame
+  bool has_checksums;
+
+  U32 sequence; // NOTE(leo): Of the next frame
+  U32 keyframe_sequence; // NOTE(leo): Of the latest keyframe, valid once sequence isn't 0
+  U32 acked_sequence;
+  bool has_ack;
+  SpectatorState history[SPECTATOR_HISTORY_COUNT]; // NOTE(leo): Frame n at n%SPECTATOR_HISTORY_COUNT
+
+  // NOTE(leo): Stats
+  U32 keyframe_count;
+} SpectatorEncoder;
+
+typedef enum SpectatorDecodeResult {
+  SPECTATOR_DECODED,
+  SPECTATOR_WAITING_FOR_KEYFRAME, // NOTE(leo): Joined the stream, nothing to diff this frame against yet
+  SPECTATOR_BROKEN, // NOTE(leo): Truncated, out of range, or its baseline is gone. Waits for a keyframe again
+  SPECTATOR_CHECKSUM_MISMATCH, // NOTE(leo): Decoded, to a state the encoder didn't have. Waits for a keyframe again
+} SpectatorDecodeResult;
+
+typedef struct SpectatorDecoder {
+  bool has_keyframe;
+  U32 sequence; // NOTE(leo): Of the latest frame decoded
+  SpectatorState history[SPECTATOR_HISTORY_COUNT];
+} SpectatorDecoder;
+
+void spectator_encoder_init(SpectatorEncoder *encoder, U32 keyframe_interval, bool has_checksums);
+
+// NOTE(leo): Watchers have frame sequence (and everything before it). Acks may come late and out of order
+void spectator_encoder_ack(SpectatorEncoder *encoder, U32 sequence);
+
+// NOTE(leo): out must hold SPECTATOR_MAX_FRAME_SIZE bytes. Returns the size of the frame. A few hundred nanoseconds;
+// the state it encodes is encoder->history[sequence%SPECTATOR_HISTORY_COUNT] after
+U32 spectator_encode(SpectatorEncoder *encoder, GameState *game_state, U8 *out);
+
+// NOTE(leo): Zero the decoder to join a stream. Frames have to come in order, without gaps. The state decoded is
+// decoder->history[decoder->sequence%SPECTATOR_HISTORY_COUNT]
+SpectatorDecodeResult spectator_decode(SpectatorDecoder *decoder, U8 *data, U32 size);
+
+U32 spectator_state_checksum(SpectatorState *state);
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "util.h"
+
+#include <intrin.h>
+#include <string.h>
+
+/*
+  Lock-free queue of fixed size elements for exactly one producer thread and one consumer thread.
+
+  The producer only ever writes write_index, the consumer only ever writes read_index. Both run freely and are
+  masked when indexing, so capacity must be a power of two. The indices live on separate cache lines so the two
+  threads don't keep stealing the line from each other.
+
+  NOTE(leo): Relies on x64 store ordering plus compiler barriers; volatile (/volatile:ms) keeps the compiler from
+  caching the other side's index.
+*/
+typedef struct SpscQueue {
+  U8 *elements;
+  U32 element_size;
+  U32 capacity;
+
+  U8 padding0[64];
+  volatile U32 write_index;
+  U8 padding1[64];
+  volatile U32 read_index;
+  U8 padding2[64];
+} SpscQueue;
+
+inline
+void spsc_queue_init(SpscQueue *queue, void *elements, U32 element_size, U32 capacity)
+{
+  assert(capacity && (capacity & (capacity - 1)) == 0);
+  memset(queue, 0, sizeof(*queue));
+  queue->elements = elements;
+  queue->element_size = element_size;
+  queue->capacity = capacity;
+}
+
+// NOTE(leo): Producer only. Returns false if full
+inline
+bool spsc_queue_push(SpscQueue *queue, void *element)
+{
+  U32 write_index = queue->write_index;
+  if(write_index - queue->read_index == queue->capacity)
+    return false;
+
+  memcpy(queue->elements + (write_index & (queue->capacity - 1))*queue->element_size, element, queue->element_size);
+  _ReadWriteBarrier();
+  queue->write_index = write_index + 1;
+  return true;
+}
+
+// NOTE(leo): Consumer only. Returns false if empty
+inline
+bool spsc_queue_pop(SpscQueue *queue, void *element)
+{
+  U32 read_index = queue->read_index;
+  if(read_index == queue->write_index)
+    return false;
+  _ReadWriteBarrier();
+
+  memcpy(element, queue->elements + (read_index & (queue->capacity - 1))*queue->element_size, queue->element_size);
+  _ReadWriteBarrier();
+  queue->read_index = read_index + 1;
+  return true;
+}
+
+inline
+U32 spsc_queue_count(SpscQueue *queue)
+{
+  return queue->write_index - queue->read_index;
+}
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "util.h"
+#include "breakout.h"
+
+#include <windows.h>
+
+/*
+  Headless command line tools (benchmarks, simulations) sharing the game code. Run breakout_tools without arguments
+  for the list.
+*/
+
+typedef int (ToolMain)(int argc, char **argv);
+
+F64 tools_seconds(void);
+
+// NOTE(leo): Zeroed, page aligned. Exits on failure
+void *tools_allocate(size_t size);
+
+int tools_int_argument(int argc, char **argv, int index, int default_value);
+
+// NOTE(leo): Maps a whole file read only, for as long as the tool runs. False if it can't be opened or is empty
+bool tools_map_file(char *path, void **data, U64 *size);
+
+// NOTE(leo): Called once per item, from any of the threads. thread_index is in [0, thread_count)
+typedef void (ToolsWork)(void *data, int item_index, int thread_index);
+
+#define TOOLS_MAX_THREAD_COUNT 64
+
+// NOTE(leo): thread_count <= 0: one per logical processor. Returns the thread count used
+int tools_thread_count(int thread_count);
+
+// NOTE(leo): Runs work for items [0, item_count) on thread_count threads (see tools_thread_count), which take the next
+// item as they finish one. Returns when all are done
+void tools_parallel_for(int item_count, int thread_count, ToolsWork *work, void *data);
+
+// NOTE(leo): An hour of game time. Bot games still going by then count as timed out (eg: ball stuck bouncing between
+// walls without ever coming down)
+#define BOT_GAME_MAX_TIME (60.0f*60.0f)
+
+typedef struct BotGame {
+  // NOTE(leo): Setup. Same seed, same game
+  U32 seed;
+  F32 difficulty_factor;
+  GameTuning tuning;
+  F32 dt;
+  int max_frame_count;
+  // NOTE(leo): Makes the bot human: the paddle ends up to this far (arena units) off where the bot wants it, a new
+  // amount after every hit
+  F32 aim_error;
+  // NOTE(leo): Optional. Plays level level_index of the pack instead of the default level
+  LevelPack *level_pack;
+  int level_index;
+  bool is_single_set; // NOTE(leo): Stops once the first set is cleared (is_won) instead of playing both
+
+  // NOTE(leo): Results
+  int score;
+  int frame_count;
+  bool is_won; // NOTE(leo): Cleared both sets (or the one with is_single_set)
+  bool is_timed_out;
+  bool has_escaped; // NOTE(leo): Timed out with a ball out of the arena
+  U64 prediction_cycles;
+  int prediction_count;
+} BotGame;
+
+// NOTE(leo): Plays a whole game with the autoplayer, headless. game_state is scratch memory
+void tools_play_bot_game(GameState *game_state, BotGame *game);
+
+int tool_bench_particles(int argc, char **argv);
+int tool_bench_power_ups(int argc, char **argv);
+int tool_soak(int argc, char **argv);
+int tool_plan(int argc, char **argv);
+int tool_tune(int argc, char **argv);
+int tool_analyse_levels(int argc, char **argv);
+int tool_pack_levels(int argc, char **argv);
+int tool_bench_levels(int argc, char **argv);
+int tool_bench_generator(int argc, char **argv);
+int tool_bench_scroll(int argc, char **argv);
+int tool_bench_bricks(int argc, char **argv);
+int tool_bench_snapshots(int argc, char **argv);
+int tool_serve_games(int argc, char **argv);
+int tool_record_spectator(int argc, char **argv);
+int tool_watch_spectator(int argc, char **argv);
+int tool_publish_frames(int argc, char **argv);
+int tool_capture_frames(int argc, char **argv);
+int tool_record_render_trace(int argc, char **argv);
+int tool_replay_render_trace(int argc, char **argv);
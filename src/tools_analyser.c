@@ -0,0 +1,190 @@
+#include "tools.h"
+#include "levels.h"
+
+#include <stdio.h>
+#include <math.h>
+
+/*
+  Level analyser. For every level of a pack, plays single set bot games (same seeds for every level) until it's known
+  well enough whether the level can be cleared and how fast:
+
+    - stops once a further game would clear the level faster than the fastest clear so far (par time) with a
+      probability under tolerance, going by 95% upper bounds (see analyser_beat_par_bound): of the clear rate, and of
+      the share of clears that are faster than par
+    - a level never cleared stops the same way once its clear rate is most likely under tolerance
+    - a level that plays max_games without getting there is counted as undecided
+
+  Levels are the work items, so thousands of them keep all cores busy; each worker plays its level's games one after
+  the other to be able to stop early. Results go to a LevelAnalysis file (see levels.h).
+*/
+
+// NOTE(leo): A set takes the bot about 3 minutes
+#define ANALYSER_MAX_GAME_TIME (10.0f*60.0f)
+#define ANALYSER_DT (1.0f/30.0f)
+#define ANALYSER_MAX_GAME_COUNT 65535
+
+typedef struct Analyser {
+  LevelPack *pack;
+  int max_game_count;
+  F64 tolerance;
+  F32 aim_error;
+
+  GameState *game_states; // NOTE(leo): Scratch, one per thread
+  LevelAnalysis *results;
+} Analyser;
+
+/*
+  95% upper bound on the chance that one more game clears the level faster than par, after clear_count clears in
+  game_count games: the clear rate's (Wilson score interval, as in the tuner) times the share of clears faster than par.
+  Par is the fastest of clear_count clears, which are faster than it with a share above q only with probability
+  (1 - q)^clear_count, so that bound is the q where that is 5%. 1 before the first clear.
+*/
+internal
+F64 analyser_beat_par_bound(int clear_count, int game_count)
+{
+  F64 n = game_count;
+  F64 p = clear_count/n;
+  F64 z = 1.96;
+  F64 clear_rate_high = ((p + z*z/(2.0*n)) + z*sqrt(p*(1.0 - p)/n + z*z/(4.0*n*n)))/(1.0 + z*z/n);
+  if(clear_rate_high > 1.0)
+    clear_rate_high = 1.0;
+  F64 faster_share_high = clear_count ? 1.0 - pow(0.05, 1.0/clear_count) : 1.0;
+  return clear_rate_high*faster_share_high;
+}
+
+internal
+void analyser_analyse_level(void *data, int level_index, int thread_index)
+{
+  Analyser *analyser = data;
+  LevelAnalysis *result = &analyser->results[level_index];
+  *result = (LevelAnalysis){ 0 };
+
+  // NOTE(leo): The game would quietly play the default level instead
+  Level *level = &analyser->game_states[thread_index].level;
+  if(!level_pack_decode(analyser->pack, level_index, level))
+    return;
+
+  F64 clear_time_sum = 0.0;
+  for(int game_index = 0; game_index < analyser->max_game_count; game_index++) {
+    BotGame game = {
+      .seed = (U32)game_index,
+      .difficulty_factor = 1.0f,
+      .tuning = default_game_tuning(),
+      .dt = ANALYSER_DT,
+      .max_frame_count = (int)(ANALYSER_MAX_GAME_TIME/ANALYSER_DT),
+      .aim_error = analyser->aim_error,
+      .level_pack = analyser->pack,
+      .level_index = level_index,
+      .is_single_set = true,
+    };
+    tools_play_bot_game(&analyser->game_states[thread_index], &game);
+    result->game_count++;
+
+    if(game.is_won) {
+      F32 clear_time = game.frame_count*ANALYSER_DT;
+      clear_time_sum += clear_time;
+      if(!result->clear_count || clear_time < result->par_time)
+        result->par_time = clear_time;
+      result->clear_count++;
+    }
+    if(analyser_beat_par_bound(result->clear_count, result->game_count) < analyser->tolerance)
+      break;
+  }
+  if(result->clear_count)
+    result->mean_clear_time = (F32)(clear_time_sum/result->clear_count);
+}
+
+int tool_analyse_levels(int argc, char **argv)
+{
+  if(argc < 2) {
+    fprintf(stderr, "analyse_levels needs a level pack path and a results path\n");
+    return 1;
+  }
+  char *pack_path = argv[0];
+  char *results_path = argv[1];
+  int max_game_count = tools_int_argument(argc, argv, 2, 64);
+  int thread_count = tools_thread_count(tools_int_argument(argc, argv, 3, 0));
+  int aim_error_percent = tools_int_argument(argc, argv, 4, 10);
+  int tolerance_percent = tools_int_argument(argc, argv, 5, 10);
+  if(max_game_count < 1 || max_game_count > ANALYSER_MAX_GAME_COUNT || aim_error_percent < 0 || tolerance_percent < 1
+    || tolerance_percent > 100) {
+    fprintf(stderr, "max_games in 1-%d, aim_error_percent not negative, tolerance_percent in 1-100\n",
+      ANALYSER_MAX_GAME_COUNT);
+    return 1;
+  }
+
+  void *data;
+  U64 size;
+  LevelPack pack;
+  if(!tools_map_file(pack_path, &data, &size) || !level_pack_open(&pack, data, size) || !pack.level_count) {
+    fprintf(stderr, "could not open level pack %s, or it has no levels\n", pack_path);
+    return 1;
+  }
+
+  Analyser analyser = {
+    .pack = &pack,
+    .max_game_count = max_game_count,
+    .tolerance = tolerance_percent/100.0,
+    .aim_error = PADDLE_WIDTH*aim_error_percent/100.0f,
+    .game_states = tools_allocate(thread_count*sizeof(GameState)),
+    .results = tools_allocate(pack.level_count*sizeof(LevelAnalysis)),
+  };
+  printf("analyse_levels: %u levels, up to %d games each, %d threads, aim error %.1f, tolerance %d%%\n",
+    pack.level_count, max_game_count, thread_count, analyser.aim_error, tolerance_percent);
+
+  F64 start = tools_seconds();
+  tools_parallel_for((int)pack.level_count, thread_count, analyser_analyse_level, &analyser);
+  F64 elapsed = tools_seconds() - start;
+
+  LevelAnalysisHeader header = {
+    .magic = LEVEL_ANALYSIS_MAGIC,
+    .version = LEVEL_ANALYSIS_VERSION,
+    .level_count = pack.level_count,
+    .record_size = sizeof(LevelAnalysis),
+    .aim_error = analyser.aim_error,
+    .dt = ANALYSER_DT,
+  };
+  FILE *file = fopen(results_path, "wb");
+  if(!file || fwrite(&header, sizeof(header), 1, file) != 1
+    || fwrite(analyser.results, sizeof(LevelAnalysis), pack.level_count, file) != pack.level_count) {
+    fprintf(stderr, "could not write %s\n", results_path);
+    if(file)
+      fclose(file);
+    return 1;
+  }
+  fclose(file);
+
+  int broken_count = 0;
+  int cleared_count = 0;
+  int undecided_count = 0;
+  U64 game_count = 0;
+  F64 par_time_sum = 0.0;
+  F64 clear_rate_sum = 0.0;
+  for(U32 level_index = 0; level_index < pack.level_count; level_index++) {
+    LevelAnalysis *result = &analyser.results[level_index];
+    game_count += result->game_count;
+    if(!result->game_count) {
+      broken_count++;
+      continue;
+    }
+    if(analyser_beat_par_bound(result->clear_count, result->game_count) >= analyser.tolerance)
+      undecided_count++;
+    if(result->clear_count) {
+      cleared_count++;
+      par_time_sum += result->par_time;
+      clear_rate_sum += (F64)result->clear_count/result->game_count;
+    }
+  }
+  int analysed_count = (int)pack.level_count - broken_count;
+  printf("%d can be cleared, %d never were, %d broken; %d undecided after max_games\n", cleared_count,
+    analysed_count - cleared_count, broken_count, undecided_count);
+  if(cleared_count)
+    printf("par time %.1f s mean, clear rate %.1f%% mean over the levels that can be cleared\n",
+      par_time_sum/cleared_count, 100.0*clear_rate_sum/cleared_count);
+  printf("%llu games (%.1f per level, %.0f%% of max_games) in %.2f s: %.1f levels/s, %.0f games/s\n",
+    (unsigned long long)game_count, analysed_count ? (F64)game_count/analysed_count : 0.0,
+    analysed_count ? 100.0*game_count/((F64)analysed_count*max_game_count) : 0.0, elapsed, pack.level_count/elapsed,
+    game_count/elapsed);
+  printf("results: %s\n", results_path);
+  return 0;
+}
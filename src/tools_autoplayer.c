@@ -0,0 +1,169 @@
+#include "tools.h"
+#include "breakout.h"
+#include "autoplayer.h"
+
+#include <intrin.h>
+#include <stdio.h>
+#include <math.h>
+
+void tools_play_bot_game(GameState *game_state, BotGame *game)
+{
+  *game_state = (GameState){
+    .random_state = game->seed*2654435761u + 1,
+    .tuning = game->tuning,
+    .level_pack = game->level_pack,
+    .first_level_index = game->level_index,
+  };
+  Input input = { .paddle_control = -1.0f };
+  game_update(game_state, game->dt, &input, NULL, NULL, NULL);
+  game_state->difficulty_factor = game->difficulty_factor;
+  switch_to_reset_game(game_state, false, true);
+
+  // NOTE(leo): Own random sequence, so the aim error doesn't change the game's
+  U32 random_state = game->seed*2246822519u + 1;
+  int aim_hit_count = -1;
+  F32 aim_offset = 0.0f;
+
+  int frame;
+  for(frame = 0; frame < game->max_frame_count; frame++) {
+    if(game_state->state == GAME_STATE_GAME_OVER || (game->is_single_set && game_state->has_cleared_bricks))
+      break;
+    if(game_state->state == GAME_STATE_WAIT_SERVE)
+      game_serve(game_state);
+
+    input.paddle_control = -1.0f;
+    if(game_state->state == GAME_STATE_PLAYING) {
+      U64 start_cycles = __rdtsc();
+      input.paddle_control = autoplayer_paddle_control(game_state);
+      game->prediction_cycles += __rdtsc() - start_cycles;
+      game->prediction_count += game_state->ball_count;
+
+      if(game->aim_error > 0.0f) {
+        if(game_state->hit_count != aim_hit_count) {
+          aim_hit_count = game_state->hit_count;
+          random_state ^= random_state << 13;
+          random_state ^= random_state >> 17;
+          random_state ^= random_state << 5;
+          aim_offset = game->aim_error*((F32)(random_state >> 8)/8388608.0f - 1.0f);
+        }
+        input.paddle_control += aim_offset/(ARENA_WIDTH - game_state->paddle.dim.x);
+      }
+    }
+    game_update(game_state, game->dt, &input, NULL, NULL, NULL);
+  }
+
+  game->score = game_state->score;
+  game->frame_count = frame;
+  if(game->is_single_set)
+    game->is_won = game_state->has_cleared_bricks;
+  else
+    game->is_won = game_state->state == GAME_STATE_GAME_OVER && game_state->has_cleared_bricks && game_state->bricks_remaining == 0;
+  game->is_timed_out = frame == game->max_frame_count;
+  game->has_escaped = false;
+  if(game->is_timed_out) {
+    // NOTE(leo): A ball outside the arena means it went through a wall, see the trapped ball in simulate_ball
+    for(int ball_index = 0; ball_index < game_state->ball_count; ball_index++) {
+      Rect ball = game_state->balls[ball_index].rect;
+      if(ball.pos.x < 0.0f || ball.pos.x + ball.dim.x > ARENA_WIDTH || ball.pos.y < 0.0f || ball.pos.y > ARENA_HEIGHT)
+        game->has_escaped = true;
+    }
+  }
+}
+
+// NOTE(leo): Per thread, so the workers never write to shared cache lines
+typedef struct SoakTotals {
+  GameState game_state;
+
+  int game_count;
+  int win_count;
+  int timeout_count;
+  int escape_count;
+  F64 score_sum;
+  F64 score_square_sum;
+  F64 frame_sum;
+  F64 prediction_cycles;
+  F64 prediction_count;
+} SoakTotals;
+
+typedef struct Soak {
+  F32 difficulty_factor;
+  F32 dt;
+  int max_frame_count;
+  SoakTotals *totals;
+} Soak;
+
+internal
+void soak_play_game(void *data, int game_index, int thread_index)
+{
+  Soak *soak = data;
+  SoakTotals *totals = &soak->totals[thread_index];
+
+  BotGame game = {
+    .seed = (U32)game_index,
+    .difficulty_factor = soak->difficulty_factor,
+    .tuning = default_game_tuning(),
+    .dt = soak->dt,
+    .max_frame_count = soak->max_frame_count,
+  };
+  tools_play_bot_game(&totals->game_state, &game);
+
+  totals->game_count++;
+  totals->win_count += game.is_won;
+  totals->timeout_count += game.is_timed_out;
+  totals->escape_count += game.has_escaped;
+  totals->score_sum += game.score;
+  totals->score_square_sum += (F64)game.score*game.score;
+  totals->frame_sum += game.frame_count;
+  totals->prediction_cycles += (F64)game.prediction_cycles;
+  totals->prediction_count += game.prediction_count;
+}
+
+int tool_soak(int argc, char **argv)
+{
+  int game_count = tools_int_argument(argc, argv, 0, 10000);
+  int thread_count = tools_thread_count(tools_int_argument(argc, argv, 1, 0));
+  int difficulty_factor_percent = tools_int_argument(argc, argv, 2, 100);
+  // NOTE(leo): Collision is continuous, so long frames only make the paddle react later
+  int dt_ms = tools_int_argument(argc, argv, 3, 16);
+  if(game_count < 1 || difficulty_factor_percent < 1 || dt_ms < 1) {
+    fprintf(stderr, "game_count, difficulty_factor_percent and dt_ms must be positive\n");
+    return 1;
+  }
+
+  Soak soak = {
+    .difficulty_factor = (F32)difficulty_factor_percent/100.0f,
+    .dt = (F32)dt_ms/1000.0f,
+    .max_frame_count = (int)(BOT_GAME_MAX_TIME*1000.0f/dt_ms),
+    .totals = tools_allocate(thread_count*sizeof(SoakTotals)),
+  };
+
+  F64 start = tools_seconds();
+  tools_parallel_for(game_count, thread_count, soak_play_game, &soak);
+  F64 elapsed = tools_seconds() - start;
+
+  SoakTotals total = { 0 };
+  for(int thread_index = 0; thread_index < thread_count; thread_index++) {
+    SoakTotals *totals = &soak.totals[thread_index];
+    total.game_count += totals->game_count;
+    total.win_count += totals->win_count;
+    total.timeout_count += totals->timeout_count;
+    total.escape_count += totals->escape_count;
+    total.score_sum += totals->score_sum;
+    total.score_square_sum += totals->score_square_sum;
+    total.frame_sum += totals->frame_sum;
+    total.prediction_cycles += totals->prediction_cycles;
+    total.prediction_count += totals->prediction_count;
+  }
+
+  F64 mean_score = total.score_sum/total.game_count;
+  F64 score_variance = total.score_square_sum/total.game_count - mean_score*mean_score;
+  printf("soak: %d games, %d threads, difficulty %.2f, %d ms frames\n", total.game_count, thread_count, soak.difficulty_factor, dt_ms);
+  printf("%.0f games/s, %.0f frames/s (%.2f s)\n", total.game_count/elapsed, total.frame_sum/elapsed, elapsed);
+  printf("cleared both sets: %d (%.1f%%), timed out: %d (%d with a ball out of the arena)\n",
+    total.win_count, 100.0*total.win_count/total.game_count, total.timeout_count, total.escape_count);
+  printf("score: %.1f mean, %.1f stddev; %.0f frames mean\n",
+    mean_score, sqrt(score_variance > 0.0 ? score_variance : 0.0), total.frame_sum/total.game_count);
+  printf("prediction: %.0f cycles mean per ball\n",
+    total.prediction_count ? total.prediction_cycles/total.prediction_count : 0.0);
+  return 0;
+}
@@ -0,0 +1,131 @@
+#include "tools.h"
+#include "breakout.h"
+
+#include <math.h>
+#include <stdio.h>
+
+/*
+  Times the brick collision sweep (sweep_brick_run) on brick tables far bigger than a level holds: rows of the classic
+  layout stacked up as high as it takes, some bricks broken, swept by a ball at its top speed from random spots inside
+  the field. Each table size is also swept from the start of the table instead of from the binary search (about what
+  a sweep cost before bricks were sorted), which has to find the same hits.
+*/
+
+#define BRICKS_BENCH_DT (1.0f/60.0f)
+#define BRICKS_BENCH_MIN_BRICK_COUNT 256
+#define BRICKS_BENCH_MAX_SCAN_WORK 200000000ull // NOTE(leo): Bricks looked at by the scans of a table size
+
+internal
+U32 bricks_random(U32 *state)
+{
+  U32 x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+internal
+F32 bricks_random_unilateral(U32 *state)
+{
+  return (F32)(bricks_random(state) >> 8)/(F32)(1 << 24);
+}
+
+typedef struct BrickSweep {
+  Rect ball;
+  V2 ball_delta;
+} BrickSweep;
+
+// NOTE(leo): Sums the hits, so the sweeps aren't optimized out and the two ways can be compared
+internal
+U64 bricks_run_sweeps(Rect *brick_rects, U8 *brick_hps, int brick_count, F32 max_brick_height, BrickSweep *sweeps,
+  int sweep_count, F64 *elapsed)
+{
+  U64 result = 0;
+  F64 start = tools_seconds();
+  for(int sweep_index = 0; sweep_index < sweep_count; sweep_index++) {
+    BrickHits hits = { .time = 1.0f, .indices = { -1, -1, -1 } };
+    sweep_brick_run(&hits, brick_rects, brick_hps, 0, brick_count, max_brick_height, sweeps[sweep_index].ball,
+      sweeps[sweep_index].ball_delta);
+    for(int i = 0; i < hits.count; i++)
+      result = result*31 + (U64)hits.indices[i]*4 + hits.edges[i];
+  }
+  *elapsed = tools_seconds() - start;
+  return result;
+}
+
+int tool_bench_bricks(int argc, char **argv)
+{
+  int max_brick_count = tools_int_argument(argc, argv, 0, 65536);
+  int sweep_count = tools_int_argument(argc, argv, 1, 1000000);
+  int seed = tools_int_argument(argc, argv, 2, 1);
+  if(max_brick_count < BRICKS_BENCH_MIN_BRICK_COUNT || sweep_count < 1) {
+    fprintf(stderr, "brick_count at least %d, sweep_count positive\n", BRICKS_BENCH_MIN_BRICK_COUNT);
+    return 1;
+  }
+
+  Rect *brick_rects = tools_allocate(max_brick_count*sizeof(Rect));
+  U8 *brick_hps = tools_allocate(max_brick_count*sizeof(U8));
+  BrickSweep *sweeps = tools_allocate(sweep_count*sizeof(BrickSweep));
+  printf("bench_bricks: up to %d bricks, %d sweeps per table size, seed %d\n", max_brick_count, sweep_count, seed);
+
+  bool are_hits_same = true;
+  for(int brick_count = BRICKS_BENCH_MIN_BRICK_COUNT;; brick_count *= 4) {
+    if(brick_count > max_brick_count)
+      brick_count = max_brick_count;
+
+    // NOTE(leo): Same table and sweeps for both ways. A quarter of the bricks broken, a few take two hits
+    U32 random_state = (U32)seed*2654435761u | 1;
+    for(int brick_index = 0; brick_index < brick_count; brick_index++) {
+      int x = brick_index%BRICK_COUNT_X;
+      int y = brick_index/BRICK_COUNT_X;
+      brick_rects[brick_index] = (Rect){
+        .pos = { BRICK_DELTA_X + (BRICK_WIDTH + BRICK_DELTA_X)*x, FIRST_BRICK_HEIGHT + (BRICK_HEIGHT + BRICK_DELTA_Y)*y },
+        .dim = { BRICK_WIDTH, BRICK_HEIGHT },
+      };
+      U32 roll = bricks_random(&random_state)%8;
+      brick_hps[brick_index] = roll < 2 ? 0 : roll == 7 ? 2 : 1;
+    }
+    F32 field_height = ((brick_count + BRICK_COUNT_X - 1)/BRICK_COUNT_X)*(BRICK_HEIGHT + BRICK_DELTA_Y);
+    for(int sweep_index = 0; sweep_index < sweep_count; sweep_index++) {
+      F32 angle = bricks_random_unilateral(&random_state)*6.2831853f;
+      F32 length = BALL_SPEED_4*BRICKS_BENCH_DT;
+      sweeps[sweep_index] = (BrickSweep){
+        .ball = {
+          .pos = {
+            bricks_random_unilateral(&random_state)*(ARENA_WIDTH - BALL_WIDTH),
+            FIRST_BRICK_HEIGHT + bricks_random_unilateral(&random_state)*field_height,
+          },
+          .dim = { BALL_WIDTH, BALL_HEIGHT },
+        },
+        .ball_delta = { length*cosf(angle), length*sinf(angle) },
+      };
+    }
+
+    F64 sweep_time;
+    U64 sweep_hash = bricks_run_sweeps(brick_rects, brick_hps, brick_count, BRICK_HEIGHT, sweeps, sweep_count, &sweep_time);
+
+    // NOTE(leo): No height limit: the binary search finds the first brick, the scan goes through every brick below the
+    // ball. Fewer sweeps for big tables, the hits of those have to match the first sweeps
+    int scan_count = sweep_count;
+    if((U64)scan_count*brick_count > BRICKS_BENCH_MAX_SCAN_WORK)
+      scan_count = (int)(BRICKS_BENCH_MAX_SCAN_WORK/brick_count);
+    if(scan_count < 1)
+      scan_count = 1;
+    F64 check_time;
+    U64 check_hash = bricks_run_sweeps(brick_rects, brick_hps, brick_count, BRICK_HEIGHT, sweeps, scan_count, &check_time);
+    F64 scan_time;
+    U64 scan_hash = bricks_run_sweeps(brick_rects, brick_hps, brick_count, 1.0e30f, sweeps, scan_count, &scan_time);
+    bool is_same = scan_hash == check_hash;
+    are_hits_same = are_hits_same && is_same;
+
+    printf("%6d bricks: sorted sweep %.1f ns, scan from the start %.1f ns (%d sweeps), %s (%llx)\n", brick_count,
+      sweep_time*1e9/sweep_count, scan_time*1e9/scan_count, scan_count, is_same ? "same hits" : "DIFFERENT HITS",
+      (unsigned long long)sweep_hash);
+
+    if(brick_count == max_brick_count)
+      break;
+  }
+  return are_hits_same ? 0 : 1;
+}
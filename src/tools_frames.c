@@ -0,0 +1,218 @@
+#include "tools.h"
+#include "breakout.h"
+#include "autoplayer.h"
+#include "particles.h"
+#include "frame_ring.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/*
+  Both ends of the frame ring (see frame_ring.h). publish_frames is the headless producer: has the bot play games,
+  with particles, and publishes every frame's render commands at frame_rate (0: as fast as it goes). capture_frames
+  reads the frames another process publishes (publish_frames, or the game with -frame_ring) in place, spending work_us
+  on each to stand in for a slow recorder, and reports what it read and what it lost. Eg, in two consoles:
+
+    breakout_tools publish_frames 20 0
+    breakout_tools capture_frames 10 200
+*/
+
+#define FRAMES_DT (1.0f/60.0f)
+#define FRAMES_VIEWPORT ((V2){ 1280.0f, 720.0f })
+#define FRAMES_STATIC_LAYER_CAPACITY 4096
+#define FRAMES_ATTACH_TIMEOUT 10.0
+
+internal
+FrameRing *frames_create_ring(void)
+{
+  HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)((U64)sizeof(FrameRing) >> 32),
+    (DWORD)sizeof(FrameRing), FRAME_RING_NAME);
+  return mapping ? MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(FrameRing)) : NULL;
+}
+
+int tool_publish_frames(int argc, char **argv)
+{
+  int seconds = tools_int_argument(argc, argv, 0, 10);
+  int frame_rate = tools_int_argument(argc, argv, 1, 60);
+  int seed = tools_int_argument(argc, argv, 2, 1);
+  if(seconds < 1 || frame_rate < 0) {
+    fprintf(stderr, "seconds positive, frame_rate not negative\n");
+    return 1;
+  }
+  FrameRing *ring = frames_create_ring();
+  if(!ring) {
+    fprintf(stderr, "could not create the frame ring\n");
+    return 1;
+  }
+  frame_ring_init(ring);
+
+  GameState *game_state = tools_allocate(sizeof(GameState));
+  ParticleSystem *particles = tools_allocate(sizeof(ParticleSystem));
+  RenderLayer static_layer = {
+    .cmd_buffer = {
+      .commands = tools_allocate(FRAMES_STATIC_LAYER_CAPACITY*sizeof(RectangleCmd)),
+      .capacity = FRAMES_STATIC_LAYER_CAPACITY,
+    },
+  };
+  RenderCmdBuffer cmd_buffer = {
+    .commands = tools_allocate(FRAME_RING_SLOT_COMMAND_COUNT*sizeof(RectangleCmd)),
+    .capacity = FRAME_RING_SLOT_COMMAND_COUNT,
+  };
+  printf("publish_frames: %d s at %d frames/s, seed %d. Ring %.1f MB, %d slots of %d commands\n", seconds, frame_rate,
+    seed, sizeof(FrameRing)/(1024.0*1024.0), FRAME_RING_SLOT_COUNT, FRAME_RING_SLOT_COMMAND_COUNT);
+
+  U64 frame_count = 0;
+  U64 command_count = 0;
+  F64 publish_time = 0.0;
+  F64 max_publish_time = 0.0;
+  int game_count = 0;
+  F64 start = tools_seconds();
+  F64 end = start + seconds;
+  F64 next_frame_time = start;
+  while(tools_seconds() < end) {
+    if(!game_count || game_state->state == GAME_STATE_GAME_OVER) {
+      *game_state = (GameState){ .random_state = ((U32)seed + (U32)game_count++)*2654435761u + 1 };
+      Input input = { .paddle_control = -1.0f };
+      game_update(game_state, FRAMES_DT, &input, NULL, NULL, NULL);
+      switch_to_reset_game(game_state, false, true);
+    }
+    if(game_state->state == GAME_STATE_WAIT_SERVE)
+      game_serve(game_state);
+    Input input = {
+      .paddle_control = game_state->state == GAME_STATE_PLAYING ? autoplayer_paddle_control(game_state) : -1.0f,
+    };
+    cmd_buffer.count = 0;
+    cmd_buffer.dropped_count = 0;
+    game_update(game_state, FRAMES_DT, &input, particles, &static_layer, &cmd_buffer);
+
+    F64 publish_start = tools_seconds();
+    frame_ring_publish(ring, &static_layer, &cmd_buffer, FRAMES_VIEWPORT, FRAMES_DT);
+    F64 elapsed = tools_seconds() - publish_start;
+    publish_time += elapsed;
+    if(elapsed > max_publish_time)
+      max_publish_time = elapsed;
+    frame_count++;
+    command_count += static_layer.cmd_buffer.count + cmd_buffer.count;
+
+    if(frame_rate) {
+      next_frame_time += 1.0/frame_rate;
+      while(tools_seconds() < next_frame_time)
+        Sleep(1);
+    }
+  }
+  F64 elapsed = tools_seconds() - start;
+
+  printf("%llu frames (%.0f/s) in %d games, %.0f commands a frame, %.1f MB/s\n", (unsigned long long)frame_count,
+    frame_count/elapsed, game_count, (F64)command_count/frame_count,
+    command_count*sizeof(RectangleCmd)/(elapsed*1024.0*1024.0));
+  printf("publish %.2f us mean, %.2f us max; dropped: %llu too big, %llu overwritten before the reader got to them, "
+    "%llu by the latest reader\n", publish_time*1e6/frame_count, max_publish_time*1e6,
+    (unsigned long long)ring->too_big_count, (unsigned long long)ring->overwritten_count,
+    (unsigned long long)ring->reader_dropped_count);
+  return 0;
+}
+
+int tool_capture_frames(int argc, char **argv)
+{
+  int seconds = tools_int_argument(argc, argv, 0, 10);
+  int work_us = tools_int_argument(argc, argv, 1, 0);
+  if(seconds < 1 || work_us < 0) {
+    fprintf(stderr, "seconds positive, work_us not negative\n");
+    return 1;
+  }
+
+  // NOTE(leo): The producer may not be up yet: no mapping, or one it hasn't set up yet. Mapped once, then the magic is
+  // polled
+  HANDLE mapping = NULL;
+  FrameRing *ring = NULL;
+  F64 give_up_time = tools_seconds() + FRAMES_ATTACH_TIMEOUT;
+  while(tools_seconds() < give_up_time) {
+    if(!mapping)
+      mapping = OpenFileMappingA(FILE_MAP_ALL_ACCESS, FALSE, FRAME_RING_NAME);
+    if(mapping && !ring)
+      ring = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(FrameRing));
+    if(ring && ring->magic == FRAME_RING_MAGIC)
+      break;
+    Sleep(100);
+  }
+  if(!ring || ring->magic != FRAME_RING_MAGIC) {
+    fprintf(stderr, "no frame ring, start publish_frames or the game with -frame_ring first\n");
+    return 1;
+  }
+  if(ring->version != FRAME_RING_VERSION || ring->slot_count != FRAME_RING_SLOT_COUNT
+    || ring->slot_command_count != FRAME_RING_SLOT_COMMAND_COUNT) {
+    fprintf(stderr, "frame ring of another version\n");
+    return 1;
+  }
+  printf("capture_frames: %d s, %d us of work a frame\n", seconds, work_us);
+
+  U64 too_big_count = ring->too_big_count;
+  U64 overwritten_count = ring->overwritten_count;
+  U64 next_frame_index = ring->published_count;
+  ring->reader_dropped_count = 0;
+  ring->reader_frame_index = next_frame_index + 1;
+
+  U64 read_count = 0;
+  U64 missed_count = 0;
+  U64 torn_count = 0;
+  U64 command_count = 0;
+  U32 checksum = 2166136261u;
+  F64 read_time = 0.0;
+  F64 end = tools_seconds() + seconds;
+  while(tools_seconds() < end) {
+    U64 published_count = ring->published_count;
+    if(published_count < next_frame_index)
+      next_frame_index = published_count; // NOTE(leo): The producer started over
+    if(published_count == next_frame_index) {
+      Sleep(1);
+      continue;
+    }
+    // NOTE(leo): More than half a ring behind, it skips ahead to half a ring behind: the oldest frames are the next ones
+    // the producer overwrites, a slow read of one of them would end up torn
+    if(published_count - next_frame_index > FRAME_RING_SLOT_COUNT/2) {
+      missed_count += published_count - FRAME_RING_SLOT_COUNT/2 - next_frame_index;
+      next_frame_index = published_count - FRAME_RING_SLOT_COUNT/2;
+    }
+
+    U32 sequence;
+    FrameRingSlot *slot = frame_ring_begin_read(ring, next_frame_index, &sequence);
+    if(slot) {
+      // NOTE(leo): Stands in for recording the frame: looks at every command, then takes work_us
+      F64 read_start = tools_seconds();
+      U32 frame_checksum = checksum;
+      U32 count = slot->count < FRAME_RING_SLOT_COMMAND_COUNT ? slot->count : FRAME_RING_SLOT_COMMAND_COUNT;
+      U32 *words = (U32 *)slot->commands;
+      for(U32 index = 0; index < count*(sizeof(RectangleCmd)/sizeof(U32)); index++)
+        frame_checksum = (frame_checksum ^ words[index])*16777619u;
+      while(tools_seconds() - read_start < work_us*1e-6)
+        YieldProcessor();
+      read_time += tools_seconds() - read_start;
+
+      if(frame_ring_end_read(slot, sequence)) {
+        checksum = frame_checksum;
+        command_count += count;
+        read_count++;
+      }
+      else {
+        torn_count++;
+      }
+    }
+    else {
+      missed_count++;
+    }
+    next_frame_index++;
+    ring->reader_frame_index = next_frame_index + 1;
+    ring->reader_dropped_count = missed_count + torn_count;
+  }
+  ring->reader_frame_index = 0;
+
+  U64 frame_count = read_count + missed_count + torn_count;
+  printf("%llu frames: %llu read (%.1f%%), %llu missed, %llu torn; %.0f commands a frame, %.1f us a read (%08x)\n",
+    (unsigned long long)frame_count, (unsigned long long)read_count, frame_count ? 100.0*read_count/frame_count : 0.0,
+    (unsigned long long)missed_count, (unsigned long long)torn_count, read_count ? (F64)command_count/read_count : 0.0,
+    frame_count - missed_count ? read_time*1e6/(frame_count - missed_count) : 0.0, checksum);
+  printf("producer counted %llu too big, %llu overwritten unread meanwhile\n",
+    (unsigned long long)(ring->too_big_count - too_big_count),
+    (unsigned long long)(ring->overwritten_count - overwritten_count));
+  return 0;
+}
@@ -0,0 +1,262 @@
+#include "tools.h"
+#include "levels.h"
+#include "spsc_queue.h"
+
+#include <stdio.h>
+
+/*
+  pack_levels writes a level pack of variants of the default level (random holes in the classic layout), bench_levels
+  maps one and times opening it and decoding its levels, the way the game does with "-levels".
+
+  bench_generator times the procedural levels of endless mode, checks that they come out the same on any number of
+  threads, and pushes them through a prefetch queue like the game's generator thread does.
+*/
+
+internal
+U32 levels_random(U32 *state)
+{
+  U32 x = *state;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  *state = x;
+  return x;
+}
+
+int tool_pack_levels(int argc, char **argv)
+{
+  if(argc < 1) {
+    fprintf(stderr, "pack_levels needs an output path\n");
+    return 1;
+  }
+  char *path = argv[0];
+  int level_count = tools_int_argument(argc, argv, 1, 1000);
+  int seed = tools_int_argument(argc, argv, 2, 1);
+  if(level_count < 1) {
+    fprintf(stderr, "level_count must be positive\n");
+    return 1;
+  }
+
+  Level *levels = tools_allocate(level_count*sizeof(Level));
+  U32 random_state = (U32)seed*2654435761u | 1;
+  Level default_level;
+  level_make_default(&default_level);
+  for(int level_index = 0; level_index < level_count; level_index++) {
+    // NOTE(leo): Level 0 is the default level, the rest keep 50-100% of its bricks
+    Level *level = &levels[level_index];
+    U32 keep_percent = level_index == 0 ? 100 : 50 + levels_random(&random_state)%51;
+    for(int brick_index = 0; brick_index < default_level.brick_count; brick_index++) {
+      if(levels_random(&random_state)%100 >= keep_percent)
+        continue;
+      int index = level->brick_count++;
+      level->brick_rects[index] = default_level.brick_rects[brick_index];
+      level->brick_types[index] = default_level.brick_types[brick_index];
+      level->brick_max_hps[index] = default_level.brick_max_hps[brick_index];
+      level->brick_scores[index] = default_level.brick_scores[brick_index];
+      level->brick_colors[index] = default_level.brick_colors[brick_index];
+    }
+    if(!level->brick_count)
+      level_copy(level, &default_level);
+  }
+
+  U64 size = level_pack_compute_size(levels, level_count);
+  U8 *data = tools_allocate(size);
+  level_pack_write(levels, level_count, data);
+
+  FILE *file = fopen(path, "wb");
+  if(!file || fwrite(data, 1, size, file) != size) {
+    fprintf(stderr, "could not write %s\n", path);
+    return 1;
+  }
+  fclose(file);
+  printf("pack_levels: %d levels, %llu bytes to %s\n", level_count, (unsigned long long)size, path);
+  return 0;
+}
+
+int tool_bench_levels(int argc, char **argv)
+{
+  if(argc < 1) {
+    fprintf(stderr, "bench_levels needs a level pack path\n");
+    return 1;
+  }
+  char *path = argv[0];
+  int pass_count = tools_int_argument(argc, argv, 1, 10);
+  if(pass_count < 1) {
+    fprintf(stderr, "pass_count must be positive\n");
+    return 1;
+  }
+
+  F64 open_start = tools_seconds();
+  void *data;
+  U64 size;
+  if(!tools_map_file(path, &data, &size)) {
+    fprintf(stderr, "could not map %s\n", path);
+    return 1;
+  }
+  F64 map_time = tools_seconds() - open_start;
+
+  LevelPack pack;
+  F64 pack_start = tools_seconds();
+  bool is_open = level_pack_open(&pack, data, size);
+  F64 pack_open_time = tools_seconds() - pack_start;
+  if(!is_open || !pack.level_count) {
+    fprintf(stderr, "%s is not a level pack or has no levels\n", path);
+    return 1;
+  }
+  printf("bench_levels: %u levels, %llu bytes. map %.1f us, level_pack_open %.3f us\n", pack.level_count,
+    (unsigned long long)size, map_time*1e6, pack_open_time*1e6);
+
+  // NOTE(leo): The first pass also reads the pages in
+  Level *level = tools_allocate(sizeof(Level));
+  U64 brick_count = 0;
+  int broken_count = 0;
+  F64 first_pass_time = 0.0;
+  F64 start = tools_seconds();
+  for(int pass = 0; pass < pass_count; pass++) {
+    for(U32 level_index = 0; level_index < pack.level_count; level_index++) {
+      if(level_pack_decode(&pack, (int)level_index, level))
+        brick_count += level->brick_count;
+      else
+        broken_count++;
+    }
+    if(pass == 0)
+      first_pass_time = tools_seconds() - start;
+  }
+  F64 elapsed = tools_seconds() - start;
+
+  F64 decode_count = (F64)pack.level_count*pass_count;
+  printf("decode: first pass %.3f us/level, %d passes %.3f us/level, %.1f ns/brick, %d broken\n",
+    first_pass_time*1e6/pack.level_count, pass_count, elapsed*1e6/decode_count,
+    brick_count ? elapsed*1e9/brick_count : 0.0, broken_count/pass_count);
+  return 0;
+}
+
+internal
+U64 levels_hash(Level *level)
+{
+  // NOTE(leo): FNV-1a over the bricks
+  U64 result = 0xCBF29CE484222325ull;
+  U8 *bytes[] = {
+    (U8 *)level->brick_rects, level->brick_types, level->brick_max_hps, (U8 *)level->brick_scores, (U8 *)level->brick_colors,
+  };
+  size_t sizes[] = { sizeof(Rect), sizeof(U8), sizeof(U8), sizeof(U16), sizeof(U32) };
+  for(int array_index = 0; array_index < array_count(bytes); array_index++) {
+    for(size_t i = 0; i < level->brick_count*sizes[array_index]; i++)
+      result = (result ^ bytes[array_index][i])*0x100000001B3ull;
+  }
+  return result;
+}
+
+#define GENERATOR_QUEUE_CAPACITY 4
+
+typedef struct Generator {
+  U32 seed;
+  int level_count;
+  Level *levels; // NOTE(leo): Scratch, one per thread
+  U64 *hashes;
+  int *attempt_counts;
+
+  // NOTE(leo): Prefetch run
+  SpscQueue queue;
+  Level queue_levels[GENERATOR_QUEUE_CAPACITY];
+  U64 prefetch_hash;
+  int empty_count; // NOTE(leo): Levels that weren't ready in time
+  F64 max_pop_time;
+} Generator;
+
+internal
+void generator_generate(void *data, int item_index, int thread_index)
+{
+  Generator *generator = data;
+  Level *level = &generator->levels[thread_index];
+  generator->attempt_counts[item_index] = level_generate_valid(level, generator->seed, (U32)item_index);
+  generator->hashes[item_index] = levels_hash(level);
+}
+
+// NOTE(leo): Item 0 fills the queue like the game's generator thread, item 1 takes levels off it as fast as it can,
+// like a game clearing a level every frame
+internal
+void generator_prefetch(void *data, int item_index, int thread_index)
+{
+  Generator *generator = data;
+  Level *level = &generator->levels[thread_index];
+  for(int level_index = 0; level_index < generator->level_count; level_index++) {
+    if(item_index == 0) {
+      level_generate_valid(level, generator->seed, (U32)level_index);
+      while(!spsc_queue_push(&generator->queue, level))
+        SwitchToThread();
+    }
+    else {
+      // NOTE(leo): The game doesn't wait when the queue is empty, this only waits to count the levels that would
+      // have been missed. Only pops that got a level are timed
+      for(;;) {
+        F64 start = tools_seconds();
+        bool is_popped = spsc_queue_pop(&generator->queue, level);
+        F64 pop_time = tools_seconds() - start;
+        if(is_popped) {
+          if(pop_time > generator->max_pop_time)
+            generator->max_pop_time = pop_time;
+          break;
+        }
+        generator->empty_count++;
+        while(!spsc_queue_count(&generator->queue))
+          SwitchToThread();
+      }
+      generator->prefetch_hash = generator->prefetch_hash*31 + levels_hash(level);
+    }
+  }
+}
+
+int tool_bench_generator(int argc, char **argv)
+{
+  int level_count = tools_int_argument(argc, argv, 0, 10000);
+  int thread_count = tools_thread_count(tools_int_argument(argc, argv, 1, 0));
+  int seed = tools_int_argument(argc, argv, 2, 1);
+  if(level_count < 1) {
+    fprintf(stderr, "level_count must be positive\n");
+    return 1;
+  }
+
+  Generator *generator = tools_allocate(sizeof(Generator));
+  generator->seed = (U32)seed;
+  generator->level_count = level_count;
+  generator->levels = tools_allocate(TOOLS_MAX_THREAD_COUNT*sizeof(Level));
+  generator->hashes = tools_allocate(level_count*sizeof(U64));
+  generator->attempt_counts = tools_allocate(level_count*sizeof(int));
+  printf("bench_generator: %d levels, seed %d\n", level_count, seed);
+
+  F64 start = tools_seconds();
+  tools_parallel_for(level_count, 1, generator_generate, generator);
+  F64 single_time = tools_seconds() - start;
+
+  U64 single_hash = 0;
+  int attempt_count = 0;
+  int max_attempt_count = 0;
+  for(int level_index = 0; level_index < level_count; level_index++) {
+    single_hash = single_hash*31 + generator->hashes[level_index];
+    attempt_count += generator->attempt_counts[level_index];
+    if(generator->attempt_counts[level_index] > max_attempt_count)
+      max_attempt_count = generator->attempt_counts[level_index];
+  }
+  printf("1 thread: %.0f layouts/s, %.2f seeds tried per layout (%d at most)\n", level_count/single_time,
+    (F64)attempt_count/level_count, max_attempt_count);
+
+  start = tools_seconds();
+  tools_parallel_for(level_count, thread_count, generator_generate, generator);
+  F64 parallel_time = tools_seconds() - start;
+  U64 parallel_hash = 0;
+  for(int level_index = 0; level_index < level_count; level_index++)
+    parallel_hash = parallel_hash*31 + generator->hashes[level_index];
+  printf("%d threads: %.0f layouts/s, %s\n", thread_count, level_count/parallel_time,
+    parallel_hash == single_hash ? "same layouts" : "DIFFERENT LAYOUTS");
+
+  spsc_queue_init(&generator->queue, generator->queue_levels, sizeof(Level), GENERATOR_QUEUE_CAPACITY);
+  start = tools_seconds();
+  tools_parallel_for(2, 2, generator_prefetch, generator);
+  F64 prefetch_time = tools_seconds() - start;
+  printf("prefetch queue: %.0f layouts/s through it, %s, pop %.2f us at most, found empty %d times\n",
+    level_count/prefetch_time, generator->prefetch_hash == single_hash ? "same layouts" : "DIFFERENT LAYOUTS",
+    generator->max_pop_time*1e6, generator->empty_count);
+
+  return parallel_hash == single_hash && generator->prefetch_hash == single_hash ? 0 : 1;
+}
@@ -0,0 +1,158 @@
+#include "tools.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct Tool {
+  char *name;
+  char *arguments;
+  ToolMain *main;
+} Tool;
+
+global_variable Tool tools[] = {
+  { "bench_particles", "[particle_count=100000] [frame_count=1000]", tool_bench_particles },
+  { "bench_power_ups", "[power_up_count=4000] [frame_count=1000]", tool_bench_power_ups },
+  { "soak", "[game_count=10000] [thread_count=0 (all)] [difficulty_factor_percent=100] [dt_ms=16]", tool_soak },
+  { "plan", "[game_count=2] [thread_count=0 (all)] [beam_width=8] [depth=8] [objective=score|clear]", tool_plan },
+  { "pack_levels", "<path> [level_count=1000] [seed=1]", tool_pack_levels },
+  { "bench_levels", "<path> [pass_count=10]", tool_bench_levels },
+  { "bench_generator", "[level_count=10000] [thread_count=0 (all)] [seed=1]", tool_bench_generator },
+  { "bench_scroll", "[frame_count=100000] [speed_percent=500] [seed=1]", tool_bench_scroll },
+  { "bench_bricks", "[max_brick_count=65536] [sweep_count=1000000] [seed=1]", tool_bench_bricks },
+  { "bench_snapshots", "[game_count=20] [scroll_speed_percent=0 (not scrolling)] [seed=1]", tool_bench_snapshots },
+  { "serve_games", "[session_count=10000] [worker_count=0 (all)] [client_thread_count=0 (same)] [seconds=10] [tick_rate=60]", tool_serve_games },
+  { "record_spectator", "<path|-> [game_count=20] [ack_delay=2] [keyframe_interval=300] [seed=1]", tool_record_spectator },
+  { "watch_spectator", "<path|-> [join_frame=0]", tool_watch_spectator },
+  { "publish_frames", "[seconds=10] [frame_rate=60 (0: as fast as it goes)] [seed=1]", tool_publish_frames },
+  { "capture_frames", "[seconds=10] [work_us=0]", tool_capture_frames },
+  { "record_render_trace", "<path> [game_count=3] [seed=1]", tool_record_render_trace },
+  { "replay_render_trace", "<path> [backend=all|null|gl|software] [pass_count=3]", tool_replay_render_trace },
+  { "analyse_levels", "<pack_path> <results_path> [max_games=64] [thread_count=0 (all)] [aim_error_percent=10] [tolerance_percent=10]", tool_analyse_levels },
+  { "tune", "[games_per_setting=200] [thread_count=0 (all)] [difficulty_factor_percent=100] [dt_ms=33] [aim_error_percent=30]", tool_tune },
+};
+
+F64 tools_seconds(void)
+{
+  local_persist F64 inv_frequency;
+  if(!inv_frequency) {
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    inv_frequency = 1.0/(F64)frequency.QuadPart;
+  }
+  LARGE_INTEGER counter;
+  QueryPerformanceCounter(&counter);
+  return (F64)counter.QuadPart*inv_frequency;
+}
+
+void *tools_allocate(size_t size)
+{
+  void *result = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+  if(!result) {
+    fprintf(stderr, "out of memory (%zu bytes)\n", size);
+    exit(1);
+  }
+  return result;
+}
+
+int tools_int_argument(int argc, char **argv, int index, int default_value)
+{
+  if(index < argc)
+    return atoi(argv[index]);
+  return default_value;
+}
+
+bool tools_map_file(char *path, void **data, U64 *size)
+{
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if(file == INVALID_HANDLE_VALUE)
+    return false;
+  LARGE_INTEGER file_size = { 0 };
+  HANDLE mapping = NULL;
+  if(GetFileSizeEx(file, &file_size) && file_size.QuadPart > 0)
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  if(!mapping)
+    return false;
+  *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  *size = (U64)file_size.QuadPart;
+  return *data != NULL;
+}
+
+int tools_thread_count(int thread_count)
+{
+  if(thread_count <= 0)
+    thread_count = (int)GetActiveProcessorCount(ALL_PROCESSOR_GROUPS);
+  if(thread_count < 1)
+    thread_count = 1;
+  if(thread_count > TOOLS_MAX_THREAD_COUNT)
+    thread_count = TOOLS_MAX_THREAD_COUNT;
+  return thread_count;
+}
+
+typedef struct ToolsParallelFor {
+  ToolsWork *work;
+  void *data;
+  int item_count;
+  volatile LONG next_item_index;
+} ToolsParallelFor;
+
+typedef struct ToolsWorker {
+  ToolsParallelFor *parallel_for;
+  int thread_index;
+} ToolsWorker;
+
+internal
+DWORD WINAPI tools_worker_proc(void *parameter)
+{
+  ToolsWorker *worker = parameter;
+  ToolsParallelFor *parallel_for = worker->parallel_for;
+  for(;;) {
+    int item_index = (int)InterlockedIncrement(&parallel_for->next_item_index) - 1;
+    if(item_index >= parallel_for->item_count)
+      break;
+    parallel_for->work(parallel_for->data, item_index, worker->thread_index);
+  }
+  return 0;
+}
+
+void tools_parallel_for(int item_count, int thread_count, ToolsWork *work, void *data)
+{
+  thread_count = tools_thread_count(thread_count);
+
+  ToolsParallelFor parallel_for = { .work = work, .data = data, .item_count = item_count };
+  ToolsWorker workers[TOOLS_MAX_THREAD_COUNT];
+  HANDLE threads[TOOLS_MAX_THREAD_COUNT];
+
+  // NOTE(leo): The calling thread is worker 0
+  for(int thread_index = 0; thread_index < thread_count; thread_index++)
+    workers[thread_index] = (ToolsWorker){ .parallel_for = &parallel_for, .thread_index = thread_index };
+  for(int thread_index = 1; thread_index < thread_count; thread_index++) {
+    threads[thread_index] = CreateThread(NULL, 0, tools_worker_proc, &workers[thread_index], 0, NULL);
+    if(!threads[thread_index]) {
+      fprintf(stderr, "failed to create thread\n");
+      exit(1);
+    }
+  }
+  tools_worker_proc(&workers[0]);
+  for(int thread_index = 1; thread_index < thread_count; thread_index++) {
+    WaitForSingleObject(threads[thread_index], INFINITE);
+    CloseHandle(threads[thread_index]);
+  }
+}
+
+int main(int argc, char **argv)
+{
+  if(argc >= 2) {
+    for(int tool_index = 0; tool_index < array_count(tools); tool_index++) {
+      if(strcmp(argv[1], tools[tool_index].name) == 0)
+        return tools[tool_index].main(argc - 2, argv + 2);
+    }
+  }
+
+  fprintf(stderr, "usage: breakout_tools <tool> [arguments]\n");
+  for(int tool_index = 0; tool_index < array_count(tools); tool_index++)
+    fprintf(stderr, "  %s %s\n", tools[tool_index].name, tools[tool_index].arguments);
+  return 1;
+}
@@ -0,0 +1,61 @@
+#include "tools.h"
+#include "particles.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// NOTE(leo): Budget of particles_update per frame, on one core
+#define PARTICLE_UPDATE_BUDGET_MS 1.0
+
+int tool_bench_particles(int argc, char **argv)
+{
+  int particle_count = tools_int_argument(argc, argv, 0, 100000);
+  int frame_count = tools_int_argument(argc, argv, 1, 1000);
+  if(particle_count < 1 || particle_count > PARTICLE_CAPACITY || frame_count < 1) {
+    fprintf(stderr, "particle_count must be in 1-%d, frame_count positive\n", PARTICLE_CAPACITY);
+    return 1;
+  }
+
+  ParticleSystem *particles = tools_allocate(sizeof(ParticleSystem));
+
+  RenderCmdBuffer cmd_buffer = {
+    .commands = tools_allocate(PARTICLE_MAX_DRAW_COUNT*sizeof(RectangleCmd)),
+    .capacity = PARTICLE_MAX_DRAW_COUNT,
+  };
+
+  // NOTE(leo): Lifetime long enough that everything stays alive for the whole run
+  F32 lifetime = 2.0f*frame_count/60.0f + 1.0f;
+  for(int spawned = 0; spawned < particle_count; spawned += 24) {
+    int count = min(24, particle_count - spawned);
+    V2 pos = { (F32)(spawned % 100), 90.0f };
+    particles_spawn_burst(particles, pos, count, 30.0f, lifetime, COLOR_WHITE);
+  }
+
+  F64 total_update = 0.0;
+  F64 max_update = 0.0;
+  F64 total_draw = 0.0;
+  for(int frame = 0; frame < frame_count; frame++) {
+    F64 start = tools_seconds();
+    particles_update(particles, 1.0f/60.0f);
+    F64 update = tools_seconds() - start;
+
+    cmd_buffer.count = 0;
+    start = tools_seconds();
+    particles_draw(particles, (V2) { 2.0f, 0.0f }, PARTICLE_MAX_DRAW_COUNT, &cmd_buffer);
+    F64 draw = tools_seconds() - start;
+
+    total_update += update;
+    total_draw += draw;
+    if(update > max_update)
+      max_update = update;
+  }
+
+  F64 mean_update_ms = 1000.0*total_update/frame_count;
+  printf("particles: %u live, %d frames\n", particles->live_count, frame_count);
+  printf("update: %.3f ms mean, %.3f ms max (%.1f ns/particle)\n",
+    mean_update_ms, 1000.0*max_update, 1e9*total_update/frame_count/particle_count);
+  printf("draw: %.3f ms mean, %d commands, %d dropped\n", 1000.0*total_draw/frame_count, cmd_buffer.count, cmd_buffer.dropped_count);
+  printf("%s (budget %.1f ms)\n", mean_update_ms <= PARTICLE_UPDATE_BUDGET_MS ? "ok" : "OVER BUDGET", PARTICLE_UPDATE_BUDGET_MS);
+
+  return mean_update_ms <= PARTICLE_UPDATE_BUDGET_MS ? 0 : 1;
+}
@@ -0,0 +1,217 @@
+#include "tools.h"
+#include "breakout.h"
+#include "autoplayer.h"
+
+#include <intrin.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+  Beam search over paddle controls, replanned every step.
+
+  A move holds one paddle control for PLANNER_STEP_FRAME_COUNT frames. Move 0 is the autoplayer (asked again every
+  frame), the others are fixed controls spread over the arena. Each step of the search expands every state in the
+  beam with every move on copies (game_state_copy, game_update without rendering), in parallel, and keeps the best
+  beam_width of them. After depth steps the first move that led to the best state is played for real.
+
+  A rollout is one move played out on one copy.
+*/
+
+#define PLANNER_FIXED_CONTROL_COUNT 8
+#define PLANNER_MOVE_COUNT (1 + PLANNER_FIXED_CONTROL_COUNT)
+#define PLANNER_DT (1.0f/30.0f)
+#define PLANNER_STEP_FRAME_COUNT 15
+#define PLANNER_MAX_BEAM_WIDTH 64
+#define PLANNER_MAX_DEPTH 32
+// NOTE(leo): More than a whole game's worth of points, so a search never trades a ball for score
+#define PLANNER_LOST_ROUND_PENALTY 100000.0f
+// NOTE(leo): 20 minutes of game time
+#define PLANNER_MAX_FRAME_COUNT (20*60*30)
+
+enum {
+  PLANNER_OBJECTIVE_SCORE, // NOTE(leo): Most points
+  PLANNER_OBJECTIVE_CLEAR, // NOTE(leo): Most bricks soonest, ie: least time to clear
+};
+
+typedef struct PlannerNode {
+  GameState game_state;
+  int first_move;
+  int round_count; // NOTE(leo): Rounds lost on the way here
+  F32 value;
+} PlannerNode;
+
+typedef struct Planner {
+  int beam_width;
+  int depth;
+  int objective;
+
+  int beam_count;
+  PlannerNode *beam;
+  PlannerNode *children; // NOTE(leo): beam_width*PLANNER_MOVE_COUNT
+  bool is_first_step;
+
+  // NOTE(leo): Stats, summed over all threads
+  volatile LONG64 rollout_count;
+  volatile LONG64 clone_cycles;
+  volatile LONG64 clone_count;
+} Planner;
+
+internal
+F32 planner_control(int move, GameState *game_state)
+{
+  if(move == 0)
+    return autoplayer_paddle_control(game_state);
+  return (F32)(move - 1)/(F32)(PLANNER_FIXED_CONTROL_COUNT - 1);
+}
+
+internal
+F32 planner_evaluate(Planner *planner, PlannerNode *node)
+{
+  GameState *game_state = &node->game_state;
+  F32 result = -PLANNER_LOST_ROUND_PENALTY*node->round_count;
+  if(planner->objective == PLANNER_OBJECTIVE_SCORE) {
+    result += game_state->score;
+  }
+  else {
+    // NOTE(leo): The first set is already reset once it's cleared. Counts as more than any level has
+    int broken_count = game_state->level.brick_count - game_state->bricks_remaining;
+    if(game_state->has_cleared_bricks)
+      broken_count += MAX_BRICK_COUNT;
+    result += broken_count;
+  }
+  return result;
+}
+
+internal
+void planner_expand(void *data, int child_index, int thread_index)
+{
+  Planner *planner = data;
+  PlannerNode *parent = &planner->beam[child_index/PLANNER_MOVE_COUNT];
+  PlannerNode *child = &planner->children[child_index];
+  int move = child_index%PLANNER_MOVE_COUNT;
+
+  U64 start_cycles = __rdtsc();
+  game_state_copy(&child->game_state, &parent->game_state);
+  InterlockedExchangeAdd64(&planner->clone_cycles, (LONG64)(__rdtsc() - start_cycles));
+  InterlockedIncrement64(&planner->clone_count);
+
+  child->first_move = planner->is_first_step ? move : parent->first_move;
+  child->round_count = parent->round_count;
+
+  // NOTE(leo): A lost round ends the line, the rest would only be the reset animation
+  GameState *game_state = &child->game_state;
+  Input input = { .paddle_control = -1.0f };
+  for(int frame = 0; frame < PLANNER_STEP_FRAME_COUNT && game_state->state == GAME_STATE_PLAYING; frame++) {
+    input.paddle_control = planner_control(move, game_state);
+    game_update(game_state, PLANNER_DT, &input, NULL, NULL, NULL);
+    if(game_state->state == GAME_STATE_RESET_PADDLE
+      || (game_state->state == GAME_STATE_GAME_OVER && game_state->bricks_remaining))
+      child->round_count++;
+  }
+  child->value = planner_evaluate(planner, child);
+  InterlockedIncrement64(&planner->rollout_count);
+}
+
+// NOTE(leo): First move of the best line found from game_state
+internal
+int planner_choose_move(Planner *planner, GameState *game_state, int thread_count)
+{
+  game_state_copy(&planner->beam[0].game_state, game_state);
+  planner->beam[0].first_move = 0;
+  planner->beam[0].round_count = 0;
+  planner->beam_count = 1;
+
+  for(int step = 0; step < planner->depth; step++) {
+    planner->is_first_step = step == 0;
+    int child_count = planner->beam_count*PLANNER_MOVE_COUNT;
+    tools_parallel_for(child_count, thread_count, planner_expand, planner);
+
+    // NOTE(leo): Keep the best beam_width children. Earlier children win ties, so the autoplayer does
+    int keep_count = child_count < planner->beam_width ? child_count : planner->beam_width;
+    bool is_kept[PLANNER_MAX_BEAM_WIDTH*PLANNER_MOVE_COUNT] = { 0 };
+    int kept_indices[PLANNER_MAX_BEAM_WIDTH];
+    for(int keep_index = 0; keep_index < keep_count; keep_index++) {
+      int best_index = -1;
+      for(int child_index = 0; child_index < child_count; child_index++) {
+        if(!is_kept[child_index] && (best_index < 0 || planner->children[child_index].value > planner->children[best_index].value))
+          best_index = child_index;
+      }
+      is_kept[best_index] = true;
+      kept_indices[keep_index] = best_index;
+    }
+
+    for(int keep_index = 0; keep_index < keep_count; keep_index++) {
+      PlannerNode *kept = &planner->children[kept_indices[keep_index]];
+      PlannerNode *node = &planner->beam[keep_index];
+      game_state_copy(&node->game_state, &kept->game_state);
+      node->first_move = kept->first_move;
+      node->round_count = kept->round_count;
+      node->value = kept->value;
+    }
+    planner->beam_count = keep_count;
+  }
+
+  // NOTE(leo): The beam is sorted best first
+  return planner->beam[0].first_move;
+}
+
+int tool_plan(int argc, char **argv)
+{
+  int game_count = tools_int_argument(argc, argv, 0, 2);
+  int thread_count = tools_thread_count(tools_int_argument(argc, argv, 1, 0));
+  int beam_width = tools_int_argument(argc, argv, 2, 8);
+  int depth = tools_int_argument(argc, argv, 3, 8);
+  char *objective_name = argc > 4 ? argv[4] : "score";
+  int objective = PLANNER_OBJECTIVE_SCORE;
+  if(strcmp(objective_name, "clear") == 0)
+    objective = PLANNER_OBJECTIVE_CLEAR;
+  else if(strcmp(objective_name, "score") != 0)
+    objective = -1;
+  if(game_count < 1 || beam_width < 1 || beam_width > PLANNER_MAX_BEAM_WIDTH || depth < 1 || depth > PLANNER_MAX_DEPTH || objective < 0) {
+    fprintf(stderr, "game_count positive, beam_width in 1-%d, depth in 1-%d, objective score or clear\n",
+      PLANNER_MAX_BEAM_WIDTH, PLANNER_MAX_DEPTH);
+    return 1;
+  }
+
+  Planner *planner = tools_allocate(sizeof(Planner));
+  planner->beam_width = beam_width;
+  planner->depth = depth;
+  planner->objective = objective;
+  planner->beam = tools_allocate(beam_width*sizeof(PlannerNode));
+  planner->children = tools_allocate(beam_width*PLANNER_MOVE_COUNT*sizeof(PlannerNode));
+  GameState *game_state = tools_allocate(sizeof(GameState));
+
+  printf("plan: %d games, %d threads, beam %d, depth %d (%.1f s ahead), objective %s\n", game_count, thread_count,
+    beam_width, depth, depth*PLANNER_STEP_FRAME_COUNT*PLANNER_DT, objective_name);
+
+  F64 start = tools_seconds();
+  for(int game_index = 0; game_index < game_count; game_index++) {
+    *game_state = (GameState){ .random_state = (U32)game_index*2654435761u + 1 };
+    Input input = { .paddle_control = -1.0f };
+    game_update(game_state, PLANNER_DT, &input, NULL, NULL, NULL);
+    switch_to_reset_game(game_state, false, true);
+
+    int frame = 0;
+    int move = 0;
+    while(frame < PLANNER_MAX_FRAME_COUNT && game_state->state != GAME_STATE_GAME_OVER) {
+      if(game_state->state == GAME_STATE_WAIT_SERVE)
+        game_serve(game_state);
+
+      if(game_state->state == GAME_STATE_PLAYING && frame%PLANNER_STEP_FRAME_COUNT == 0)
+        move = planner_choose_move(planner, game_state, thread_count);
+      input.paddle_control = game_state->state == GAME_STATE_PLAYING ? planner_control(move, game_state) : -1.0f;
+      game_update(game_state, PLANNER_DT, &input, NULL, NULL, NULL);
+      frame++;
+    }
+    printf("game %d: score %d, %s after %.0f s\n", game_index, game_state->score,
+      game_state->bricks_remaining == 0 ? "cleared" : (frame == PLANNER_MAX_FRAME_COUNT ? "timed out" : "lost"),
+      frame*PLANNER_DT);
+  }
+  F64 elapsed = tools_seconds() - start;
+
+  printf("%.0f rollouts/s (%lld rollouts of %d frames, %.2f s)\n", planner->rollout_count/elapsed,
+    (long long)planner->rollout_count, PLANNER_STEP_FRAME_COUNT, elapsed);
+  printf("game_state_copy: %.0f cycles mean\n",
+    planner->clone_count ? (F64)planner->clone_cycles/planner->clone_count : 0.0);
+  return 0;
+}
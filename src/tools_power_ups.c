@@ -0,0 +1,170 @@
+#include "tools.h"
+#include "breakout.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// NOTE(leo): Stress sizes, far past what a game drops. A game's pool only holds POWER_UP_CAPACITY, so the power-ups
+// are spread over as many games as that takes, all stepped every frame
+#define BENCH_POWER_UPS_MAX_COUNT 4096
+#define BENCH_POWER_UPS_STALE_COUNT 4096 // NOTE(leo): Power of two
+#define BENCH_POWER_UPS_STATIC_CAPACITY 256
+
+/*
+  Besides timing the update, checks the handles: every one spawn returned here is kept, and after every frame the ones
+  of live power-ups must resolve to a power-up of the right slot and type, each to its own, while the handles
+  of power-ups gone (collected, fallen out, cleared, or destroyed here, one a frame) must stay stale even once their
+  slots are reused.
+*/
+typedef struct BenchPowerUpHandle {
+  EntityHandle handle;
+  U8 type;
+} BenchPowerUpHandle;
+
+typedef struct BenchPowerUpHandles {
+  int live_count;
+  BenchPowerUpHandle live[POWER_UP_CAPACITY];
+  U32 stale_write_index;
+  EntityHandle stale[BENCH_POWER_UPS_STALE_COUNT]; // NOTE(leo): Ring of the latest gone
+  U8 is_resolved[POWER_UP_CAPACITY]; // NOTE(leo): By dense index, this frame
+  int error_count;
+} BenchPowerUpHandles;
+
+typedef struct BenchPowerUpGame {
+  GameState game_state;
+  RenderLayer static_layer;
+  BenchPowerUpHandles handles;
+} BenchPowerUpGame;
+
+internal
+void bench_power_ups_retire(BenchPowerUpHandles *handles, int live_index)
+{
+  handles->stale[handles->stale_write_index++ & (BENCH_POWER_UPS_STALE_COUNT - 1)] = handles->live[live_index].handle;
+  handles->live[live_index] = handles->live[--handles->live_count];
+}
+
+internal
+void bench_power_ups_check_handles(BenchPowerUpHandles *handles, PowerUpPool *pool)
+{
+  memset(handles->is_resolved, 0, pool->count);
+  for(int live_index = 0; live_index < handles->live_count;) {
+    BenchPowerUpHandle *live = &handles->live[live_index];
+    int index = power_up_lookup(pool, live->handle);
+    if(index < 0) {
+      bench_power_ups_retire(handles, live_index);
+      continue;
+    }
+    if(index >= pool->count || handles->is_resolved[index] || pool->slot[index] != (live->handle & 0xFFFF) - 1
+      || pool->type[index] != live->type)
+      handles->error_count++;
+    else
+      handles->is_resolved[index] = 1;
+    live_index++;
+  }
+  // NOTE(leo): Each resolved to its own power-up. The pool may have more, dropped by bricks the ball broke
+  if(handles->live_count > pool->count)
+    handles->error_count++;
+
+  U32 stale_count = handles->stale_write_index;
+  if(stale_count > BENCH_POWER_UPS_STALE_COUNT)
+    stale_count = BENCH_POWER_UPS_STALE_COUNT;
+  for(U32 stale_index = 0; stale_index < stale_count; stale_index++) {
+    if(power_up_lookup(pool, handles->stale[stale_index]) != -1)
+      handles->error_count++;
+  }
+}
+
+int tool_bench_power_ups(int argc, char **argv)
+{
+  int power_up_count = tools_int_argument(argc, argv, 0, 4000);
+  int frame_count = tools_int_argument(argc, argv, 1, 1000);
+  if(power_up_count < 0 || power_up_count > BENCH_POWER_UPS_MAX_COUNT || frame_count < 1) {
+    fprintf(stderr, "power_up_count must be in 0-%d, frame_count positive\n", BENCH_POWER_UPS_MAX_COUNT);
+    return 1;
+  }
+
+  int game_count = (power_up_count + POWER_UP_CAPACITY - 1)/POWER_UP_CAPACITY;
+  if(game_count < 1)
+    game_count = 1;
+  BenchPowerUpGame *games = tools_allocate(game_count*sizeof(BenchPowerUpGame));
+  RenderCmdBuffer cmd_buffer = {
+    .commands = tools_allocate((POWER_UP_CAPACITY + 64)*sizeof(RectangleCmd)),
+    .capacity = POWER_UP_CAPACITY + 64,
+  };
+  Input input = { .paddle_control = -1.0f };
+
+  for(int game_index = 0; game_index < game_count; game_index++) {
+    BenchPowerUpGame *game = &games[game_index];
+    game->static_layer.cmd_buffer = (RenderCmdBuffer){
+      .commands = tools_allocate(BENCH_POWER_UPS_STATIC_CAPACITY*sizeof(RectangleCmd)),
+      .capacity = BENCH_POWER_UPS_STATIC_CAPACITY,
+    };
+    game_update(&game->game_state, 1.0f/60.0f, &input, NULL, &game->static_layer, &cmd_buffer);
+    game->game_state.balls_remaining = 1000000;
+    game_serve(&game->game_state);
+  }
+
+  U64 total_cycles = 0;
+  int total_count = 0;
+  int error_count = 0;
+  U32 gone_count = 0;
+  F64 elapsed = 0.0;
+  for(int frame = 0; frame < frame_count; frame++) {
+    for(int game_index = 0; game_index < game_count; game_index++) {
+      BenchPowerUpGame *game = &games[game_index];
+      GameState *game_state = &game->game_state;
+      BenchPowerUpHandles *handles = &game->handles;
+
+      // NOTE(leo): Keep the pool topped up to its share, spread over the height of the arena
+      int game_power_up_count = power_up_count - game_index*POWER_UP_CAPACITY;
+      if(game_power_up_count > POWER_UP_CAPACITY)
+        game_power_up_count = POWER_UP_CAPACITY;
+      while(game_state->power_ups.count < game_power_up_count) {
+        V2 pos = { (F32)rand()/RAND_MAX*(ARENA_WIDTH - POWER_UP_WIDTH), (F32)rand()/RAND_MAX*ARENA_HEIGHT };
+        U8 type = (U8)(rand() % POWER_UP_TYPE_COUNT);
+        EntityHandle handle = power_up_spawn(&game_state->power_ups, pos, type);
+        if(handle == NULL_ENTITY_HANDLE) {
+          handles->error_count++;
+          break;
+        }
+        handles->live[handles->live_count++] = (BenchPowerUpHandle){ .handle = handle, .type = type };
+      }
+
+      // NOTE(leo): Destroy one by handle, it must be gone right away
+      if(handles->live_count) {
+        int live_index = rand() % handles->live_count;
+        EntityHandle handle = handles->live[live_index].handle;
+        power_up_destroy(&game_state->power_ups, handle);
+        if(power_up_lookup(&game_state->power_ups, handle) != -1)
+          handles->error_count++;
+        bench_power_ups_retire(handles, live_index);
+      }
+      if(game_state->state != GAME_STATE_PLAYING)
+        game_serve(game_state);
+
+      Ball *ball = &game_state->balls[0];
+      input.paddle_control = (ball->rect.pos.x - game_state->paddle.dim.x/2.0f)/(ARENA_WIDTH - game_state->paddle.dim.x);
+      cmd_buffer.count = 0;
+      total_count += game_state->power_ups.count;
+      F64 start = tools_seconds();
+      game_update(game_state, 1.0f/60.0f, &input, NULL, &game->static_layer, &cmd_buffer);
+      elapsed += tools_seconds() - start;
+      total_cycles += game_state->power_ups.update_cycles;
+
+      bench_power_ups_check_handles(handles, &game_state->power_ups);
+    }
+  }
+  for(int game_index = 0; game_index < game_count; game_index++) {
+    error_count += games[game_index].handles.error_count;
+    gone_count += games[game_index].handles.stale_write_index;
+  }
+
+  printf("power-ups: %d per frame in %d games of %d at most, %d frames\n", power_up_count, game_count,
+    POWER_UP_CAPACITY, frame_count);
+  printf("power-up update: %d cycles mean per frame (%.1f cycles/entity)\n",
+    (int)(total_cycles/frame_count), total_count ? (F64)total_cycles/total_count : 0.0);
+  printf("game_update: %.3f ms mean per frame, all games\n", 1000.0*elapsed/frame_count);
+  printf("handles: %u gone, %d errors\n", gone_count, error_count);
+  return error_count ? 1 : 0;
+}
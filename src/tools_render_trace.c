@@ -0,0 +1,366 @@
+#include "tools.h"
+#include "breakout.h"
+#include "autoplayer.h"
+#include "particles.h"
+#include "rect_instance.h"
+#include "render_trace.h"
+#include "software_renderer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/*
+  record_render_trace has the bot play games, with particles, and writes the render trace of them (see render_trace.h):
+  each game fades in, sits in the main menu (drawn the way win32_breakout.c does), fades in again, is played to the end
+  and shows the game over menu. Every game gets another window size. Decodes every frame right away and checks it comes
+  out as what the game drew.
+
+  replay_render_trace plays a trace back through renderers as fast as they go, pass_count times each, and times them
+  apart from decoding:
+
+    null      nothing, just decoding
+    gl        the cpu half of the OpenGL renderer: packs the instances it uploads (the static layer only when it
+              changes). The gpu expands and fills them, it isn't in this
+    software  draws the frames into memory (software_renderer.h); the checksum is over every frame's pixels
+
+  Eg:
+
+    breakout_tools record_render_trace trace.bin 3
+    breakout_tools replay_render_trace trace.bin software
+*/
+
+#define RENDER_TRACE_TOOL_DT (1.0f/60.0f)
+#define RENDER_TRACE_TOOL_CAPACITY 65536 // NOTE(leo): Commands, each layer
+#define RENDER_TRACE_MENU_FRAME_COUNT 120
+#define RENDER_TRACE_GAME_OVER_FRAME_COUNT 60
+
+typedef enum RenderTraceFrameKind {
+  RENDER_TRACE_FRAME_MENU,
+  RENDER_TRACE_FRAME_RESET_FADE,
+  RENDER_TRACE_FRAME_GAMEPLAY,
+  RENDER_TRACE_FRAME_KIND_COUNT,
+} RenderTraceFrameKind;
+
+global_variable char *render_trace_frame_kind_names[RENDER_TRACE_FRAME_KIND_COUNT] = { "menu", "reset fade", "gameplay" };
+
+global_variable V2 render_trace_viewports[] = {
+  { 1280.0f, 720.0f },
+  { 1920.0f, 1080.0f },
+  { 800.0f, 600.0f },
+};
+
+// NOTE(leo): Header and menu entries, as win32_breakout.c draws them over the game
+internal
+void render_trace_draw_menu(char *header, char **texts, int text_count, RenderCmdBuffer *cmd_buffer)
+{
+  V2 cursor = { PLAYING_AREA_WIDTH/2.0f, PLAYING_AREA_HEIGHT/2.0f };
+  draw_text_centered(header, cursor, 1.5f, COLOR_WHITE, cmd_buffer);
+  cursor.y -= LINE_HEIGHT*1.5f * 1.5f;
+  for(int i = 0; i < text_count; i++) {
+    draw_text_centered(texts[i], cursor, 1.0f, COLOR_WHITE, cmd_buffer);
+    cursor.y -= LINE_HEIGHT*1.0f;
+  }
+}
+
+int tool_record_render_trace(int argc, char **argv)
+{
+  if(argc < 1) {
+    fprintf(stderr, "path missing\n");
+    return 1;
+  }
+  char *path = argv[0];
+  int game_count = tools_int_argument(argc, argv, 1, 3);
+  int seed = tools_int_argument(argc, argv, 2, 1);
+  if(game_count < 1) {
+    fprintf(stderr, "game_count positive\n");
+    return 1;
+  }
+  FILE *file = fopen(path, "wb");
+  RenderTraceHeader trace_header = { .magic = RENDER_TRACE_MAGIC, .version = RENDER_TRACE_VERSION };
+  if(!file || fwrite(&trace_header, sizeof(trace_header), 1, file) != 1) {
+    fprintf(stderr, "could not write %s\n", path);
+    return 1;
+  }
+
+  GameState *game_state = tools_allocate(sizeof(GameState));
+  ParticleSystem *particles = tools_allocate(sizeof(ParticleSystem));
+  RenderLayer static_layer = {
+    .cmd_buffer = {
+      .commands = tools_allocate(RENDER_TRACE_TOOL_CAPACITY*sizeof(RectangleCmd)),
+      .capacity = RENDER_TRACE_TOOL_CAPACITY,
+    },
+  };
+  RenderCmdBuffer cmd_buffer = {
+    .commands = tools_allocate(RENDER_TRACE_TOOL_CAPACITY*sizeof(RectangleCmd)),
+    .capacity = RENDER_TRACE_TOOL_CAPACITY,
+  };
+  RenderTraceState encoder;
+  RenderTraceState decoder;
+  render_trace_init(&encoder, tools_allocate(RENDER_TRACE_TOOL_CAPACITY*sizeof(RectangleCmd)),
+    tools_allocate(RENDER_TRACE_TOOL_CAPACITY*sizeof(RectangleCmd)), RENDER_TRACE_TOOL_CAPACITY);
+  render_trace_init(&decoder, tools_allocate(RENDER_TRACE_TOOL_CAPACITY*sizeof(RectangleCmd)),
+    tools_allocate(RENDER_TRACE_TOOL_CAPACITY*sizeof(RectangleCmd)), RENDER_TRACE_TOOL_CAPACITY);
+  U8 *data = tools_allocate(render_trace_max_frame_size(RENDER_TRACE_TOOL_CAPACITY, RENDER_TRACE_TOOL_CAPACITY));
+  printf("record_render_trace: %s, %d games, seed %d\n", path, game_count, seed);
+
+  U64 frame_counts[RENDER_TRACE_FRAME_KIND_COUNT] = { 0 };
+  U64 byte_counts[RENDER_TRACE_FRAME_KIND_COUNT] = { 0 };
+  U64 raw_byte_count = 0;
+  U64 command_count = 0;
+  U64 static_change_count = 0;
+  int max_count = 0;
+  F64 encode_time = 0.0;
+  int mismatch_count = 0;
+  bool is_written = true;
+  for(int game_index = 0; game_index < game_count && is_written; game_index++) {
+    V2 viewport = render_trace_viewports[game_index % array_count(render_trace_viewports)];
+    *game_state = (GameState){ .random_state = ((U32)seed + (U32)game_index)*2654435761u + 1 };
+    Input input = { .paddle_control = -1.0f };
+    game_update(game_state, RENDER_TRACE_TOOL_DT, &input, NULL, NULL, NULL);
+    // NOTE(leo): The static layer carries over between games, its version must not start over
+    game_state->static_layer_version = static_layer.version + 1;
+    switch_to_reset_game(game_state, true, true);
+
+    int menu_frame_count = 0;
+    int game_over_frame_count = 0;
+    int max_frame_count = (int)(BOT_GAME_MAX_TIME/RENDER_TRACE_TOOL_DT);
+    for(int frame = 0; frame < max_frame_count && game_over_frame_count < RENDER_TRACE_GAME_OVER_FRAME_COUNT
+      && is_written; frame++) {
+      // NOTE(leo): What the player would pick, a while after the menu shows up
+      if(game_state->state == GAME_STATE_MAIN_MENU && menu_frame_count == RENDER_TRACE_MENU_FRAME_COUNT)
+        switch_to_reset_game(game_state, false, true);
+      if(game_state->state == GAME_STATE_WAIT_SERVE)
+        game_serve(game_state);
+      input.paddle_control = game_state->state == GAME_STATE_PLAYING ? autoplayer_paddle_control(game_state) : -1.0f;
+      cmd_buffer.count = 0;
+      cmd_buffer.dropped_count = 0;
+      game_update(game_state, RENDER_TRACE_TOOL_DT, &input, particles, &static_layer, &cmd_buffer);
+
+      RenderTraceFrameKind kind = RENDER_TRACE_FRAME_GAMEPLAY;
+      if(game_state->state == GAME_STATE_MAIN_MENU) {
+        char *texts[] = { "> PLAY <", "QUIT" };
+        render_trace_draw_menu("BREAKOUT", texts, array_count(texts), &cmd_buffer);
+        kind = RENDER_TRACE_FRAME_MENU;
+        menu_frame_count++;
+      }
+      else if(game_state->state == GAME_STATE_GAME_OVER) {
+        char *texts[] = { "> RESTART <", "MAIN MENU" };
+        render_trace_draw_menu(game_state->bricks_remaining ? "GAME OVER" : "YOU WIN", texts, array_count(texts),
+          &cmd_buffer);
+        kind = RENDER_TRACE_FRAME_MENU;
+        game_over_frame_count++;
+      }
+      else if(game_state->state == GAME_STATE_RESET_GAME) {
+        kind = RENDER_TRACE_FRAME_RESET_FADE;
+      }
+
+      F64 start = tools_seconds();
+      U32 size = render_trace_encode(&encoder, &static_layer, &cmd_buffer, viewport, RENDER_TRACE_TOOL_DT, data);
+      encode_time += tools_seconds() - start;
+      if(!size)
+        continue;
+      is_written = fwrite(data, size, 1, file) == 1;
+
+      RenderTraceFrameHeader frame_header;
+      memcpy(&frame_header, data, sizeof(frame_header));
+      if(frame_header.flags & RENDER_TRACE_STATIC_CHANGED)
+        static_change_count++;
+      if(!render_trace_decode(&decoder, &frame_header, data + sizeof(frame_header))
+        || decoder.static_layer.cmd_buffer.count != static_layer.cmd_buffer.count
+        || decoder.cmd_buffer.count != cmd_buffer.count
+        || memcmp(decoder.static_layer.cmd_buffer.commands, static_layer.cmd_buffer.commands,
+          static_layer.cmd_buffer.count*sizeof(RectangleCmd))
+        || memcmp(decoder.cmd_buffer.commands, cmd_buffer.commands, cmd_buffer.count*sizeof(RectangleCmd)))
+        mismatch_count++;
+
+      frame_counts[kind]++;
+      byte_counts[kind] += size;
+      raw_byte_count += sizeof(RenderTraceFrameHeader)
+        + (static_layer.cmd_buffer.count + cmd_buffer.count)*sizeof(RectangleCmd);
+      command_count += static_layer.cmd_buffer.count + cmd_buffer.count;
+      if(static_layer.cmd_buffer.count + cmd_buffer.count > max_count)
+        max_count = static_layer.cmd_buffer.count + cmd_buffer.count;
+    }
+  }
+  is_written = fclose(file) == 0 && is_written;
+  if(!is_written) {
+    fprintf(stderr, "could not write %s\n", path);
+    return 1;
+  }
+
+  U64 frame_count = encoder.frame_count;
+  U64 byte_count = 0;
+  for(int kind = 0; kind < RENDER_TRACE_FRAME_KIND_COUNT; kind++) {
+    byte_count += byte_counts[kind];
+    printf("%-10s %7llu frames, %8.1f bytes mean\n", render_trace_frame_kind_names[kind],
+      (unsigned long long)frame_counts[kind], frame_counts[kind] ? (F64)byte_counts[kind]/frame_counts[kind] : 0.0);
+  }
+  printf("%llu frames, %.0f commands a frame (%d at most), static layer in %llu; %llu left out, too big\n",
+    (unsigned long long)frame_count, (F64)command_count/frame_count, max_count, (unsigned long long)static_change_count,
+    (unsigned long long)encoder.skipped_count);
+  printf("%.1f KB trace, %.1f bytes a frame, %.1f%% of the commands as they are; encode %.2f us a frame\n",
+    (sizeof(RenderTraceHeader) + byte_count)/1024.0, (F64)byte_count/frame_count, 100.0*byte_count/raw_byte_count,
+    encode_time*1e6/frame_count);
+  printf("%d mismatches\n", mismatch_count);
+  return mismatch_count ? 1 : 0;
+}
+
+typedef enum RenderTraceBackend {
+  RENDER_TRACE_BACKEND_NULL,
+  RENDER_TRACE_BACKEND_GL,
+  RENDER_TRACE_BACKEND_SOFTWARE,
+  RENDER_TRACE_BACKEND_COUNT,
+} RenderTraceBackend;
+
+global_variable char *render_trace_backend_names[RENDER_TRACE_BACKEND_COUNT] = { "null", "gl", "software" };
+
+// NOTE(leo): What win32_opengl_render does before handing the instances to the gpu
+typedef struct RenderTraceGLBackend {
+  RectInstance *static_instances;
+  RectInstance *instances;
+  bool has_static_instances;
+  U32 static_version;
+} RenderTraceGLBackend;
+
+internal
+void render_trace_gl_render(RenderTraceGLBackend *gl, RenderLayer *static_layer, RenderCmdBuffer *cmd_buffer)
+{
+  if(!gl->has_static_instances || static_layer->version != gl->static_version) {
+    put_rect_instances(static_layer->cmd_buffer.commands, static_layer->cmd_buffer.count, gl->static_instances);
+    gl->has_static_instances = true;
+    gl->static_version = static_layer->version;
+  }
+  put_rect_instances(cmd_buffer->commands, cmd_buffer->count, gl->instances);
+}
+
+int tool_replay_render_trace(int argc, char **argv)
+{
+  if(argc < 1) {
+    fprintf(stderr, "path missing\n");
+    return 1;
+  }
+  char *path = argv[0];
+  char *backend_name = argc > 1 ? argv[1] : "all";
+  int pass_count = tools_int_argument(argc, argv, 2, 3);
+  int first_backend = 0;
+  int backend_end = RENDER_TRACE_BACKEND_COUNT;
+  if(strcmp(backend_name, "all")) {
+    for(first_backend = 0; first_backend < RENDER_TRACE_BACKEND_COUNT; first_backend++) {
+      if(!strcmp(backend_name, render_trace_backend_names[first_backend]))
+        break;
+    }
+    backend_end = first_backend + 1;
+  }
+  if(first_backend == RENDER_TRACE_BACKEND_COUNT || pass_count < 1) {
+    fprintf(stderr, "backend all, null, gl or software; pass_count positive\n");
+    return 1;
+  }
+
+  U8 *trace;
+  U64 trace_size;
+  if(!tools_map_file(path, (void **)&trace, &trace_size)) {
+    fprintf(stderr, "could not read %s\n", path);
+    return 1;
+  }
+  RenderTraceHeader trace_header = { 0 };
+  if(trace_size >= sizeof(trace_header))
+    memcpy(&trace_header, trace, sizeof(trace_header));
+  if(trace_header.magic != RENDER_TRACE_MAGIC || trace_header.version != RENDER_TRACE_VERSION) {
+    fprintf(stderr, "%s isn't a version %d render trace\n", path, RENDER_TRACE_VERSION);
+    return 1;
+  }
+
+  // NOTE(leo): Sizes everything for the biggest frame
+  U64 frame_count = 0;
+  U64 command_count = 0;
+  U32 capacity = 0;
+  S64 max_pixel_count = 0;
+  U64 offset = sizeof(trace_header);
+  while(offset < trace_size) {
+    RenderTraceFrameHeader frame_header;
+    if(trace_size - offset < sizeof(frame_header)) {
+      fprintf(stderr, "frame %llu is cut off\n", (unsigned long long)frame_count);
+      return 1;
+    }
+    memcpy(&frame_header, trace + offset, sizeof(frame_header));
+    if(trace_size - offset - sizeof(frame_header) < frame_header.size) {
+      fprintf(stderr, "frame %llu is cut off\n", (unsigned long long)frame_count);
+      return 1;
+    }
+    offset += sizeof(frame_header) + frame_header.size;
+    frame_count++;
+    command_count += frame_header.static_count + frame_header.count;
+    if(frame_header.static_count > capacity)
+      capacity = frame_header.static_count;
+    if(frame_header.count > capacity)
+      capacity = frame_header.count;
+    S64 pixel_count = (S64)frame_header.viewport.x*(S64)frame_header.viewport.y;
+    if(pixel_count > max_pixel_count)
+      max_pixel_count = pixel_count;
+  }
+  if(!frame_count) {
+    fprintf(stderr, "%s has no frames\n", path);
+    return 1;
+  }
+  printf("replay_render_trace: %s, %llu frames, %.0f commands a frame, %.1f bytes a frame, %d passes\n", path,
+    (unsigned long long)frame_count, (F64)command_count/frame_count, (F64)(trace_size - sizeof(trace_header))/frame_count,
+    pass_count);
+
+  RenderTraceState decoder;
+  render_trace_init(&decoder, tools_allocate(capacity*sizeof(RectangleCmd)), tools_allocate(capacity*sizeof(RectangleCmd)),
+    (int)capacity);
+  RenderTraceGLBackend gl = {
+    .static_instances = tools_allocate(capacity*sizeof(RectInstance)),
+    .instances = tools_allocate(capacity*sizeof(RectInstance)),
+  };
+  SoftwareRenderer software = {
+    .pixels = tools_allocate(max_pixel_count*sizeof(U32)),
+    .static_pixels = tools_allocate(max_pixel_count*sizeof(U32)),
+    .max_pixel_count = (int)max_pixel_count,
+  };
+
+  for(int backend = first_backend; backend < backend_end; backend++) {
+    F64 decode_time = 0.0;
+    F64 render_time = 0.0;
+    U32 checksum = 2166136261u;
+    for(int pass_index = 0; pass_index < pass_count; pass_index++) {
+      render_trace_init(&decoder, decoder.static_layer.cmd_buffer.commands, decoder.cmd_buffer.commands, (int)capacity);
+      for(offset = sizeof(trace_header); offset < trace_size;) {
+        RenderTraceFrameHeader frame_header;
+        memcpy(&frame_header, trace + offset, sizeof(frame_header));
+        F64 start = tools_seconds();
+        bool is_decoded = render_trace_decode(&decoder, &frame_header, trace + offset + sizeof(frame_header));
+        F64 decoded = tools_seconds();
+        decode_time += decoded - start;
+        if(!is_decoded) {
+          fprintf(stderr, "frame %llu is broken\n", (unsigned long long)decoder.frame_count);
+          return 1;
+        }
+        offset += sizeof(frame_header) + frame_header.size;
+
+        if(backend == RENDER_TRACE_BACKEND_GL) {
+          render_trace_gl_render(&gl, &decoder.static_layer, &decoder.cmd_buffer);
+        }
+        else if(backend == RENDER_TRACE_BACKEND_SOFTWARE) {
+          software_render(&software, &decoder.static_layer, &decoder.cmd_buffer, decoder.viewport);
+        }
+        render_time += tools_seconds() - decoded;
+
+        // NOTE(leo): Outside the timing, and once: every pass draws the same
+        if(backend == RENDER_TRACE_BACKEND_SOFTWARE && pass_index == 0) {
+          for(int pixel_index = 0; pixel_index < software.width*software.height; pixel_index++)
+            checksum = (checksum ^ software.pixels[pixel_index])*16777619u;
+        }
+      }
+    }
+
+    U64 replayed_count = frame_count*pass_count;
+    printf("%-8s %8.0f frames/s, decode %7.2f us, render %8.2f us a frame, %6.2f ns a command",
+      render_trace_backend_names[backend], replayed_count/(decode_time + render_time), decode_time*1e6/replayed_count, render_time*1e6/replayed_count,
+      render_time*1e9/(command_count*pass_count));
+    if(backend == RENDER_TRACE_BACKEND_SOFTWARE)
+      printf(" (%08x)", checksum);
+    printf("\n");
+  }
+  return 0;
+}
@@ -0,0 +1,77 @@
+#include "tools.h"
+#include "breakout.h"
+#include "autoplayer.h"
+
+#include <stdio.h>
+
+/*
+  Plays the scrolling brick field with the autoplayer for frame_count frames, drawing every frame like the game does,
+  starting a new game whenever one ends. Fast scrolling streams many chunks through the field; memory stays at
+  sizeof(GameState) however many go by.
+*/
+
+#define SCROLL_BENCH_DT (1.0f/60.0f)
+#define SCROLL_BENCH_MAX_CMD_COUNT 4096
+
+int tool_bench_scroll(int argc, char **argv)
+{
+  int frame_count = tools_int_argument(argc, argv, 0, 100000);
+  int speed_percent = tools_int_argument(argc, argv, 1, 500);
+  int seed = tools_int_argument(argc, argv, 2, 1);
+  if(frame_count < 1 || speed_percent < 1) {
+    fprintf(stderr, "frame_count and speed_percent must be positive\n");
+    return 1;
+  }
+
+  GameState *game_state = tools_allocate(sizeof(GameState));
+  *game_state = (GameState){ .random_state = (U32)seed*2654435761u + 1 };
+  game_state->scroll.speed = SCROLL_DEFAULT_SPEED*speed_percent/100.0f;
+  game_state->scroll.seed = (U32)seed;
+
+  RenderLayer static_layer = {
+    .cmd_buffer = { .commands = tools_allocate(SCROLL_BENCH_MAX_CMD_COUNT*sizeof(RectangleCmd)), .capacity = SCROLL_BENCH_MAX_CMD_COUNT },
+  };
+  RenderCmdBuffer cmd_buffer = { .commands = tools_allocate(SCROLL_BENCH_MAX_CMD_COUNT*sizeof(RectangleCmd)), .capacity = SCROLL_BENCH_MAX_CMD_COUNT };
+
+  Input input = { .paddle_control = -1.0f };
+  game_update(game_state, SCROLL_BENCH_DT, &input, NULL, &static_layer, &cmd_buffer);
+  switch_to_reset_game(game_state, false, true);
+
+  printf("bench_scroll: %d frames, speed %.2f, GameState %zu bytes, %d chunk slots of %d bricks\n", frame_count,
+    game_state->scroll.speed, sizeof(GameState), SCROLL_CHUNK_COUNT, SCROLL_CHUNK_BRICK_COUNT);
+
+  int game_count = 1;
+  U64 chunk_count = 0;
+  U64 brick_count = 0; // NOTE(leo): Resident bricks summed over frames
+  U64 cmd_count = 0;
+  F64 update_time = 0.0;
+  F64 max_update_time = 0.0;
+  for(int frame = 0; frame < frame_count; frame++) {
+    if(game_state->state == GAME_STATE_GAME_OVER) {
+      chunk_count += game_state->scroll.next_chunk_index;
+      switch_to_reset_game(game_state, false, true);
+      game_count++;
+    }
+    if(game_state->state == GAME_STATE_WAIT_SERVE)
+      game_serve(game_state);
+
+    input.paddle_control = game_state->state == GAME_STATE_PLAYING ? autoplayer_paddle_control(game_state) : -1.0f;
+    cmd_buffer.count = 0;
+    F64 start = tools_seconds();
+    game_update(game_state, SCROLL_BENCH_DT, &input, NULL, &static_layer, &cmd_buffer);
+    F64 elapsed = tools_seconds() - start;
+
+    update_time += elapsed;
+    if(elapsed > max_update_time)
+      max_update_time = elapsed;
+    brick_count += game_state->bricks_remaining;
+    cmd_count += cmd_buffer.count;
+  }
+  chunk_count += game_state->scroll.next_chunk_index;
+
+  printf("%d games, %llu chunks (%llu brick slots) streamed through, %.1f live bricks mean\n", game_count,
+    (unsigned long long)chunk_count, (unsigned long long)chunk_count*SCROLL_CHUNK_BRICK_COUNT, (F64)brick_count/frame_count);
+  printf("game_update: %.2f us mean, %.2f us max, %.1f draw commands mean, %d dropped\n", update_time*1e6/frame_count,
+    max_update_time*1e6, (F64)cmd_count/frame_count, cmd_buffer.dropped_count + static_layer.cmd_buffer.dropped_count);
+  return 0;
+}
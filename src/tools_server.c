@@ -0,0 +1,653 @@
+#include <winsock2.h>
+
+#include "tools.h"
+#include "breakout.h"
+#include "snapshot.h"
+#include "spsc_queue.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+  Game server stand-in on loopback TCP: session_count remote controlled games in one process, and the clients playing
+  them in the same process.
+
+  Server: an acceptor thread hands new connections out round robin to worker_count workers (a SpscQueue each). A
+  worker owns its shard of sessions outright, nothing about a session is shared between threads. Every tick it
+  WSAPolls the shard's sockets for input (a worker steps all its sessions every tick anyway, so polling all of them
+  once per tick costs about what stepping does, and keeps the worker free of completion callbacks), applies the latest
+  input of each session, steps game_update by one tick and sends back the game's snapshot (see snapshot.h). Sockets are
+  non-blocking: a session whose client can't keep up has that tick's state dropped, the worker never waits on it. A
+  game that's over starts over.
+
+  Clients: client_thread_count threads, each with its share of the connections, send one input per tick per
+  connection (a random paddle walk, always asking to serve) and read the states back.
+
+  Reported, once every session is connected: the time a worker takes for a tick (its shard's whole step), sessions per
+  core (how many a fully busy core keeps up with at the tick rate), and the time from a client sending an input to
+  getting the first state that has it applied.
+*/
+
+#define SERVER_MAX_SESSION_COUNT 65536
+#define SERVER_CONNECT_TIMEOUT 60.0
+#define SERVER_ACCEPT_QUEUE_CAPACITY 1024
+#define SERVER_IN_CAPACITY 256
+#define SERVER_OUT_CAPACITY 4096 // NOTE(leo): A few states. Bigger ones (thousands of power-ups) are dropped
+#define SERVER_TICK_HISTORY 256 // NOTE(leo): Power of two. How far back clients remember when they sent an input
+#define SERVER_LATENCY_BUCKET_US 50
+#define SERVER_LATENCY_BUCKET_COUNT 2000 // NOTE(leo): Up to 100 ms, the last one holds everything slower
+
+#pragma pack(push, 1)
+// NOTE(leo): Client to server, every tick
+typedef struct ServerInput {
+  U32 tick; // NOTE(leo): The client's
+  F32 paddle_control;
+  U8 is_serving;
+} ServerInput;
+
+// NOTE(leo): Server to client, every tick, followed by size bytes of snapshot
+typedef struct ServerStateHeader {
+  U16 size;
+  U32 input_tick; // NOTE(leo): Of the latest input applied
+} ServerStateHeader;
+#pragma pack(pop)
+
+typedef struct ServerSession {
+  SOCKET socket;
+  GameState *game_state;
+  ServerInput input;
+  bool is_serving; // NOTE(leo): Asked to since the last tick
+
+  int in_count;
+  U8 in[SERVER_IN_CAPACITY];
+  int out_start;
+  int out_count;
+  U8 out[SERVER_OUT_CAPACITY];
+} ServerSession;
+
+typedef struct ServerWorker {
+  SpscQueue accepted; // NOTE(leo): SOCKETs, from the acceptor
+  SOCKET accepted_sockets[SERVER_ACCEPT_QUEUE_CAPACITY];
+
+  // NOTE(leo): The shard. poll_fds[i] is sessions[i]'s
+  int session_count;
+  int session_capacity;
+  ServerSession *sessions;
+  WSAPOLLFD *poll_fds;
+  GameState *game_states;
+  U8 snapshot[GAME_SNAPSHOT_MAX_SIZE];
+
+  // NOTE(leo): Measured
+  int tick_count;
+  F32 *tick_times; // NOTE(leo): Seconds, one per measured tick
+  int late_tick_count; // NOTE(leo): Not done by the time the next one was due
+  F64 busy_time;
+  U64 state_count;
+  U64 dropped_state_count;
+  int closed_count;
+} ServerWorker;
+
+typedef struct ServerConnection {
+  SOCKET socket;
+  F32 paddle_control;
+  U32 last_input_tick; // NOTE(leo): Latest one seen come back
+  int out_count;
+  U8 out[sizeof(ServerInput)]; // NOTE(leo): Rest of a partly sent input
+  int header_count;
+  U8 header[sizeof(ServerStateHeader)];
+  int skip_count; // NOTE(leo): Snapshot bytes left of the current state
+} ServerConnection;
+
+typedef struct ServerClients {
+  int connection_count;
+  ServerConnection *connections;
+  WSAPOLLFD *poll_fds;
+  U32 random_state;
+  F64 tick_send_times[SERVER_TICK_HISTORY];
+  U8 receive_buffer[65536];
+
+  // NOTE(leo): Measured
+  U64 state_count;
+  U64 byte_count;
+  U64 dropped_input_count;
+  U64 framing_error_count;
+  int closed_count;
+  U32 latency_buckets[SERVER_LATENCY_BUCKET_COUNT];
+} ServerClients;
+
+typedef struct Server {
+  int session_count;
+  int worker_count;
+  int client_thread_count;
+  F32 dt;
+  F64 seconds;
+  int max_tick_count;
+
+  SOCKET listener;
+  struct sockaddr_in address;
+
+  ServerWorker *workers;
+  ServerClients *clients;
+
+  // NOTE(leo): Set once by the acceptor, when every session is connected (or it gave up)
+  volatile F64 measure_start_time;
+  volatile F64 measure_end_time;
+  volatile LONG is_failed;
+} Server;
+
+internal
+void server_set_socket_options(SOCKET socket)
+{
+  u_long is_non_blocking = 1;
+  ioctlsocket(socket, FIONBIO, &is_non_blocking);
+  int is_no_delay = 1;
+  setsockopt(socket, IPPROTO_TCP, TCP_NODELAY, (char *)&is_no_delay, sizeof(is_no_delay));
+}
+
+// NOTE(leo): Sleeps most of the way, then yields, so ticks start on time without a core spinning
+internal
+void server_wait_until(F64 time)
+{
+  for(;;) {
+    F64 remaining = time - tools_seconds();
+    if(remaining <= 0.0)
+      return;
+    if(remaining > 0.002)
+      Sleep(1);
+    else
+      SwitchToThread();
+  }
+}
+
+internal
+bool server_is_running(Server *server)
+{
+  if(server->is_failed)
+    return false;
+  F64 end_time = server->measure_end_time;
+  return !end_time || tools_seconds() < end_time;
+}
+
+internal
+void server_accept(Server *server)
+{
+  F64 give_up_time = tools_seconds() + SERVER_CONNECT_TIMEOUT;
+  int accepted_count = 0;
+  while(accepted_count < server->session_count) {
+    if(tools_seconds() > give_up_time) {
+      fprintf(stderr, "only %d of %d sessions connected in %.0f s\n", accepted_count, server->session_count,
+        SERVER_CONNECT_TIMEOUT);
+      server->is_failed = true;
+      return;
+    }
+    WSAPOLLFD poll_fd = { .fd = server->listener, .events = POLLIN };
+    if(WSAPoll(&poll_fd, 1, 10) <= 0)
+      continue;
+    for(;;) {
+      SOCKET socket = accept(server->listener, NULL, NULL);
+      if(socket == INVALID_SOCKET)
+        break;
+      server_set_socket_options(socket);
+      ServerWorker *worker = &server->workers[accepted_count%server->worker_count];
+      while(!spsc_queue_push(&worker->accepted, &socket))
+        SwitchToThread();
+      accepted_count++;
+    }
+  }
+  F64 now = tools_seconds();
+  server->measure_end_time = now + server->seconds;
+  server->measure_start_time = now;
+}
+
+internal
+void server_close_session(ServerWorker *worker, int index)
+{
+  closesocket(worker->sessions[index].socket);
+  worker->closed_count++;
+
+  // NOTE(leo): The last session moves into the hole, game state and all (they're the worker's, in any order)
+  int last = --worker->session_count;
+  GameState *game_state = worker->sessions[index].game_state;
+  worker->sessions[index] = worker->sessions[last];
+  worker->sessions[last].game_state = game_state;
+  worker->poll_fds[index] = worker->poll_fds[last];
+}
+
+// NOTE(leo): Returns false if the connection is gone
+internal
+bool server_flush_session(ServerSession *session)
+{
+  while(session->out_count) {
+    int sent = send(session->socket, (char *)session->out + session->out_start, session->out_count, 0);
+    if(sent == SOCKET_ERROR)
+      return WSAGetLastError() == WSAEWOULDBLOCK;
+    session->out_start += sent;
+    session->out_count -= sent;
+  }
+  session->out_start = 0;
+  return true;
+}
+
+// NOTE(leo): Keeps the latest input, a serve asked for by any of them sticks until the next tick
+internal
+bool server_receive_inputs(ServerSession *session)
+{
+  for(;;) {
+    int received = recv(session->socket, (char *)session->in + session->in_count, SERVER_IN_CAPACITY - session->in_count, 0);
+    if(received == 0)
+      return false;
+    if(received == SOCKET_ERROR)
+      return WSAGetLastError() == WSAEWOULDBLOCK;
+    session->in_count += received;
+
+    int input_count = session->in_count/(int)sizeof(ServerInput);
+    for(int input_index = 0; input_index < input_count; input_index++) {
+      memcpy(&session->input, session->in + input_index*sizeof(ServerInput), sizeof(ServerInput));
+      session->is_serving = session->is_serving || session->input.is_serving;
+    }
+    int used = input_count*(int)sizeof(ServerInput);
+    memmove(session->in, session->in + used, session->in_count - used);
+    session->in_count -= used;
+  }
+}
+
+internal
+void server_start_game(GameState *game_state, U32 seed)
+{
+  *game_state = (GameState){ .random_state = seed*2654435761u + 1 };
+  Input input = { .paddle_control = -1.0f };
+  game_update(game_state, 0.0f, &input, NULL, NULL, NULL);
+  switch_to_reset_game(game_state, false, true);
+}
+
+internal
+void server_run_worker(Server *server, ServerWorker *worker, int worker_index)
+{
+  F64 tick_period = server->dt;
+  F64 next_tick_time = tools_seconds();
+  U32 started_game_count = 0;
+  while(server_is_running(server)) {
+    server_wait_until(next_tick_time);
+    F64 tick_start = tools_seconds();
+
+    SOCKET socket;
+    while(worker->session_count < worker->session_capacity && spsc_queue_pop(&worker->accepted, &socket)) {
+      int index = worker->session_count++;
+      ServerSession *session = &worker->sessions[index];
+      GameState *game_state = session->game_state;
+      *session = (ServerSession){ .socket = socket, .game_state = game_state, .input = { .paddle_control = -1.0f } };
+      server_start_game(game_state, (U32)(worker_index*SERVER_MAX_SESSION_COUNT) + started_game_count++);
+      worker->poll_fds[index] = (WSAPOLLFD){ .fd = socket, .events = POLLIN };
+    }
+
+    if(worker->session_count && WSAPoll(worker->poll_fds, worker->session_count, 0) > 0) {
+      for(int index = 0; index < worker->session_count; index++) {
+        if(!worker->poll_fds[index].revents)
+          continue;
+        worker->poll_fds[index].revents = 0;
+        if(!server_receive_inputs(&worker->sessions[index]))
+          server_close_session(worker, index--);
+      }
+    }
+
+    for(int index = 0; index < worker->session_count; index++) {
+      ServerSession *session = &worker->sessions[index];
+      GameState *game_state = session->game_state;
+      if(game_state->state == GAME_STATE_GAME_OVER)
+        server_start_game(game_state, (U32)(worker_index*SERVER_MAX_SESSION_COUNT) + started_game_count++);
+      if(session->is_serving && game_state->state == GAME_STATE_WAIT_SERVE)
+        game_serve(game_state);
+      session->is_serving = false;
+      Input input = { .paddle_control = session->input.paddle_control };
+      game_update(game_state, server->dt, &input, NULL, NULL, NULL);
+
+      U32 size = game_snapshot_encode(game_state, worker->snapshot);
+      ServerStateHeader header = { .size = (U16)size, .input_tick = session->input.tick };
+      int start = session->out_start + session->out_count;
+      if(start + sizeof(header) + size <= SERVER_OUT_CAPACITY) {
+        memcpy(session->out + start, &header, sizeof(header));
+        memcpy(session->out + start + sizeof(header), worker->snapshot, size);
+        session->out_count += sizeof(header) + size;
+        worker->state_count++;
+      }
+      else {
+        worker->dropped_state_count++;
+      }
+      if(!server_flush_session(session))
+        server_close_session(worker, index--);
+    }
+
+    F64 tick_end = tools_seconds();
+    if(server->measure_start_time && worker->tick_count < server->max_tick_count) {
+      worker->tick_times[worker->tick_count++] = (F32)(tick_end - tick_start);
+      worker->busy_time += tick_end - tick_start;
+      if(tick_end - next_tick_time > tick_period)
+        worker->late_tick_count++;
+    }
+
+    // NOTE(leo): A late worker doesn't try to catch up, it skips the ticks it missed
+    next_tick_time += tick_period;
+    if(next_tick_time < tick_end)
+      next_tick_time = tick_end;
+  }
+}
+
+internal
+void server_receive_states(ServerClients *clients, ServerConnection *connection, U8 *data, int count, U32 tick, F64 now)
+{
+  while(count) {
+    if(connection->skip_count) {
+      int skipped = count < connection->skip_count ? count : connection->skip_count;
+      connection->skip_count -= skipped;
+      data += skipped;
+      count -= skipped;
+      continue;
+    }
+
+    int header_bytes = (int)sizeof(ServerStateHeader) - connection->header_count;
+    if(header_bytes > count)
+      header_bytes = count;
+    memcpy(connection->header + connection->header_count, data, header_bytes);
+    connection->header_count += header_bytes;
+    data += header_bytes;
+    count -= header_bytes;
+    if(connection->header_count < (int)sizeof(ServerStateHeader))
+      break;
+
+    ServerStateHeader header;
+    memcpy(&header, connection->header, sizeof(header));
+    connection->header_count = 0;
+    connection->skip_count = header.size;
+    if(header.size < sizeof(GameSnapshotHeader) || header.size > GAME_SNAPSHOT_MAX_SIZE)
+      clients->framing_error_count++;
+    clients->state_count++;
+    clients->byte_count += sizeof(header) + header.size;
+
+    // NOTE(leo): Only the first state with a new input in it, later ones with the same input aren't any later
+    if(header.input_tick != connection->last_input_tick && tick - header.input_tick < SERVER_TICK_HISTORY) {
+      connection->last_input_tick = header.input_tick;
+      F64 latency = now - clients->tick_send_times[header.input_tick%SERVER_TICK_HISTORY];
+      int bucket = (int)(latency*1e6/SERVER_LATENCY_BUCKET_US);
+      if(bucket >= SERVER_LATENCY_BUCKET_COUNT)
+        bucket = SERVER_LATENCY_BUCKET_COUNT - 1;
+      clients->latency_buckets[bucket]++;
+    }
+  }
+}
+
+internal
+void server_run_clients(Server *server, ServerClients *clients)
+{
+  for(int index = 0; index < clients->connection_count; index++) {
+    SOCKET connection_socket = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if(connection_socket == INVALID_SOCKET
+      || connect(connection_socket, (struct sockaddr *)&server->address, sizeof(server->address)) == SOCKET_ERROR) {
+      fprintf(stderr, "could not connect session %d\n", index);
+      server->is_failed = true;
+      return;
+    }
+    server_set_socket_options(connection_socket);
+    clients->connections[index] = (ServerConnection){ .socket = connection_socket, .paddle_control = 0.5f };
+    clients->poll_fds[index] = (WSAPOLLFD){ .fd = connection_socket, .events = POLLIN };
+  }
+
+  // NOTE(leo): Tick 0 means no input yet
+  U32 tick = 1;
+  F64 next_tick_time = tools_seconds();
+  while(server_is_running(server)) {
+    server_wait_until(next_tick_time);
+    F64 now = tools_seconds();
+    bool is_measured = server->measure_start_time != 0.0;
+    clients->tick_send_times[tick%SERVER_TICK_HISTORY] = now;
+
+    for(int index = 0; index < clients->connection_count; index++) {
+      ServerConnection *connection = &clients->connections[index];
+      if(connection->socket == INVALID_SOCKET)
+        continue;
+
+      // NOTE(leo): A partly sent input goes first, a new one only if that went
+      if(connection->out_count) {
+        int sent = send(connection->socket, (char *)connection->out, connection->out_count, 0);
+        if(sent > 0) {
+          memmove(connection->out, connection->out + sent, connection->out_count - sent);
+          connection->out_count -= sent;
+        }
+      }
+      if(connection->out_count) {
+        clients->dropped_input_count += is_measured;
+        continue;
+      }
+
+      clients->random_state ^= clients->random_state << 13;
+      clients->random_state ^= clients->random_state >> 17;
+      clients->random_state ^= clients->random_state << 5;
+      connection->paddle_control += ((F32)(clients->random_state >> 8)/16777216.0f - 0.5f)*0.05f;
+      if(connection->paddle_control < 0.0f)
+        connection->paddle_control = 0.0f;
+      else if(connection->paddle_control > 1.0f)
+        connection->paddle_control = 1.0f;
+
+      ServerInput input = { .tick = tick, .paddle_control = connection->paddle_control, .is_serving = 1 };
+      int sent = send(connection->socket, (char *)&input, sizeof(input), 0);
+      if(sent == SOCKET_ERROR)
+        sent = 0;
+      if(sent < (int)sizeof(input)) {
+        memcpy(connection->out, (U8 *)&input + sent, sizeof(input) - sent);
+        connection->out_count = sizeof(input) - sent;
+      }
+    }
+
+    if(WSAPoll(clients->poll_fds, clients->connection_count, 0) > 0) {
+      for(int index = 0; index < clients->connection_count; index++) {
+        ServerConnection *connection = &clients->connections[index];
+        if(!clients->poll_fds[index].revents)
+          continue;
+        clients->poll_fds[index].revents = 0;
+        for(;;) {
+          int received = recv(connection->socket, (char *)clients->receive_buffer, sizeof(clients->receive_buffer), 0);
+          if(received > 0) {
+            if(is_measured)
+              server_receive_states(clients, connection, clients->receive_buffer, received, tick, tools_seconds());
+            else
+              server_receive_states(&(ServerClients){ 0 }, connection, clients->receive_buffer, received, tick, 0.0);
+            continue;
+          }
+          if(received == 0 || WSAGetLastError() != WSAEWOULDBLOCK) {
+            closesocket(connection->socket);
+            connection->socket = INVALID_SOCKET;
+            clients->poll_fds[index].fd = INVALID_SOCKET;
+            clients->closed_count++;
+          }
+          break;
+        }
+      }
+    }
+
+    tick++;
+    next_tick_time += server->dt;
+    if(next_tick_time < tools_seconds())
+      next_tick_time = tools_seconds();
+  }
+}
+
+// NOTE(leo): Item 0 accepts, then the workers, then the client threads
+internal
+void server_run(void *data, int item_index, int thread_index)
+{
+  Server *server = data;
+  if(item_index == 0)
+    server_accept(server);
+  else if(item_index <= server->worker_count)
+    server_run_worker(server, &server->workers[item_index - 1], item_index - 1);
+  else
+    server_run_clients(server, &server->clients[item_index - 1 - server->worker_count]);
+}
+
+internal
+int server_compare_f32(const void *a, const void *b)
+{
+  F32 x = *(F32 *)a;
+  F32 y = *(F32 *)b;
+  return (x > y) - (x < y);
+}
+
+internal
+F64 server_latency_percentile(U32 *buckets, U64 count, F64 fraction)
+{
+  U64 target = (U64)(count*fraction);
+  U64 sum = 0;
+  for(int bucket = 0; bucket < SERVER_LATENCY_BUCKET_COUNT; bucket++) {
+    sum += buckets[bucket];
+    if(sum > target)
+      return (bucket + 1)*SERVER_LATENCY_BUCKET_US*1e-3;
+  }
+  return SERVER_LATENCY_BUCKET_COUNT*SERVER_LATENCY_BUCKET_US*1e-3;
+}
+
+int tool_serve_games(int argc, char **argv)
+{
+  int session_count = tools_int_argument(argc, argv, 0, 10000);
+  int worker_count = tools_thread_count(tools_int_argument(argc, argv, 1, 0));
+  int client_thread_count = tools_int_argument(argc, argv, 2, 0);
+  if(client_thread_count <= 0)
+    client_thread_count = worker_count;
+  int seconds = tools_int_argument(argc, argv, 3, 10);
+  int tick_rate = tools_int_argument(argc, argv, 4, 60);
+  if(session_count < 1 || session_count > SERVER_MAX_SESSION_COUNT || seconds < 1 || tick_rate < 1
+    || 1 + worker_count + client_thread_count > TOOLS_MAX_THREAD_COUNT) {
+    fprintf(stderr, "session_count in 1-%d, seconds and tick_rate positive, at most %d workers and client threads\n",
+      SERVER_MAX_SESSION_COUNT, TOOLS_MAX_THREAD_COUNT - 1);
+    return 1;
+  }
+
+  WSADATA wsa_data;
+  if(WSAStartup(MAKEWORD(2, 2), &wsa_data) != 0) {
+    fprintf(stderr, "WSAStartup failed\n");
+    return 1;
+  }
+
+  Server *server = tools_allocate(sizeof(Server));
+  server->session_count = session_count;
+  server->worker_count = worker_count;
+  server->client_thread_count = client_thread_count;
+  server->dt = 1.0f/tick_rate;
+  server->seconds = seconds;
+  server->max_tick_count = seconds*tick_rate + tick_rate;
+
+  // NOTE(leo): Any free port on loopback
+  server->listener = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+  server->address.sin_family = AF_INET;
+  server->address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  server->address.sin_port = 0;
+  int address_size = sizeof(server->address);
+  if(server->listener == INVALID_SOCKET
+    || bind(server->listener, (struct sockaddr *)&server->address, sizeof(server->address)) == SOCKET_ERROR
+    || listen(server->listener, SOMAXCONN) == SOCKET_ERROR
+    || getsockname(server->listener, (struct sockaddr *)&server->address, &address_size) == SOCKET_ERROR) {
+    fprintf(stderr, "could not listen on loopback\n");
+    return 1;
+  }
+  server_set_socket_options(server->listener);
+
+  // NOTE(leo): Shards can come out one session uneven (round robin), the rest is slack
+  int session_capacity = (session_count + worker_count - 1)/worker_count;
+  server->workers = tools_allocate(worker_count*sizeof(ServerWorker));
+  for(int worker_index = 0; worker_index < worker_count; worker_index++) {
+    ServerWorker *worker = &server->workers[worker_index];
+    spsc_queue_init(&worker->accepted, worker->accepted_sockets, sizeof(SOCKET), SERVER_ACCEPT_QUEUE_CAPACITY);
+    worker->session_capacity = session_capacity;
+    worker->sessions = tools_allocate(session_capacity*sizeof(ServerSession));
+    worker->poll_fds = tools_allocate(session_capacity*sizeof(WSAPOLLFD));
+    worker->game_states = tools_allocate(session_capacity*sizeof(GameState));
+    for(int index = 0; index < session_capacity; index++)
+      worker->sessions[index].game_state = &worker->game_states[index];
+    worker->tick_times = tools_allocate(server->max_tick_count*sizeof(F32));
+  }
+  server->clients = tools_allocate(client_thread_count*sizeof(ServerClients));
+  for(int client_index = 0; client_index < client_thread_count; client_index++) {
+    ServerClients *clients = &server->clients[client_index];
+    clients->connection_count = session_count/client_thread_count + (client_index < session_count%client_thread_count);
+    clients->connections = tools_allocate(clients->connection_count*sizeof(ServerConnection) + 1);
+    clients->poll_fds = tools_allocate(clients->connection_count*sizeof(WSAPOLLFD) + 1);
+    for(int index = 0; index < clients->connection_count; index++)
+      clients->connections[index].socket = INVALID_SOCKET;
+    clients->random_state = (U32)client_index*2654435761u + 1;
+  }
+  printf("serve_games: %d sessions, %d workers, %d client threads, %d ticks/s, %d s. %.0f MB of game states\n",
+    session_count, worker_count, client_thread_count, tick_rate, seconds,
+    (F64)worker_count*session_capacity*sizeof(GameState)/(1024.0*1024.0));
+
+  F64 start = tools_seconds();
+  int item_count = 1 + worker_count + client_thread_count;
+  tools_parallel_for(item_count, item_count, server_run, server);
+  // NOTE(leo): Only once every thread is done: a worker still in its last tick would count the sessions as lost
+  for(int client_index = 0; client_index < client_thread_count; client_index++) {
+    ServerClients *clients = &server->clients[client_index];
+    for(int index = 0; index < clients->connection_count; index++) {
+      if(clients->connections[index].socket != INVALID_SOCKET)
+        closesocket(clients->connections[index].socket);
+    }
+  }
+  closesocket(server->listener);
+  WSACleanup();
+  if(server->is_failed)
+    return 1;
+  F64 measured_time = tools_seconds() - server->measure_start_time;
+  printf("connected in %.2f s\n", server->measure_start_time - start);
+
+  int tick_count = 0;
+  int late_tick_count = 0;
+  int closed_count = 0;
+  F64 busy_time = 0.0;
+  U64 state_count = 0;
+  U64 dropped_state_count = 0;
+  F32 *tick_times = tools_allocate(worker_count*server->max_tick_count*sizeof(F32));
+  for(int worker_index = 0; worker_index < worker_count; worker_index++) {
+    ServerWorker *worker = &server->workers[worker_index];
+    memcpy(tick_times + tick_count, worker->tick_times, worker->tick_count*sizeof(F32));
+    tick_count += worker->tick_count;
+    late_tick_count += worker->late_tick_count;
+    closed_count += worker->closed_count;
+    busy_time += worker->busy_time;
+    state_count += worker->state_count;
+    dropped_state_count += worker->dropped_state_count;
+  }
+  qsort(tick_times, tick_count, sizeof(F32), server_compare_f32);
+  if(tick_count) {
+    printf("worker ticks: %d, %.2f ms p50, %.2f ms p99, %.2f ms max (%.2f ms per tick), %d late\n", tick_count,
+      tick_times[tick_count/2]*1e3, tick_times[(int)(tick_count*0.99)]*1e3, tick_times[tick_count - 1]*1e3,
+      server->dt*1e3, late_tick_count);
+    F64 session_tick_time = busy_time/((F64)tick_count/worker_count*session_count);
+    printf("%.2f us per session tick, %.0f sessions/core at %d ticks/s; %.1f%% of %d workers busy\n",
+      session_tick_time*1e6, 1.0/(session_tick_time*tick_rate), tick_rate, 100.0*busy_time/(measured_time*worker_count),
+      worker_count);
+  }
+
+  U64 received_state_count = 0;
+  U64 received_byte_count = 0;
+  U64 dropped_input_count = 0;
+  U64 framing_error_count = 0;
+  U64 latency_count = 0;
+  U32 *latency_buckets = tools_allocate(SERVER_LATENCY_BUCKET_COUNT*sizeof(U32));
+  for(int client_index = 0; client_index < client_thread_count; client_index++) {
+    ServerClients *clients = &server->clients[client_index];
+    received_state_count += clients->state_count;
+    received_byte_count += clients->byte_count;
+    dropped_input_count += clients->dropped_input_count;
+    framing_error_count += clients->framing_error_count;
+    closed_count += clients->closed_count;
+    for(int bucket = 0; bucket < SERVER_LATENCY_BUCKET_COUNT; bucket++) {
+      latency_buckets[bucket] += clients->latency_buckets[bucket];
+      latency_count += clients->latency_buckets[bucket];
+    }
+  }
+  printf("states: %llu sent, %llu dropped (client behind), %llu received, %.1f bytes mean, %.1f MB/s\n",
+    (unsigned long long)state_count, (unsigned long long)dropped_state_count, (unsigned long long)received_state_count,
+    received_state_count ? (F64)received_byte_count/received_state_count : 0.0,
+    received_byte_count/(measured_time*1024.0*1024.0));
+  printf("input to state: %.2f ms p50, %.2f ms p99; %llu inputs dropped, %llu framing errors, %d connections lost\n",
+    server_latency_percentile(latency_buckets, latency_count, 0.5), server_latency_percentile(latency_buckets, latency_count, 0.99),
+    (unsigned long long)dropped_input_count, (unsigned long long)framing_error_count, closed_count);
+  return framing_error_count || closed_count ? 1 : 0;
+}
@@ -0,0 +1,119 @@
+#include "tools.h"
+#include "breakout.h"
+#include "autoplayer.h"
+#include "snapshot.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/*
+  Has the bot play games, snapshotting every frame: times encoding and decoding, checks that every snapshot decodes to
+  one that encodes the same, and rolls back every SNAPSHOT_BENCH_WINDOW frames: decodes the snapshot from that many
+  frames ago, plays the same inputs again and checks it ends up with the same snapshot as the game did.
+*/
+
+#define SNAPSHOT_BENCH_DT (1.0f/60.0f)
+#define SNAPSHOT_BENCH_WINDOW 64
+#define SNAPSHOT_BENCH_FRAME_COUNT (SNAPSHOT_BENCH_WINDOW + 1) // NOTE(leo): A window's frames and the one after
+
+typedef struct SnapshotFrame {
+  bool is_served;
+  F32 paddle_control;
+  U32 size;
+  U8 data[GAME_SNAPSHOT_MAX_SIZE];
+} SnapshotFrame;
+
+internal
+void snapshots_play_frame(GameState *game_state, bool is_served, F32 paddle_control)
+{
+  if(is_served)
+    game_serve(game_state);
+  Input input = { .paddle_control = paddle_control };
+  game_update(game_state, SNAPSHOT_BENCH_DT, &input, NULL, NULL, NULL);
+}
+
+int tool_bench_snapshots(int argc, char **argv)
+{
+  int game_count = tools_int_argument(argc, argv, 0, 20);
+  int scroll_speed_percent = tools_int_argument(argc, argv, 1, 0);
+  int seed = tools_int_argument(argc, argv, 2, 1);
+  if(game_count < 1 || scroll_speed_percent < 0) {
+    fprintf(stderr, "game_count positive, scroll_speed_percent not negative\n");
+    return 1;
+  }
+
+  GameState *game_state = tools_allocate(sizeof(GameState));
+  GameState *scratch = tools_allocate(sizeof(GameState));
+  SnapshotFrame *frames = tools_allocate(SNAPSHOT_BENCH_FRAME_COUNT*sizeof(SnapshotFrame));
+  U8 *check = tools_allocate(GAME_SNAPSHOT_MAX_SIZE);
+  printf("bench_snapshots: %d games, scroll speed %d%%, seed %d. GameState %zu bytes, snapshot header %zu, at most %zu\n",
+    game_count, scroll_speed_percent, seed, sizeof(GameState), sizeof(GameSnapshotHeader), (size_t)GAME_SNAPSHOT_MAX_SIZE);
+
+  U64 frame_count = 0;
+  U64 byte_count = 0;
+  U32 max_size = 0;
+  F64 encode_time = 0.0;
+  F64 decode_time = 0.0;
+  int mismatch_count = 0;
+  int rollback_count = 0;
+  int rollback_mismatch_count = 0;
+  int rollback_skip_count = 0;
+  for(int game_index = 0; game_index < game_count; game_index++) {
+    *game_state = (GameState){ .random_state = ((U32)seed + (U32)game_index)*2654435761u + 1 };
+    game_state->scroll.speed = SCROLL_DEFAULT_SPEED*scroll_speed_percent/100.0f;
+    game_state->scroll.seed = (U32)seed;
+    snapshots_play_frame(game_state, false, -1.0f);
+    switch_to_reset_game(game_state, false, true);
+    game_state_copy(scratch, game_state);
+
+    int max_frame_count = (int)(BOT_GAME_MAX_TIME/SNAPSHOT_BENCH_DT);
+    for(int frame = 0; frame < max_frame_count && game_state->state != GAME_STATE_GAME_OVER; frame++, frame_count++) {
+      SnapshotFrame *snapshot = &frames[frame%SNAPSHOT_BENCH_FRAME_COUNT];
+      F64 start = tools_seconds();
+      snapshot->size = game_snapshot_encode(game_state, snapshot->data);
+      encode_time += tools_seconds() - start;
+      byte_count += snapshot->size;
+      if(snapshot->size > max_size)
+        max_size = snapshot->size;
+
+      start = tools_seconds();
+      bool is_decoded = game_snapshot_decode(scratch, snapshot->data, snapshot->size);
+      decode_time += tools_seconds() - start;
+      if(!is_decoded || game_snapshot_encode(scratch, check) != snapshot->size || memcmp(check, snapshot->data, snapshot->size))
+        mismatch_count++;
+
+      // NOTE(leo): The window's first snapshot and inputs are still in frames. A rollback that starts in the fade is
+      // skipped, its alphas are quantised and may end it a frame off
+      if(frame >= SNAPSHOT_BENCH_WINDOW && frame%SNAPSHOT_BENCH_WINDOW == 0) {
+        int first_frame = frame - SNAPSHOT_BENCH_WINDOW;
+        SnapshotFrame *first = &frames[first_frame%SNAPSHOT_BENCH_FRAME_COUNT];
+        if(((GameSnapshotHeader *)first->data)->flags & GAME_SNAPSHOT_ANIMATING) {
+          rollback_skip_count++;
+        }
+        else {
+          rollback_count++;
+          bool is_same = game_snapshot_decode(scratch, first->data, first->size);
+          for(int replay_frame = first_frame; replay_frame < frame; replay_frame++) {
+            SnapshotFrame *replay = &frames[replay_frame%SNAPSHOT_BENCH_FRAME_COUNT];
+            snapshots_play_frame(scratch, replay->is_served, replay->paddle_control);
+          }
+          is_same = is_same && game_snapshot_encode(scratch, check) == snapshot->size
+            && memcmp(check, snapshot->data, snapshot->size) == 0;
+          rollback_mismatch_count += !is_same;
+        }
+      }
+
+      snapshot->is_served = game_state->state == GAME_STATE_WAIT_SERVE;
+      snapshot->paddle_control = game_state->state == GAME_STATE_PLAYING ? autoplayer_paddle_control(game_state) : -1.0f;
+      snapshots_play_frame(game_state, snapshot->is_served, snapshot->paddle_control);
+    }
+  }
+
+  printf("%llu snapshots: %.1f bytes mean, %u at most, %.1f KB/s at 60 frames/s\n", (unsigned long long)frame_count,
+    (F64)byte_count/frame_count, max_size, (F64)byte_count/frame_count*60.0/1024.0);
+  printf("encode %.1f ns, decode %.1f ns mean; %d round trip mismatches\n", encode_time*1e9/frame_count,
+    decode_time*1e9/frame_count, mismatch_count);
+  printf("rollbacks of %d frames: %d, %d mismatches, %d skipped (fade)\n", SNAPSHOT_BENCH_WINDOW, rollback_count,
+    rollback_mismatch_count, rollback_skip_count);
+  return mismatch_count || rollback_mismatch_count ? 1 : 0;
+}
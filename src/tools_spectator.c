@@ -0,0 +1,201 @@
+#include "tools.h"
+#include "breakout.h"
+#include "autoplayer.h"
+#include "snapshot.h"
+#include "spectator.h"
+
+#include <fcntl.h>
+#include <io.h>
+#include <stdio.h>
+#include <string.h>
+
+/*
+  record_spectator has the bot play games and writes the spectator stream of them (see spectator.h) to a file, or to
+  stdout with "-" (the report goes to stderr then). Watchers ack ack_delay frames late. Times encoding, decodes every
+  frame right away and checks it comes out as the state the encoder had, and compares the sizes to snapshots.
+
+  watch_spectator reads a stream from a file, or stdin with "-", like a watcher would: joins at the first keyframe from
+  frame join_frame on and checks every frame's checksum. Eg:
+
+    breakout_tools record_spectator - 5 | breakout_tools watch_spectator - 1000
+*/
+
+#define SPECTATOR_TOOL_DT (1.0f/60.0f)
+
+internal
+FILE *spectator_open(char *path, char *mode, bool is_writing)
+{
+  if(strcmp(path, "-"))
+    return fopen(path, mode);
+  FILE *file = is_writing ? stdout : stdin;
+  _setmode(_fileno(file), _O_BINARY);
+  return file;
+}
+
+int tool_record_spectator(int argc, char **argv)
+{
+  if(argc < 1) {
+    fprintf(stderr, "path missing\n");
+    return 1;
+  }
+  char *path = argv[0];
+  int game_count = tools_int_argument(argc, argv, 1, 20);
+  int ack_delay = tools_int_argument(argc, argv, 2, 2);
+  int keyframe_interval = tools_int_argument(argc, argv, 3, 300);
+  int seed = tools_int_argument(argc, argv, 4, 1);
+  if(game_count < 1 || ack_delay < 0 || keyframe_interval < 0) {
+    fprintf(stderr, "game_count positive, ack_delay and keyframe_interval not negative\n");
+    return 1;
+  }
+  FILE *report = strcmp(path, "-") ? stdout : stderr;
+  FILE *file = spectator_open(path, "wb", true);
+  SpectatorStreamHeader stream_header = { .magic = SPECTATOR_STREAM_MAGIC, .version = SPECTATOR_STREAM_VERSION };
+  if(!file || fwrite(&stream_header, sizeof(stream_header), 1, file) != 1) {
+    fprintf(stderr, "could not write %s\n", path);
+    return 1;
+  }
+
+  GameState *game_state = tools_allocate(sizeof(GameState));
+  SpectatorEncoder *encoder = tools_allocate(sizeof(SpectatorEncoder));
+  SpectatorDecoder *decoder = tools_allocate(sizeof(SpectatorDecoder));
+  U8 *snapshot = tools_allocate(GAME_SNAPSHOT_MAX_SIZE);
+  spectator_encoder_init(encoder, keyframe_interval, true);
+  fprintf(report, "record_spectator: %s, %d games, acks %d frames late, keyframe every %d frames, seed %d\n", path,
+    game_count, ack_delay, keyframe_interval, seed);
+
+  U64 frame_count = 0;
+  U64 keyframe_byte_count = 0;
+  U64 delta_byte_count = 0;
+  U64 snapshot_byte_count = 0;
+  U32 max_size = 0;
+  F64 encode_time = 0.0;
+  F64 decode_time = 0.0;
+  int mismatch_count = 0;
+  bool is_written = true;
+  for(int game_index = 0; game_index < game_count && is_written; game_index++) {
+    *game_state = (GameState){ .random_state = ((U32)seed + (U32)game_index)*2654435761u + 1 };
+    Input input = { .paddle_control = -1.0f };
+    game_update(game_state, SPECTATOR_TOOL_DT, &input, NULL, NULL, NULL);
+    switch_to_reset_game(game_state, false, true);
+
+    int max_frame_count = (int)(BOT_GAME_MAX_TIME/SPECTATOR_TOOL_DT);
+    for(int frame = 0; frame < max_frame_count && game_state->state != GAME_STATE_GAME_OVER && is_written; frame++) {
+      U8 data[sizeof(U16) + SPECTATOR_MAX_FRAME_SIZE];
+      U32 keyframe_count = encoder->keyframe_count;
+      F64 start = tools_seconds();
+      U32 size = spectator_encode(encoder, game_state, data + sizeof(U16));
+      encode_time += tools_seconds() - start;
+      U32 sequence = encoder->sequence - 1;
+      if(encoder->keyframe_count != keyframe_count)
+        keyframe_byte_count += size;
+      else
+        delta_byte_count += size;
+      if(size > max_size)
+        max_size = size;
+      U16 size_u16 = (U16)size;
+      memcpy(data, &size_u16, sizeof(U16));
+      is_written = fwrite(data, sizeof(U16) + size, 1, file) == 1;
+
+      start = tools_seconds();
+      SpectatorDecodeResult result = spectator_decode(decoder, data + sizeof(U16), size);
+      decode_time += tools_seconds() - start;
+      if(result != SPECTATOR_DECODED || memcmp(&decoder->history[sequence%SPECTATOR_HISTORY_COUNT],
+        &encoder->history[sequence%SPECTATOR_HISTORY_COUNT], sizeof(SpectatorState)))
+        mismatch_count++;
+      if(sequence >= (U32)ack_delay)
+        spectator_encoder_ack(encoder, sequence - ack_delay);
+
+      snapshot_byte_count += game_snapshot_encode(game_state, snapshot);
+      frame_count++;
+
+      if(game_state->state == GAME_STATE_WAIT_SERVE)
+        game_serve(game_state);
+      input.paddle_control = game_state->state == GAME_STATE_PLAYING ? autoplayer_paddle_control(game_state) : -1.0f;
+      game_update(game_state, SPECTATOR_TOOL_DT, &input, NULL, NULL, NULL);
+    }
+  }
+  if(file != stdout)
+    is_written = fclose(file) == 0 && is_written;
+  else
+    is_written = fflush(file) == 0 && is_written;
+  if(!is_written) {
+    fprintf(stderr, "could not write %s\n", path);
+    return 1;
+  }
+
+  U64 delta_count = frame_count - encoder->keyframe_count;
+  fprintf(report, "%llu frames: %u keyframes, %.1f bytes mean; %llu deltas, %.2f bytes mean; %u at most\n",
+    (unsigned long long)frame_count, encoder->keyframe_count, (F64)keyframe_byte_count/encoder->keyframe_count,
+    (unsigned long long)delta_count, delta_count ? (F64)delta_byte_count/delta_count : 0.0, max_size);
+  fprintf(report, "%.2f bytes a frame with checksums and sizes, %.2f KB/s at 60 frames/s; snapshots %.1f bytes a frame\n",
+    (F64)(keyframe_byte_count + delta_byte_count)/frame_count + sizeof(U16),
+    ((F64)(keyframe_byte_count + delta_byte_count)/frame_count + sizeof(U16))*60.0/1024.0,
+    (F64)snapshot_byte_count/frame_count);
+  fprintf(report, "encode %.1f ns, decode %.1f ns mean; %d mismatches\n", encode_time*1e9/frame_count,
+    decode_time*1e9/frame_count, mismatch_count);
+  return mismatch_count ? 1 : 0;
+}
+
+int tool_watch_spectator(int argc, char **argv)
+{
+  if(argc < 1) {
+    fprintf(stderr, "path missing\n");
+    return 1;
+  }
+  char *path = argv[0];
+  int join_frame = tools_int_argument(argc, argv, 1, 0);
+  FILE *file = spectator_open(path, "rb", false);
+  SpectatorStreamHeader stream_header;
+  if(!file || fread(&stream_header, sizeof(stream_header), 1, file) != 1) {
+    fprintf(stderr, "could not read %s\n", path);
+    return 1;
+  }
+  if(stream_header.magic != SPECTATOR_STREAM_MAGIC || stream_header.version != SPECTATOR_STREAM_VERSION) {
+    fprintf(stderr, "%s isn't a version %d spectator stream\n", path, SPECTATOR_STREAM_VERSION);
+    return 1;
+  }
+
+  SpectatorDecoder *decoder = tools_allocate(sizeof(SpectatorDecoder));
+  U64 frame_count = 0;
+  U64 byte_count = 0;
+  int result_counts[4] = { 0 };
+  U32 first_sequence = 0;
+  for(;;) {
+    U16 size;
+    U8 data[SPECTATOR_MAX_FRAME_SIZE];
+    if(fread(&size, sizeof(size), 1, file) != 1)
+      break;
+    if(size > SPECTATOR_MAX_FRAME_SIZE || fread(data, size, 1, file) != 1) {
+      fprintf(stderr, "frame %llu is broken or cut off\n", (unsigned long long)frame_count);
+      result_counts[SPECTATOR_BROKEN]++;
+      break;
+    }
+    // NOTE(leo): Frames before join_frame went by before the watcher came
+    if(frame_count++ < (U64)join_frame)
+      continue;
+    byte_count += sizeof(size) + size;
+
+    SpectatorDecodeResult result = spectator_decode(decoder, data, size);
+    if(result == SPECTATOR_DECODED && !result_counts[SPECTATOR_DECODED])
+      first_sequence = decoder->sequence;
+    result_counts[result]++;
+  }
+  if(file != stdin)
+    fclose(file);
+
+  printf("watch_spectator: %s, %llu frames, joined at frame %d\n", path, (unsigned long long)frame_count, join_frame);
+  printf("waited %d frames for a keyframe, then decoded %d from sequence %u (%.2f bytes mean)\n",
+    result_counts[SPECTATOR_WAITING_FOR_KEYFRAME], result_counts[SPECTATOR_DECODED], first_sequence,
+    result_counts[SPECTATOR_DECODED] ? (F64)byte_count/(frame_count - join_frame) : 0.0);
+  if(result_counts[SPECTATOR_DECODED]) {
+    SpectatorState *state = &decoder->history[decoder->sequence%SPECTATOR_HISTORY_COUNT];
+    int standing_count = 0;
+    for(int brick_index = 0; brick_index < state->brick_count; brick_index++)
+      standing_count += (state->brick_bits[brick_index >> 5] >> (brick_index & 31)) & 1;
+    printf("last state: sequence %u, level %d, score %d, %d balls left, %d of %d bricks standing\n", state->sequence,
+      state->level_index, state->score, state->balls_remaining, standing_count, state->brick_count);
+  }
+  printf("%d checksum mismatches, %d broken frames\n", result_counts[SPECTATOR_CHECKSUM_MISMATCH],
+    result_counts[SPECTATOR_BROKEN]);
+  return result_counts[SPECTATOR_CHECKSUM_MISMATCH] || result_counts[SPECTATOR_BROKEN] ? 1 : 0;
+}
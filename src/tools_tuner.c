@@ -0,0 +1,166 @@
+#include "tools.h"
+#include "breakout.h"
+
+#include <stdio.h>
+#include <math.h>
+
+/*
+  Monte Carlo difficulty tuner. Plays games_per_setting bot games for every combination of the values below, all in one
+  parallel run, and prints win rate, score and game length per setting with 95% confidence intervals.
+
+  Every setting plays the same seeds (game i of each setting serves the same way), so differences between settings
+  aren't just different luck.
+*/
+
+global_variable F32 tuner_paddle_widths[] = { 5.0f, 6.0f, 7.0f, 8.0f, 10.0f };
+// NOTE(leo): Scale all four default ball speeds
+global_variable F32 tuner_speed_scales[] = { 0.8f, 1.0f, 1.25f, 1.5f };
+global_variable int tuner_hit_counts[][2] = { { 2, 6 }, { 4, 12 }, { 8, 24 } };
+
+#define TUNER_SETTING_COUNT (array_count(tuner_paddle_widths)*array_count(tuner_speed_scales)*array_count(tuner_hit_counts))
+
+typedef struct TunerResult {
+  int score;
+  int frame_count;
+  bool is_won;
+  bool is_timed_out;
+} TunerResult;
+
+typedef struct Tuner {
+  int games_per_setting;
+  F32 difficulty_factor;
+  F32 dt;
+  int max_frame_count;
+  F32 aim_error;
+
+  GameState *game_states; // NOTE(leo): Scratch, one per thread
+  TunerResult *results; // NOTE(leo): By setting, then game
+} Tuner;
+
+internal
+GameTuning tuner_setting(int setting_index)
+{
+  int hit_count_index = setting_index%array_count(tuner_hit_counts);
+  setting_index /= array_count(tuner_hit_counts);
+  int speed_index = setting_index%array_count(tuner_speed_scales);
+  setting_index /= array_count(tuner_speed_scales);
+  int paddle_index = setting_index;
+
+  GameTuning result = default_game_tuning();
+  result.paddle_width = tuner_paddle_widths[paddle_index];
+  for(int i = 0; i < 4; i++)
+    result.ball_speeds[i] *= tuner_speed_scales[speed_index];
+  result.speed_up_hit_counts[0] = tuner_hit_counts[hit_count_index][0];
+  result.speed_up_hit_counts[1] = tuner_hit_counts[hit_count_index][1];
+  return result;
+}
+
+internal
+void tuner_play_game(void *data, int item_index, int thread_index)
+{
+  Tuner *tuner = data;
+  BotGame game = {
+    .seed = (U32)(item_index%tuner->games_per_setting),
+    .difficulty_factor = tuner->difficulty_factor,
+    .tuning = tuner_setting(item_index/tuner->games_per_setting),
+    .dt = tuner->dt,
+    .max_frame_count = tuner->max_frame_count,
+    .aim_error = tuner->aim_error,
+  };
+  tools_play_bot_game(&tuner->game_states[thread_index], &game);
+
+  tuner->results[item_index] = (TunerResult){
+    .score = game.score,
+    .frame_count = game.frame_count,
+    .is_won = game.is_won,
+    .is_timed_out = game.is_timed_out,
+  };
+}
+
+// NOTE(leo): Half width of the 95% confidence interval of a mean (normal approximation)
+internal
+F64 tuner_mean_interval(F64 sum, F64 square_sum, int count)
+{
+  if(count < 2)
+    return 0.0;
+  F64 mean = sum/count;
+  F64 variance = (square_sum - count*mean*mean)/(count - 1);
+  return 1.96*sqrt(variance > 0.0 ? variance : 0.0)/sqrt((F64)count);
+}
+
+int tool_tune(int argc, char **argv)
+{
+  int games_per_setting = tools_int_argument(argc, argv, 0, 200);
+  int thread_count = tools_thread_count(tools_int_argument(argc, argv, 1, 0));
+  int difficulty_factor_percent = tools_int_argument(argc, argv, 2, 100);
+  int dt_ms = tools_int_argument(argc, argv, 3, 33);
+  // NOTE(leo): Of the default paddle width. The bot never misses otherwise
+  int aim_error_percent = tools_int_argument(argc, argv, 4, 30);
+  if(games_per_setting < 1 || difficulty_factor_percent < 1 || dt_ms < 1 || aim_error_percent < 0) {
+    fprintf(stderr, "games_per_setting, difficulty_factor_percent and dt_ms must be positive, aim_error_percent not negative\n");
+    return 1;
+  }
+
+  int setting_count = TUNER_SETTING_COUNT;
+  int game_count = setting_count*games_per_setting;
+  Tuner tuner = {
+    .games_per_setting = games_per_setting,
+    .difficulty_factor = (F32)difficulty_factor_percent/100.0f,
+    .dt = (F32)dt_ms/1000.0f,
+    .max_frame_count = (int)(BOT_GAME_MAX_TIME*1000.0f/dt_ms),
+    .aim_error = PADDLE_WIDTH*aim_error_percent/100.0f,
+    .game_states = tools_allocate(thread_count*sizeof(GameState)),
+    .results = tools_allocate(game_count*sizeof(TunerResult)),
+  };
+
+  printf("tune: %d settings x %d games, %d threads, difficulty %.2f, %d ms frames, aim error %.1f\n",
+    setting_count, games_per_setting, thread_count, tuner.difficulty_factor, dt_ms, tuner.aim_error);
+
+  F64 start = tools_seconds();
+  tools_parallel_for(game_count, thread_count, tuner_play_game, &tuner);
+  F64 elapsed = tools_seconds() - start;
+
+  printf("paddle  ball speeds        hits   won %%  (95%% ci)      score (95%% ci)   length s (95%% ci)  timed out\n");
+  for(int setting_index = 0; setting_index < setting_count; setting_index++) {
+    GameTuning tuning = tuner_setting(setting_index);
+    TunerResult *results = tuner.results + setting_index*games_per_setting;
+
+    int win_count = 0;
+    int timeout_count = 0;
+    F64 score_sum = 0.0, score_square_sum = 0.0;
+    F64 length_sum = 0.0, length_square_sum = 0.0;
+    for(int game_index = 0; game_index < games_per_setting; game_index++) {
+      TunerResult result = results[game_index];
+      F64 length = result.frame_count*tuner.dt;
+      win_count += result.is_won;
+      timeout_count += result.is_timed_out;
+      score_sum += result.score;
+      score_square_sum += (F64)result.score*result.score;
+      length_sum += length;
+      length_square_sum += length*length;
+    }
+
+    // NOTE(leo): Wilson score interval, still sensible with win rates close to 0 or 1
+    F64 n = games_per_setting;
+    F64 p = win_count/n;
+    F64 z = 1.96;
+    F64 center = (p + z*z/(2.0*n))/(1.0 + z*z/n);
+    F64 half = z*sqrt(p*(1.0 - p)/n + z*z/(4.0*n*n))/(1.0 + z*z/n);
+    F64 low = center - half > 0.0 ? center - half : 0.0;
+    F64 high = center + half < 1.0 ? center + half : 1.0;
+
+    printf("%6.1f  %3.0f/%3.0f/%3.0f/%3.0f  %2d/%2d  %5.1f (%5.1f-%5.1f)  %6.1f +- %5.1f  %7.1f +- %5.1f  %d\n",
+      tuning.paddle_width, tuning.ball_speeds[0], tuning.ball_speeds[1], tuning.ball_speeds[2], tuning.ball_speeds[3],
+      tuning.speed_up_hit_counts[0], tuning.speed_up_hit_counts[1],
+      100.0*p, 100.0*low, 100.0*high,
+      score_sum/n, tuner_mean_interval(score_sum, score_square_sum, games_per_setting),
+      length_sum/n, tuner_mean_interval(length_sum, length_square_sum, games_per_setting),
+      timeout_count);
+  }
+
+  F64 game_time = 0.0;
+  for(int game_index = 0; game_index < game_count; game_index++)
+    game_time += tuner.results[game_index].frame_count*tuner.dt;
+  printf("%d games in %.2f s: %.0f games/s, %.0fx real time\n", game_count, elapsed, game_count/elapsed, game_time/elapsed);
+  return 0;
+}
@@ -2,6 +2,7 @@
 
 #include <assert.h>
 #include <stdbool.h>
+#include <stddef.h>
 
 #include <stdint.h>
 typedef int8_t S8;
@@ -51,10 +52,97 @@ typedef struct Color {
 
 #define COLOR_WHITE ((Color){1.0f, 1.0f, 1.0f, 1.0f})
 
+// NOTE(leo): 0xAABBGGRR
+inline
+U32 color_pack(Color color)
+{
+  U32 r = (U32)(color.r*255.0f + 0.5f);
+  U32 g = (U32)(color.g*255.0f + 0.5f);
+  U32 b = (U32)(color.b*255.0f + 0.5f);
+  U32 a = (U32)(color.a*255.0f + 0.5f);
+  return r | (g << 8) | (b << 16) | (a << 24);
+}
+
+inline
+Color color_unpack(U32 color)
+{
+  return (Color){
+    .r = (F32)(color & 0xFF)/255.0f,
+    .g = (F32)((color >> 8) & 0xFF)/255.0f,
+    .b = (F32)((color >> 16) & 0xFF)/255.0f,
+    .a = (F32)(color >> 24)/255.0f,
+  };
+}
+
 typedef struct Rect {
   V2 pos, dim;
 } Rect;
 
+/*
+  Linear allocator over a fixed block. Pushes are aligned, popping back to an earlier marker frees everything pushed
+  since. Running out of space returns NULL, never touches the heap.
+*/
+typedef struct MemoryArena {
+  U8 *base;
+  size_t size;
+  size_t used;
+  size_t high_water_mark;
+} MemoryArena;
+
+typedef struct ArenaMarker {
+  size_t used;
+} ArenaMarker;
+
+inline
+MemoryArena arena_make(void *base, size_t size)
+{
+  return (MemoryArena){ .base = base, .size = size };
+}
+
+inline
+void *arena_push_size(MemoryArena *arena, size_t size, size_t alignment)
+{
+  assert(alignment && (alignment & (alignment - 1)) == 0);
+  size_t start = (arena->used + alignment - 1) & ~(alignment - 1);
+  if(start > arena->size || size > arena->size - start)
+    return NULL;
+
+  arena->used = start + size;
+  if(arena->used > arena->high_water_mark)
+    arena->high_water_mark = arena->used;
+  return arena->base + start;
+}
+
+// NOTE(leo): Not cleared. Memory straight from the platform starts out zeroed, but reused memory doesn't
+#define arena_push_struct(arena, type) ((type *)arena_push_size((arena), sizeof(type), __alignof(type)))
+#define arena_push_array(arena, count, type) ((type *)arena_push_size((arena), (count)*sizeof(type), __alignof(type)))
+
+inline
+ArenaMarker arena_marker(MemoryArena *arena)
+{
+  return (ArenaMarker){ .used = arena->used };
+}
+
+inline
+void arena_pop_to(MemoryArena *arena, ArenaMarker marker)
+{
+  assert(marker.used <= arena->used);
+  arena->used = marker.used;
+}
+
+inline
+void arena_reset(MemoryArena *arena)
+{
+  arena->used = 0;
+}
+
+/*
+  Handed to the game by the platform, sizes are picked at startup. The permanent arena holds everything that lives
+  across frames, starting with the game state. The frame arena is scratch memory, reset at the start of every frame.
+*/
 typedef struct GameMemory {
-  U8 memory[4096];
+  MemoryArena permanent_arena;
+  MemoryArena frame_arena;
+
+  void *game_state; // NOTE(leo): First thing in permanent_arena, pushed on first use
 } GameMemory;
@@ -0,0 +1,299 @@
+#include "win32_audio.h"
+
+#include <math.h>
+#include <emmintrin.h>
+
+internal
+void win32_null_sink_write(Win32AudioSink *sink, S16 *samples, U32 sample_count)
+{
+}
+
+internal
+void win32_null_sink_close(Win32AudioSink *sink)
+{
+}
+
+void win32_audio_null_sink(Win32AudioSink *sink)
+{
+  *sink = (Win32AudioSink){
+    .write = win32_null_sink_write,
+    .close = win32_null_sink_close,
+  };
+}
+
+#pragma pack(push, 1)
+typedef struct WavHeader {
+  char riff_id[4];
+  U32 riff_size;
+  char wave_id[4];
+
+  char fmt_id[4];
+  U32 fmt_size;
+  U16 format;
+  U16 channel_count;
+  U32 sample_rate;
+  U32 byte_rate;
+  U16 block_align;
+  U16 bits_per_sample;
+
+  char data_id[4];
+  U32 data_size;
+} WavHeader;
+#pragma pack(pop)
+
+internal
+void win32_wav_sink_write(Win32AudioSink *sink, S16 *samples, U32 sample_count)
+{
+  DWORD written;
+  WriteFile(sink->file, samples, sample_count*sizeof(S16), &written, NULL);
+  sink->data_size += written;
+}
+
+// NOTE(leo): Patches the sizes into the header, which was written with zeros when the file was opened
+internal
+void win32_wav_sink_close(Win32AudioSink *sink)
+{
+  DWORD written;
+  U32 riff_size = sizeof(WavHeader) - 8 + sink->data_size;
+  SetFilePointer(sink->file, offsetof(WavHeader, riff_size), NULL, FILE_BEGIN);
+  WriteFile(sink->file, &riff_size, sizeof(riff_size), &written, NULL);
+  SetFilePointer(sink->file, offsetof(WavHeader, data_size), NULL, FILE_BEGIN);
+  WriteFile(sink->file, &sink->data_size, sizeof(sink->data_size), &written, NULL);
+  CloseHandle(sink->file);
+}
+
+bool win32_audio_open_wav_sink(Win32AudioSink *sink, char *path)
+{
+  HANDLE file = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if(file == INVALID_HANDLE_VALUE)
+    return false;
+
+  WavHeader header = {
+    .riff_id = { 'R', 'I', 'F', 'F' },
+    .wave_id = { 'W', 'A', 'V', 'E' },
+    .fmt_id = { 'f', 'm', 't', ' ' },
+    .fmt_size = 16,
+    .format = 1, // NOTE(leo): PCM
+    .channel_count = 1,
+    .sample_rate = WIN32_AUDIO_SAMPLE_RATE,
+    .byte_rate = WIN32_AUDIO_SAMPLE_RATE*sizeof(S16),
+    .block_align = sizeof(S16),
+    .bits_per_sample = 16,
+    .data_id = { 'd', 'a', 't', 'a' },
+  };
+  DWORD written;
+  WriteFile(file, &header, sizeof(header), &written, NULL);
+
+  *sink = (Win32AudioSink){
+    .write = win32_wav_sink_write,
+    .close = win32_wav_sink_close,
+    .file = file,
+  };
+  return true;
+}
+
+// NOTE(leo): Decaying tone sweeping from start_frequency to end_frequency
+internal
+U32 win32_synthesize_tone(F32 *samples, F32 duration, F32 start_frequency, F32 end_frequency, bool is_square)
+{
+  U32 sample_count = (U32)(duration*WIN32_AUDIO_SAMPLE_RATE);
+  if(samples) {
+    F32 PI = 3.14159f;
+    F32 phase = 0.0f;
+    for(U32 i = 0; i < sample_count; i++) {
+      F32 t = (F32)i/(F32)sample_count;
+      F32 frequency = start_frequency + (end_frequency - start_frequency)*t;
+      phase += 2.0f*PI*frequency/WIN32_AUDIO_SAMPLE_RATE;
+      F32 value = sinf(phase);
+      if(is_square)
+        value = value < 0.0f ? -0.5f : 0.5f;
+      // NOTE(leo): Short attack against clicks, then exponential decay
+      F32 envelope = expf(-5.0f*t);
+      if(i < 64)
+        envelope *= (F32)i/64.0f;
+      samples[i] = value*envelope;
+    }
+  }
+  return (sample_count + 3) & ~3u;
+}
+
+internal
+U32 win32_synthesize_sound(F32 *samples, int sound)
+{
+  switch(sound) {
+    case WIN32_SOUND_BRICK_0: return win32_synthesize_tone(samples, 0.08f, 440.0f, 440.0f, false);
+    case WIN32_SOUND_BRICK_1: return win32_synthesize_tone(samples, 0.08f, 523.0f, 523.0f, false);
+    case WIN32_SOUND_BRICK_2: return win32_synthesize_tone(samples, 0.08f, 659.0f, 659.0f, false);
+    case WIN32_SOUND_BRICK_3: return win32_synthesize_tone(samples, 0.08f, 784.0f, 784.0f, false);
+    case WIN32_SOUND_WALL: return win32_synthesize_tone(samples, 0.04f, 220.0f, 220.0f, true);
+    case WIN32_SOUND_PADDLE: return win32_synthesize_tone(samples, 0.06f, 330.0f, 330.0f, true);
+    case WIN32_SOUND_ROUND_OVER: return win32_synthesize_tone(samples, 0.4f, 440.0f, 110.0f, true);
+  }
+  assert(false);
+  return 0;
+}
+
+internal
+void win32_audio_mix_block(Win32Audio *audio, S16 *output)
+{
+  F32 *mix = audio->mix_buffer;
+  __m128 zero_4 = _mm_setzero_ps();
+  for(int i = 0; i < WIN32_AUDIO_BLOCK_SAMPLE_COUNT; i += 4)
+    _mm_storeu_ps(mix + i, zero_4);
+
+  for(int voice_index = 0; voice_index < audio->voice_count;) {
+    Win32Voice *voice = &audio->voices[voice_index];
+    Win32Sound *sound = &audio->sounds[voice->sound];
+
+    // NOTE(leo): position and sample_count are multiples of 4
+    U32 count = sound->sample_count - voice->position;
+    if(count > WIN32_AUDIO_BLOCK_SAMPLE_COUNT)
+      count = WIN32_AUDIO_BLOCK_SAMPLE_COUNT;
+    F32 *samples = sound->samples + voice->position;
+    __m128 volume_4 = _mm_set1_ps(voice->volume);
+    for(U32 i = 0; i < count; i += 4) {
+      __m128 sum = _mm_add_ps(_mm_loadu_ps(mix + i), _mm_mul_ps(_mm_loadu_ps(samples + i), volume_4));
+      _mm_storeu_ps(mix + i, sum);
+    }
+
+    voice->position += count;
+    if(voice->position >= sound->sample_count)
+      *voice = audio->voices[--audio->voice_count];
+    else
+      voice_index++;
+  }
+
+  __m128 min_4 = _mm_set1_ps(-1.0f);
+  __m128 max_4 = _mm_set1_ps(1.0f);
+  __m128 scale_4 = _mm_set1_ps(32767.0f);
+  for(int i = 0; i < WIN32_AUDIO_BLOCK_SAMPLE_COUNT; i += 8) {
+    __m128 a = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(mix + i), min_4), max_4), scale_4);
+    __m128 b = _mm_mul_ps(_mm_min_ps(_mm_max_ps(_mm_loadu_ps(mix + i + 4), min_4), max_4), scale_4);
+    __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+    _mm_storeu_si128((__m128i *)(output + i), packed);
+  }
+}
+
+DWORD WINAPI win32_audio_thread_proc(void *parameter)
+{
+  Win32Audio *audio = parameter;
+
+  LARGE_INTEGER timer_frequency;
+  QueryPerformanceFrequency(&timer_frequency);
+  LARGE_INTEGER start_time;
+  QueryPerformanceCounter(&start_time);
+  F64 block_duration = (F64)WIN32_AUDIO_BLOCK_SAMPLE_COUNT/WIN32_AUDIO_SAMPLE_RATE;
+  local_persist S16 silence[WIN32_AUDIO_BLOCK_SAMPLE_COUNT];
+
+  // NOTE(leo): Stats, reported and reset once a second
+  F64 report_time = 1.0;
+  F64 mix_time_sum = 0.0;
+  F64 mix_time_max = 0.0;
+  int mixed_count = 0;
+  int underrun_count = 0;
+
+  while(!audio->is_quitting) {
+    // NOTE(leo): Start voices
+    Win32AudioCommand command;
+    while(spsc_queue_pop(&audio->commands, &command)) {
+      if(audio->voice_count < WIN32_AUDIO_MAX_VOICE_COUNT) {
+        audio->voices[audio->voice_count++] = (Win32Voice){ .sound = command.sound, .volume = command.volume };
+      }
+      else {
+        InterlockedIncrement(&audio->dropped_command_count);
+      }
+    }
+
+    // NOTE(leo): Mix ahead of the sink
+    while(audio->mixed_block_count - audio->consumed_block_count < WIN32_AUDIO_LATENCY_BLOCK_COUNT) {
+      LARGE_INTEGER mix_start, mix_end;
+      QueryPerformanceCounter(&mix_start);
+      win32_audio_mix_block(audio, audio->ring[audio->mixed_block_count & (WIN32_AUDIO_RING_BLOCK_COUNT-1)]);
+      QueryPerformanceCounter(&mix_end);
+      audio->mixed_block_count++;
+
+      F64 mix_time = (F64)(mix_end.QuadPart - mix_start.QuadPart)/(F64)timer_frequency.QuadPart;
+      mix_time_sum += mix_time;
+      if(mix_time > mix_time_max)
+        mix_time_max = mix_time;
+      mixed_count++;
+    }
+
+    // NOTE(leo): The sink takes a block whenever one is due by the wall clock
+    LARGE_INTEGER now;
+    QueryPerformanceCounter(&now);
+    F64 elapsed = (F64)(now.QuadPart - start_time.QuadPart)/(F64)timer_frequency.QuadPart;
+    U64 due_block_count = (U64)(elapsed/block_duration);
+    while(audio->consumed_block_count < due_block_count) {
+      if(audio->consumed_block_count < audio->mixed_block_count) {
+        audio->sink.write(&audio->sink, audio->ring[audio->consumed_block_count & (WIN32_AUDIO_RING_BLOCK_COUNT-1)], WIN32_AUDIO_BLOCK_SAMPLE_COUNT);
+      }
+      else {
+        underrun_count++;
+        audio->sink.write(&audio->sink, silence, WIN32_AUDIO_BLOCK_SAMPLE_COUNT);
+      }
+      audio->consumed_block_count++;
+    }
+    // NOTE(leo): Blocks that are late already are pointless to mix
+    if(audio->mixed_block_count < audio->consumed_block_count)
+      audio->mixed_block_count = audio->consumed_block_count;
+
+    if(elapsed >= report_time) {
+      char text[160];
+      wsprintfA(text, "Audio: mix %d us mean, %d us max per block, %d underruns, %d dropped sounds\n",
+        mixed_count ? (int)(1e6*mix_time_sum/mixed_count) : 0, (int)(1e6*mix_time_max), underrun_count,
+        (int)InterlockedExchange(&audio->dropped_command_count, 0));
+      OutputDebugStringA(text);
+
+      report_time += 1.0;
+      mix_time_sum = 0.0;
+      mix_time_max = 0.0;
+      mixed_count = 0;
+      underrun_count = 0;
+    }
+
+    // NOTE(leo): Until the next block is due
+    F64 wait = (due_block_count + 1)*block_duration - elapsed;
+    DWORD wait_ms = (DWORD)(wait*1000.0);
+    Sleep(wait_ms ? wait_ms : 1);
+  }
+
+  return 0;
+}
+
+bool win32_audio_start(Win32Audio *audio, Win32AudioSink sink)
+{
+  U32 total_sample_count = 0;
+  for(int sound = 0; sound < WIN32_SOUND_COUNT; sound++)
+    total_sample_count += win32_synthesize_sound(NULL, sound);
+
+  F32 *samples = VirtualAlloc(NULL, total_sample_count*sizeof(F32), MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  if(!samples)
+    return false;
+  for(int sound = 0; sound < WIN32_SOUND_COUNT; sound++) {
+    audio->sounds[sound] = (Win32Sound){ .samples = samples, .sample_count = win32_synthesize_sound(samples, sound) };
+    samples += audio->sounds[sound].sample_count;
+  }
+
+  spsc_queue_init(&audio->commands, audio->commands_data, sizeof(Win32AudioCommand), WIN32_AUDIO_COMMAND_QUEUE_CAPACITY);
+  audio->sink = sink;
+  audio->thread = CreateThread(NULL, 0, win32_audio_thread_proc, audio, 0, NULL);
+  return audio->thread != NULL;
+}
+
+void win32_audio_stop(Win32Audio *audio)
+{
+  if(!audio->thread)
+    return;
+  audio->is_quitting = true;
+  WaitForSingleObject(audio->thread, INFINITE);
+  audio->sink.close(&audio->sink);
+  audio->thread = NULL;
+}
+
+void win32_audio_play(Win32Audio *audio, U16 sound, F32 volume)
+{
+  Win32AudioCommand command = { .sound = sound, .volume = volume };
+  if(!spsc_queue_push(&audio->commands, &command))
+    InterlockedIncrement(&audio->dropped_command_count);
+}
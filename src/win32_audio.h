@@ -0,0 +1,103 @@
+#pragma once
+
+#include "util.h"
+#include "spsc_queue.h"
+
+#include <windows.h>
+
+#define WIN32_AUDIO_SAMPLE_RATE 48000
+// NOTE(leo): Multiple of 8 (simd conversion to S16). ~10.7 ms
+#define WIN32_AUDIO_BLOCK_SAMPLE_COUNT 512
+// NOTE(leo): Power of two
+#define WIN32_AUDIO_RING_BLOCK_COUNT 8
+// NOTE(leo): How many blocks the mixer stays ahead of the sink. Latency of a sound is up to this many blocks
+#define WIN32_AUDIO_LATENCY_BLOCK_COUNT 3
+#define WIN32_AUDIO_MAX_VOICE_COUNT 32
+// NOTE(leo): Power of two
+#define WIN32_AUDIO_COMMAND_QUEUE_CAPACITY 256
+
+enum {
+  WIN32_SOUND_BRICK_0,
+  WIN32_SOUND_BRICK_1,
+  WIN32_SOUND_BRICK_2,
+  WIN32_SOUND_BRICK_3,
+  WIN32_SOUND_WALL,
+  WIN32_SOUND_PADDLE,
+  WIN32_SOUND_ROUND_OVER,
+
+  WIN32_SOUND_COUNT,
+};
+
+typedef struct Win32AudioCommand {
+  U16 sound;
+  F32 volume;
+} Win32AudioCommand;
+
+// NOTE(leo): Mono, 48 kHz, sample_count padded to a multiple of 4 with silence
+typedef struct Win32Sound {
+  F32 *samples;
+  U32 sample_count;
+} Win32Sound;
+
+typedef struct Win32Voice {
+  U16 sound;
+  U32 position;
+  F32 volume;
+} Win32Voice;
+
+typedef struct Win32AudioSink Win32AudioSink;
+
+// NOTE(leo): Called on the mixer thread with one block of mono 48 kHz samples
+typedef void (Win32AudioSinkWrite)(Win32AudioSink *sink, S16 *samples, U32 sample_count);
+typedef void (Win32AudioSinkClose)(Win32AudioSink *sink);
+
+// NOTE(leo): Where mixed audio ends up. See win32_audio_null_sink, win32_audio_open_wav_sink
+struct Win32AudioSink {
+  Win32AudioSinkWrite *write;
+  Win32AudioSinkClose *close;
+
+  // NOTE(leo): WAV
+  HANDLE file;
+  U32 data_size;
+};
+
+/*
+  Software mixer on its own thread.
+
+  The game thread only ever calls win32_audio_play, which pushes a command onto an SPSC queue and returns; it never
+  blocks or allocates, and if the queue is full the sound is dropped (and counted). The mixer thread starts voices from
+  the commands, mixes them 4 samples at a time into blocks of a ring buffer and hands one block per block duration of
+  wall clock time to the sink, like a sound card would pull them. A block that is due but not mixed yet is an
+  underrun; the sink gets silence instead.
+
+  Once a second the mixer reports mix cost per block, underruns and dropped sounds with OutputDebugStringA.
+*/
+typedef struct Win32Audio {
+  SpscQueue commands;
+  Win32AudioCommand commands_data[WIN32_AUDIO_COMMAND_QUEUE_CAPACITY];
+  volatile LONG dropped_command_count;
+
+  Win32AudioSink sink;
+  Win32Sound sounds[WIN32_SOUND_COUNT];
+
+  // NOTE(leo): Mixer thread only
+  Win32Voice voices[WIN32_AUDIO_MAX_VOICE_COUNT];
+  int voice_count;
+  F32 mix_buffer[WIN32_AUDIO_BLOCK_SAMPLE_COUNT];
+  S16 ring[WIN32_AUDIO_RING_BLOCK_COUNT][WIN32_AUDIO_BLOCK_SAMPLE_COUNT];
+  U64 mixed_block_count;
+  U64 consumed_block_count;
+
+  HANDLE thread;
+  volatile bool is_quitting;
+} Win32Audio;
+
+void win32_audio_null_sink(Win32AudioSink *sink);
+bool win32_audio_open_wav_sink(Win32AudioSink *sink, char *path);
+
+// NOTE(leo): Synthesizes the sounds and starts the mixer thread, which owns sink from now on
+bool win32_audio_start(Win32Audio *audio, Win32AudioSink sink);
+void win32_audio_stop(Win32Audio *audio);
+
+// NOTE(leo): Game thread only. Never blocks
+void win32_audio_play(Win32Audio *audio, U16 sound, F32 volume);
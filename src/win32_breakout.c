@@ -38,20 +38,162 @@ enum {
 
 #define MAX_MENU_ENTRY_COUNT (max(max(max(max(MAIN_COUNT, DIFFICULTY_COUNT), WAIT_SERVE_COUNT), PAUSE_COUNT), GAME_OVER_COUNT))
 
+// NOTE(leo): Power of two. A level is played for at least half a minute, so a few are plenty
+#define WIN32_GENERATED_LEVEL_CAPACITY 4
+
+typedef struct Win32LevelGenerator {
+  SpscQueue queue;
+  Level levels[WIN32_GENERATED_LEVEL_CAPACITY];
+  Level level; // NOTE(leo): Generated into, then pushed
+  HANDLE taken_event; // NOTE(leo): Auto-reset. Set when the game took a level, the generator waits on it while full
+  U32 seed;
+  U32 level_index;
+} Win32LevelGenerator;
+
 typedef struct Win32GameState {
   GameState game_state;
   int selected;
+  ParticleSystem *particles;
+  LevelPack level_pack;
+  Win32LevelGenerator *level_generator; // NOTE(leo): Endless mode only
+
+  // NOTE(leo): Consumers of GameState.events
+  U32 audio_event_index;
+  U32 telemetry_event_index;
+  U32 telemetry_counts[GAME_EVENT_TYPE_COUNT];
+  F32 stats_time;
 } Win32GameState;
 
+internal
+Win32GameState *win32_get_game_state(GameMemory *game_memory)
+{
+  if(!game_memory->game_state) {
+    Win32GameState *win32_game_state = arena_push_struct(&game_memory->permanent_arena, Win32GameState);
+    assert(win32_game_state);
+    // NOTE(leo): 16 byte aligned for simd. Effects are optional, the game runs without them if memory is short
+    win32_game_state->particles = arena_push_size(&game_memory->permanent_arena, sizeof(ParticleSystem), 16);
+    game_memory->game_state = win32_game_state;
+  }
+  return game_memory->game_state;
+}
+
+size_t win32_game_memory_min_size(void)
+{
+  return sizeof(Win32GameState);
+}
+
+bool win32_open_level_pack(GameMemory *game_memory, char *path, int first_level_index)
+{
+  HANDLE file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+  if(file == INVALID_HANDLE_VALUE)
+    return false;
+  LARGE_INTEGER file_size;
+  if(!GetFileSizeEx(file, &file_size) || file_size.QuadPart == 0) {
+    CloseHandle(file);
+    return false;
+  }
+  HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+  CloseHandle(file);
+  if(!mapping)
+    return false;
+  // NOTE(leo): The view keeps the file mapped until the process exits. Pages are only read in when a level is decoded
+  void *data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+  CloseHandle(mapping);
+  if(!data)
+    return false;
+
+  Win32GameState *win32_game_state = win32_get_game_state(game_memory);
+  if(!level_pack_open(&win32_game_state->level_pack, data, (U64)file_size.QuadPart)) {
+    UnmapViewOfFile(data);
+    return false;
+  }
+  win32_game_state->game_state.level_pack = &win32_game_state->level_pack;
+  win32_game_state->game_state.first_level_index = first_level_index;
+  return true;
+}
+
+// NOTE(leo): Keeps the queue full, runs until the process exits. Sleeps while it is full, until the game takes a level
+internal
+DWORD WINAPI win32_level_generator_proc(void *parameter)
+{
+  Win32LevelGenerator *generator = parameter;
+  for(;;) {
+    if(spsc_queue_count(&generator->queue) == WIN32_GENERATED_LEVEL_CAPACITY) {
+      WaitForSingleObject(generator->taken_event, INFINITE);
+      continue;
+    }
+    level_generate_valid(&generator->level, generator->seed, generator->level_index++);
+    spsc_queue_push(&generator->queue, &generator->level);
+  }
+}
+
+bool win32_start_level_generator(GameMemory *game_memory, U32 seed)
+{
+  Win32LevelGenerator *generator = arena_push_struct(&game_memory->permanent_arena, Win32LevelGenerator);
+  if(!generator)
+    return false;
+  spsc_queue_init(&generator->queue, generator->levels, sizeof(Level), WIN32_GENERATED_LEVEL_CAPACITY);
+  generator->seed = seed;
+  generator->taken_event = CreateEventA(NULL, FALSE, FALSE, NULL);
+  if(!generator->taken_event)
+    return false;
+
+  HANDLE thread = CreateThread(NULL, 0, win32_level_generator_proc, generator, 0, NULL);
+  if(!thread)
+    return false;
+  CloseHandle(thread);
+
+  Win32GameState *win32_game_state = win32_get_game_state(game_memory);
+  win32_game_state->level_generator = generator;
+  GameState *game_state = &win32_game_state->game_state;
+  game_state->is_endless = true;
+  game_state->generated_levels = &generator->queue;
+  return true;
+}
+
+void win32_start_scrolling(GameMemory *game_memory, U32 seed)
+{
+  GameState *game_state = &win32_get_game_state(game_memory)->game_state;
+  game_state->scroll.speed = SCROLL_DEFAULT_SPEED;
+  game_state->scroll.seed = seed;
+}
+
 bool button_just_pressed(Button button)
 {
-  return button.is_down && !button.was_down;
+  if(button.was_down)
+    return button.half_transition_count >= 2;
+  return button.half_transition_count >= 1;
+}
+
+internal
+void win32_warp_cursor_to_paddle(HWND win32_window, POINT paddle_center_screen, Win32Input *input)
+{
+  SetCursorPos(paddle_center_screen.x, paddle_center_screen.y);
+  POINT client_pos = paddle_center_screen;
+  ScreenToClient(win32_window, &client_pos);
+  input->mouse = (V2){ client_pos.x, client_pos.y };
+  SetCursor(NULL);
+
+  // NOTE(leo): Earlier samples are from before the jump
+  input->frame_start_mouse = input->mouse;
+  input->mouse_sample_count = 0;
 }
 
-bool win32_game_update(GameMemory *game_memory, F32 dt, Win32Input *input, HWND win32_window, RenderCmdBuffer *cmd_buffer)
+Win32Transform win32_compute_playing_area_transform(V2 window_client_dim)
 {
-  assert(sizeof(Win32GameState) <= sizeof(game_memory->memory));
-  Win32GameState *win32_game_state = (Win32GameState *)&game_memory->memory;
+  Rect playing_area = compute_playing_area(window_client_dim);
+  Win32Transform result = {
+    .offset = v2_sub(v2_smul(2.0f, (V2) { playing_area.pos.x/window_client_dim.x, playing_area.pos.y/window_client_dim.y }), (V2) { 1.0f, 1.0f }),
+    .scale = v2_smul(2.0f, (V2) { playing_area.dim.x/window_client_dim.x/PLAYING_AREA_WIDTH, playing_area.dim.y/window_client_dim.y/PLAYING_AREA_HEIGHT }),
+  };
+  return result;
+}
+
+bool win32_game_update(GameMemory *game_memory, F32 dt, Win32Input *input, HWND win32_window, Win32Audio *audio, RenderLayer *static_layer, RenderCmdBuffer *cmd_buffer)
+{
+  arena_reset(&game_memory->frame_arena);
+
+  Win32GameState *win32_game_state = win32_get_game_state(game_memory);
   GameState *game_state = &win32_game_state->game_state;
 
   V2 window_client_dim;
@@ -109,19 +251,11 @@ bool win32_game_update(GameMemory *game_memory, F32 dt, Win32Input *input, HWND
     }
     else if(game_state->state == GAME_STATE_WAIT_SERVE && win32_game_state->selected == WAIT_SERVE_SERVE) {
       game_serve(game_state);
-      SetCursorPos(paddle_center_screen.x, paddle_center_screen.y);
-      POINT client_pos = paddle_center_screen;
-      ScreenToClient(win32_window, &client_pos);
-      input->mouse = (V2){ client_pos.x, client_pos.y };
-      SetCursor(NULL);
+      win32_warp_cursor_to_paddle(win32_window, paddle_center_screen, input);
     }
     else if(game_state->state == GAME_STATE_PAUSE && win32_game_state->selected == PAUSE_CONTINUE) {
       game_state->state = GAME_STATE_PLAYING;
-      SetCursorPos(paddle_center_screen.x, paddle_center_screen.y);
-      POINT client_pos = paddle_center_screen;
-      ScreenToClient(win32_window, &client_pos);
-      input->mouse = (V2){ client_pos.x, client_pos.y };
-      SetCursor(NULL);
+      win32_warp_cursor_to_paddle(win32_window, paddle_center_screen, input);
     }
     else if((game_state->state == GAME_STATE_PAUSE && win32_game_state->selected == PAUSE_MAIN_MENU)
       || (game_state->state == GAME_STATE_GAME_OVER && win32_game_state->selected == GAME_OVER_MAIN_MENU))
@@ -140,11 +274,7 @@ bool win32_game_update(GameMemory *game_memory, F32 dt, Win32Input *input, HWND
     }
     else if(game_state->state == GAME_STATE_PAUSE) {
       game_state->state = GAME_STATE_PLAYING;
-      SetCursorPos(paddle_center_screen.x, paddle_center_screen.y);
-      POINT client_pos = paddle_center_screen;
-      ScreenToClient(win32_window, &client_pos);
-      input->mouse = (V2){ client_pos.x, client_pos.y };
-      SetCursor(NULL);
+      win32_warp_cursor_to_paddle(win32_window, paddle_center_screen, input);
     }
   }
 
@@ -167,11 +297,91 @@ bool win32_game_update(GameMemory *game_memory, F32 dt, Win32Input *input, HWND
 
   Input game_input = { .paddle_control = -1.0f };
   if(game_state->state == GAME_STATE_PLAYING) {
-    game_input.paddle_control = (input->mouse.x - paddle_motion_rect.pos.x) / paddle_motion_rect.dim.x;
+    game_input.paddle_control = (input->frame_start_mouse.x - paddle_motion_rect.pos.x) / paddle_motion_rect.dim.x;
+
+    int sample_count = input->mouse_sample_count;
+    if(sample_count > MAX_PADDLE_SAMPLE_COUNT)
+      sample_count = MAX_PADDLE_SAMPLE_COUNT;
+    for(int sample_index = 0; sample_index < sample_count; sample_index++) {
+      Win32MouseSample sample = input->mouse_samples[sample_index];
+      game_input.paddle_samples[sample_index] = (PaddleSample){
+        .time = sample.time,
+        .paddle_control = (sample.mouse.x - paddle_motion_rect.pos.x) / paddle_motion_rect.dim.x,
+      };
+    }
+    game_input.paddle_sample_count = sample_count;
   }
 
-  game_update(&win32_game_state->game_state, dt, &game_input, cmd_buffer);
+  Win32LevelGenerator *generator = win32_game_state->level_generator;
+  U32 generated_level_count = generator ? spsc_queue_count(&generator->queue) : 0;
+
+  game_update(&win32_game_state->game_state, dt, &game_input, win32_game_state->particles, static_layer, cmd_buffer);
+
+  if(generator && spsc_queue_count(&generator->queue) < generated_level_count)
+    SetEvent(generator->taken_event);
+
+  // NOTE(leo): Sounds
+  if(audio) {
+    GameEventRing *events = &game_state->events;
+    game_events_catch_up(events, &win32_game_state->audio_event_index);
+    for(; win32_game_state->audio_event_index != events->write_index; win32_game_state->audio_event_index++) {
+      GameEvent *event = game_event_at(events, win32_game_state->audio_event_index);
+      // NOTE(leo): The ball keeps bouncing behind the game over menu, quietly
+      if(game_state->state == GAME_STATE_GAME_OVER && (event->type == GAME_EVENT_WALL_HIT || event->type == GAME_EVENT_PADDLE_HIT))
+        continue;
 
+      if(event->type == GAME_EVENT_BRICK_HIT)
+        win32_audio_play(audio, WIN32_SOUND_BRICK_0 + game_state->level.brick_types[event->brick_index], 0.5f);
+      else if(event->type == GAME_EVENT_BRICK_DAMAGED)
+        win32_audio_play(audio, WIN32_SOUND_BRICK_0 + game_state->level.brick_types[event->brick_index], 0.25f);
+      else if(event->type == GAME_EVENT_WALL_HIT)
+        win32_audio_play(audio, WIN32_SOUND_WALL, 0.3f);
+      else if(event->type == GAME_EVENT_PADDLE_HIT)
+        win32_audio_play(audio, WIN32_SOUND_PADDLE, 0.4f);
+      else if(event->type == GAME_EVENT_ROUND_OVER)
+        win32_audio_play(audio, WIN32_SOUND_ROUND_OVER, 0.5f);
+    }
+  }
+
+  // NOTE(leo): Telemetry. Hit counts per round
+  {
+    GameEventRing *events = &game_state->events;
+    U32 lost_event_count = game_events_catch_up(events, &win32_game_state->telemetry_event_index);
+    if(lost_event_count) {
+      char text[64];
+      wsprintfA(text, "Telemetry lost %d events\n", (int)lost_event_count);
+      OutputDebugStringA(text);
+    }
+
+    for(; win32_game_state->telemetry_event_index != events->write_index; win32_game_state->telemetry_event_index++) {
+      GameEvent *event = game_event_at(events, win32_game_state->telemetry_event_index);
+      win32_game_state->telemetry_counts[event->type]++;
+      if(event->type == GAME_EVENT_ROUND_OVER) {
+        U32 *counts = win32_game_state->telemetry_counts;
+        char text[128];
+        wsprintfA(text, "Round over: %d brick hits (%d broke), %d wall hits, %d paddle hits, score %d\n",
+          (int)(counts[GAME_EVENT_BRICK_HIT] + counts[GAME_EVENT_BRICK_DAMAGED]), (int)counts[GAME_EVENT_BRICK_HIT],
+          (int)counts[GAME_EVENT_WALL_HIT], (int)counts[GAME_EVENT_PADDLE_HIT], game_state->score);
+        OutputDebugStringA(text);
+        for(int type = 0; type < GAME_EVENT_TYPE_COUNT; type++)
+          counts[type] = 0;
+      }
+    }
+  }
+
+
+  // NOTE(leo): Entity stats, once a second while there are any
+  win32_game_state->stats_time += dt;
+  if(win32_game_state->stats_time >= 1.0f) {
+    win32_game_state->stats_time = 0.0f;
+    PowerUpPool *pool = &game_state->power_ups;
+    if(pool->count || game_state->ball_count > 1) {
+      char text[128];
+      wsprintfA(text, "Entities: %d power-ups (%d slots), %d balls, power-up update %d cycles\n",
+        pool->count, pool->slot_count, game_state->ball_count, (int)pool->update_cycles);
+      OutputDebugStringA(text);
+    }
+  }
 
   char *header = NULL;
   char *texts[MAX_MENU_ENTRY_COUNT] = { NULL };
@@ -245,30 +455,33 @@ bool win32_game_update(GameMemory *game_memory, F32 dt, Win32Input *input, HWND
     }
   }
 
-  // NOTE(leo): Adjust rect commands to playing area
-  {
-    V2 playing_area_offset = v2_sub(v2_smul(2.0f, (V2) { playing_area.pos.x/window_client_dim.x, playing_area.pos.y/window_client_dim.y }), (V2) { 1.0f, 1.0f });
-    V2 playing_area_dim = v2_smul(2.0f, (V2) { playing_area.dim.x/window_client_dim.x, playing_area.dim.y/window_client_dim.y });
-    for(int rect_index = 0; rect_index < cmd_buffer->count; rect_index++) {
-      Rect *rect = &cmd_buffer->commands[rect_index].rect;
-      rect->pos = v2_add(playing_area_offset, (V2) { rect->pos.x/PLAYING_AREA_WIDTH*playing_area_dim.x, rect->pos.y/PLAYING_AREA_HEIGHT*playing_area_dim.y });
-      rect->dim = (V2){ rect->dim.x/PLAYING_AREA_WIDTH*playing_area_dim.x, rect->dim.y/PLAYING_AREA_HEIGHT*playing_area_dim.y };
-    }
-  }
-
   return true;
 }
 
 bool win32_cursor_hidden(GameMemory *game_memory)
 {
-  Win32GameState *win32_game_state = (Win32GameState *)&game_memory->memory;
+  Win32GameState *win32_game_state = win32_get_game_state(game_memory);
   GameState *game_state = &win32_game_state->game_state;
   return game_state->state == GAME_STATE_PLAYING;
 }
 
+bool win32_game_is_idle(GameMemory *game_memory)
+{
+  Win32GameState *win32_game_state = win32_get_game_state(game_memory);
+  GameState *game_state = &win32_game_state->game_state;
+  // NOTE(leo): Particles keep moving outside of pause (eg the last hits' bursts after losing a ball), they'd freeze
+  if(game_state->state != GAME_STATE_PAUSE && win32_game_state->particles
+    && win32_game_state->particles->live_count > 0)
+    return false;
+  return game_state->state == GAME_STATE_PAUSE
+    || game_state->state == GAME_STATE_MAIN_MENU
+    || game_state->state == GAME_STATE_DIFFICULTY_SELECT
+    || game_state->state == GAME_STATE_WAIT_SERVE;
+}
+
 void win32_on_lose_focus(GameMemory *game_memory)
 {
-  Win32GameState *win32_game_state = (Win32GameState *)&game_memory->memory;
+  Win32GameState *win32_game_state = win32_get_game_state(game_memory);
   GameState *game_state = &win32_game_state->game_state;
 
   if(game_state->state == GAME_STATE_PLAYING)
@@ -2,15 +2,29 @@
 
 #include "util.h"
 #include "renderer.h"
+#include "win32_audio.h"
 
 #include <Windows.h>
 
 typedef struct Button {
   bool is_down, was_down;
+  int half_transition_count; // NOTE(leo): Down/up changes this frame, so a tap within a single frame isn't lost
 } Button;
 
-typedef struct Win32Input {
+#define WIN32_MAX_MOUSE_SAMPLE_COUNT 64
+
+typedef struct Win32MouseSample {
+  F32 time; // NOTE(leo): Seconds since the start of the frame
   V2 mouse;
+} Win32MouseSample;
+
+typedef struct Win32Input {
+  V2 mouse; // NOTE(leo): Latest position, client coordinates
+  V2 frame_start_mouse;
+  // NOTE(leo): Cursor movement during the frame, sorted by time
+  int mouse_sample_count;
+  Win32MouseSample mouse_samples[WIN32_MAX_MOUSE_SAMPLE_COUNT];
+
   Button key_escape;
   Button key_return;
   Button key_space;
@@ -18,10 +32,40 @@ typedef struct Win32Input {
   Button key_down;
 } Win32Input;
 
-#define RENDER_CMD_BUFFER_COUNT 1234
+// NOTE(leo): Command buffers reserve room for RENDER_CMD_BUFFER_MAX_COUNT commands, but only commit memory for them
+// RENDER_CMD_BUFFER_CHUNK_COUNT at a time, as they fill up
+#define RENDER_CMD_BUFFER_CHUNK_COUNT 1024
+#define RENDER_CMD_BUFFER_MAX_COUNT (1024*RENDER_CMD_BUFFER_CHUNK_COUNT)
+
+// NOTE(leo): audio may be NULL
+bool win32_game_update(GameMemory *game_memory, F32 dt, Win32Input *input, HWND win32_window, Win32Audio *audio, RenderLayer *static_layer, RenderCmdBuffer *cmd_buffer);
 
-bool win32_game_update(GameMemory *game_memory, F32 dt, Win32Input *input, HWND win32_window, RenderCmdBuffer *cmd_buffer);
+// NOTE(leo): Maps playing area units to normalized device coordinates: ndc = offset + scale*position
+typedef struct Win32Transform {
+  V2 offset;
+  V2 scale;
+} Win32Transform;
+
+Win32Transform win32_compute_playing_area_transform(V2 window_client_dim);
 
 bool win32_cursor_hidden(GameMemory *game_memory);
 
+// NOTE(leo): Smallest permanent arena the game runs with: its state is pushed first thing, everything after it is
+// optional
+size_t win32_game_memory_min_size(void);
+
+// NOTE(leo): Maps a level pack file (see levels.h) for the game to play from, starting at first_level_index. Call
+// before the first win32_game_update
+bool win32_open_level_pack(GameMemory *game_memory, char *path, int first_level_index);
+
+// NOTE(leo): Endless mode, with levels generated from seed on a thread of their own. Call before the first
+// win32_game_update
+bool win32_start_level_generator(GameMemory *game_memory, U32 seed);
+
+// NOTE(leo): Scrolling mode, with the brick field made from seed. Call before the first win32_game_update
+void win32_start_scrolling(GameMemory *game_memory, U32 seed);
+
+// NOTE(leo): True if nothing animates right now, so the platform may wait for input instead of drawing frames
+bool win32_game_is_idle(GameMemory *game_memory);
+
 void win32_on_lose_focus(GameMemory *game_memory);
@@ -1,32 +1,247 @@
 #include "util.h"
+#include "spsc_queue.h"
+#include "frame_ring.h"
+#include "rect_instance.h"
+#include "render_trace.h"
+#include "win32_audio.h"
 #include "win32_breakout.h"
 
 #include <windows.h>
 
 #include <gl/GL.h>
 
+#include <math.h>
+#include <stddef.h>
+
 #define GL_ARRAY_BUFFER 0x8892
+#define GL_STREAM_DRAW 0x88E0
+#define GL_SHORT 0x1402
+#define GL_MAP_WRITE_BIT 0x0002
+#define GL_MAP_INVALIDATE_RANGE_BIT 0x0004
+#define GL_MAP_INVALIDATE_BUFFER_BIT 0x0008
+#define GL_MAP_UNSYNCHRONIZED_BIT 0x0020
 
 typedef size_t GLsizeiptr;
 typedef intptr_t GLintptr;
-typedef void (GLBUFFERSUBDATAPROC) (GLenum target, GLintptr offset, GLsizeiptr size, const void *data);
-
-GLBUFFERSUBDATAPROC *glBufferSubData;
 
-#define FLOATS_PER_POSITION 2
-#define FLOATS_PER_COLOR 4
-#define FLOATS_PER_VERTEX (FLOATS_PER_POSITION+FLOATS_PER_COLOR)
-#define VERTICES_PER_TRIANGLE 3
-#define FLOATS_PER_TRIANGLE (VERTICES_PER_TRIANGLE*FLOATS_PER_VERTEX)
-#define TRIANGLES_PER_RECT 2
-#define FLOATS_PER_RECT (TRIANGLES_PER_RECT*FLOATS_PER_TRIANGLE)
+typedef void (GLBUFFERDATAPROC) (GLenum target, GLsizeiptr size, const void *data, GLenum usage);
+typedef void *(GLMAPBUFFERRANGEPROC) (GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access);
+typedef GLboolean(GLUNMAPBUFFERPROC) (GLenum target);
+typedef void (GLBINDBUFFERPROC) (GLenum target, GLuint buffer);
+typedef void (GLBINDVERTEXARRAYPROC) (GLuint array);
+typedef void (GLVERTEXATTRIBPOINTERPROC) (GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer);
+typedef void (GLDRAWARRAYSINSTANCEDPROC) (GLenum mode, GLint first, GLsizei count, GLsizei instancecount);
+typedef void (GLUNIFORM4FPROC) (GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3);
+
+GLBUFFERDATAPROC *glBufferData;
+GLMAPBUFFERRANGEPROC *glMapBufferRange;
+GLUNMAPBUFFERPROC *glUnmapBuffer;
+GLBINDBUFFERPROC *glBindBuffer;
+GLBINDVERTEXARRAYPROC *glBindVertexArray;
+GLVERTEXATTRIBPOINTERPROC *glVertexAttribPointer;
+GLDRAWARRAYSINSTANCEDPROC *glDrawArraysInstanced;
+GLUNIFORM4FPROC *glUniform4f;
+
+#define RECT_INSTANCE_POS_ATTRIBUTE 0
+#define RECT_INSTANCE_DIM_ATTRIBUTE 1
+#define RECT_INSTANCE_COLOR_ATTRIBUTE 2
+
+// NOTE(leo): Per frame instances are streamed through a ring buffer which is orphaned when it wraps around. Holds a few
+// frames worth of instances, so the driver rarely has to hand out new storage
+#define RECT_INSTANCE_RING_FRAME_COUNT 4
+
+typedef struct Win32OpenGL {
+  GLint playing_area_transform_uniform;
+  V2 viewport_dim;
+
+  // NOTE(leo): Static layer instances, only uploaded when the layer changes
+  GLuint static_vao;
+  GLuint static_vbo;
+  size_t static_vbo_size;
+  int static_instance_count;
+  U32 static_version;
+
+  GLuint ring_vao;
+  GLuint ring_vbo;
+  size_t ring_size;
+  size_t ring_offset;
+
+  size_t upload_size; // NOTE(leo): Bytes uploaded during the last frame
+} Win32OpenGL;
 
 global_variable bool global_running;
 global_variable Win32Input global_input;
 global_variable GameMemory global_game_memory;
-global_variable RectangleCmd global_rectangle_commands_data[RENDER_CMD_BUFFER_COUNT];
-global_variable float global_vertex_buffer_data[FLOATS_PER_RECT*RENDER_CMD_BUFFER_COUNT];
 global_variable bool global_active;
+global_variable V2 global_window_client_dim;
+global_variable Win32OpenGL global_opengl;
+
+// NOTE(leo): Address space is reserved once up front and committed in chunks as the buffer fills up, so growing never
+// moves what's already in it and nothing is allocated per command
+typedef struct Win32GrowableBuffer {
+  U8 *base;
+  size_t reserved_size;
+  size_t committed_size;
+  size_t chunk_size;
+  size_t high_water_mark;
+  char *name;
+} Win32GrowableBuffer;
+
+
+internal
+bool win32_grow_buffer(Win32GrowableBuffer *buffer, size_t min_size)
+{
+  if(min_size <= buffer->committed_size)
+    return true;
+  if(min_size > buffer->reserved_size)
+    return false;
+
+  size_t new_size = (min_size + buffer->chunk_size - 1)/buffer->chunk_size*buffer->chunk_size;
+  if(new_size > buffer->reserved_size)
+    new_size = buffer->reserved_size;
+  if(!VirtualAlloc(buffer->base + buffer->committed_size, new_size - buffer->committed_size, MEM_COMMIT, PAGE_READWRITE))
+    return false;
+  buffer->committed_size = new_size;
+  return true;
+}
+
+internal
+Win32GrowableBuffer win32_reserve_buffer(char *name, size_t reserved_size, size_t chunk_size)
+{
+  Win32GrowableBuffer result = {
+    .base = VirtualAlloc(NULL, reserved_size, MEM_RESERVE, PAGE_NOACCESS),
+    .reserved_size = reserved_size,
+    .chunk_size = chunk_size,
+    .name = name,
+  };
+  if(!result.base || !win32_grow_buffer(&result, chunk_size)) {
+    MessageBoxA(NULL, "Could not reserve render memory", "Error!", MB_OK|MB_ICONERROR);
+    exit(1);
+  }
+  return result;
+}
+
+internal
+void win32_track_buffer_usage(Win32GrowableBuffer *buffer, size_t used_size)
+{
+  if(used_size > buffer->high_water_mark) {
+    buffer->high_water_mark = used_size;
+
+    char text[128];
+    wsprintfA(text, "%s high water mark: %d bytes (%d committed)\n", buffer->name, (int)used_size, (int)buffer->committed_size);
+    OutputDebugStringA(text);
+  }
+}
+
+internal
+bool win32_grow_cmd_buffer(RenderCmdBuffer *cmd_buffer)
+{
+  Win32GrowableBuffer *buffer = cmd_buffer->grow_context;
+  if(!win32_grow_buffer(buffer, sizeof(RectangleCmd)*(cmd_buffer->capacity + 1)))
+    return false;
+  cmd_buffer->capacity = buffer->committed_size/sizeof(RectangleCmd);
+  return true;
+}
+
+internal
+RenderCmdBuffer win32_begin_cmd_buffer(Win32GrowableBuffer *buffer)
+{
+  RenderCmdBuffer result = {
+    .commands = (RectangleCmd *)buffer->base,
+    .count = 0,
+    .capacity = buffer->committed_size/sizeof(RectangleCmd),
+    .grow = win32_grow_cmd_buffer,
+    .grow_context = buffer,
+  };
+  return result;
+}
+
+// NOTE(leo): Everything the renderer needs to draw one frame. With a render thread, the game fills one frame while the
+// render thread draws the other
+typedef struct Win32RenderFrame {
+  RenderLayer static_layer;
+  RenderCmdBuffer cmd_buffer;
+  Win32GrowableBuffer static_layer_memory;
+  Win32GrowableBuffer commands_memory;
+
+  V2 window_client_dim;
+  F32 dt;
+} Win32RenderFrame;
+
+#define WIN32_RENDER_FRAME_COUNT 2
+
+global_variable Win32RenderFrame global_render_frames[WIN32_RENDER_FRAME_COUNT];
+
+// NOTE(leo): Frames are handed back and forth by index: game -> ready_frames -> render thread -> free_frames -> game.
+// The events only wake up a side waiting on an empty queue
+typedef struct Win32RenderThread {
+  HDC dc;
+  HGLRC glrc;
+
+  SpscQueue free_frames;
+  SpscQueue ready_frames;
+  int free_frames_data[WIN32_RENDER_FRAME_COUNT];
+  int ready_frames_data[WIN32_RENDER_FRAME_COUNT];
+  HANDLE free_frames_event;
+  HANDLE ready_frames_event;
+
+  volatile bool is_quitting;
+} Win32RenderThread;
+
+global_variable Win32RenderThread global_render_thread;
+
+// NOTE(leo): Cursor position, sampled by the input thread
+typedef struct Win32MouseEvent {
+  LONGLONG time; // NOTE(leo): QueryPerformanceCounter ticks
+  POINT position; // NOTE(leo): Screen coordinates
+} Win32MouseEvent;
+
+#define WIN32_MOUSE_EVENT_QUEUE_CAPACITY 256
+
+// NOTE(leo): Polls the cursor about once a millisecond, independent of the frame rate, so the game can see where the
+// cursor was in between frames. The main thread drains the events once per frame
+typedef struct Win32InputThread {
+  SpscQueue mouse_events;
+  Win32MouseEvent mouse_events_data[WIN32_MOUSE_EVENT_QUEUE_CAPACITY];
+  volatile LONG dropped_event_count;
+  volatile bool is_quitting;
+} Win32InputThread;
+
+global_variable Win32InputThread global_input_thread;
+
+global_variable Win32Audio global_audio;
+
+DWORD WINAPI win32_input_thread_proc(void *parameter)
+{
+  Win32InputThread *input_thread = parameter;
+
+  POINT last_position = { 0 };
+  while(!input_thread->is_quitting) {
+    Win32MouseEvent event;
+    GetCursorPos(&event.position);
+    if(event.position.x != last_position.x || event.position.y != last_position.y) {
+      LARGE_INTEGER now;
+      QueryPerformanceCounter(&now);
+      event.time = now.QuadPart;
+      if(spsc_queue_push(&input_thread->mouse_events, &event))
+        last_position = event.position;
+      else
+        InterlockedIncrement(&input_thread->dropped_event_count);
+    }
+    Sleep(1);
+  }
+  return 0;
+}
+
+internal
+void win32_process_key(Button *button, bool is_down)
+{
+  // NOTE(leo): Ignore key repeat
+  if(button->is_down != is_down) {
+    button->is_down = is_down;
+    button->half_transition_count++;
+  }
+}
 
 LRESULT CALLBACK main_window_proc(HWND window, UINT message, WPARAM w_param, LPARAM l_param)
 {
@@ -37,7 +252,7 @@ LRESULT CALLBACK main_window_proc(HWND window, UINT message, WPARAM w_param, LPA
       WORD mask = -1;
       WORD width = l_param & mask;
       WORD height = (l_param >> (sizeof(WORD)*8)) & mask;
-      glViewport(0, 0, width, height);
+      global_window_client_dim = (V2){ width, height };
     } break;
     case WM_CLOSE: {
       global_running = false;
@@ -50,19 +265,19 @@ LRESULT CALLBACK main_window_proc(HWND window, UINT message, WPARAM w_param, LPA
       DWORD vk = w_param;
       bool is_down = !(l_param & (1<<31));
       if(vk == VK_ESCAPE) {
-        global_input.key_escape.is_down = is_down;
+        win32_process_key(&global_input.key_escape, is_down);
       }
       else if(vk == VK_RETURN) {
-        global_input.key_return.is_down = is_down;
+        win32_process_key(&global_input.key_return, is_down);
       }
       else if(vk == VK_SPACE) {
-        global_input.key_space.is_down = is_down;
+        win32_process_key(&global_input.key_space, is_down);
       }
       else if(vk == VK_UP) {
-        global_input.key_up.is_down = is_down;
+        win32_process_key(&global_input.key_up, is_down);
       }
       else if(vk == VK_DOWN) {
-        global_input.key_down.is_down = is_down;
+        win32_process_key(&global_input.key_down, is_down);
       }
     } break;
     case WM_SETCURSOR : {
@@ -91,9 +306,10 @@ LRESULT CALLBACK main_window_proc(HWND window, UINT message, WPARAM w_param, LPA
   return result;
 }
 
-void win32_opengl_init(HDC dc)
+HGLRC win32_opengl_init(HDC dc, bool enable_vsync)
 {
-  // NOTE(leo): Create gl context
+  // NOTE(leo): Create gl context. Need a legacy context first to get at wglCreateContextAttribsARB
+  HGLRC glrc = NULL;
   {
     PIXELFORMATDESCRIPTOR pfd = {
       .nSize = sizeof(pfd),
@@ -112,28 +328,47 @@ void win32_opengl_init(HDC dc)
     BOOL ret = SetPixelFormat(dc, pixel_format, &pfd);
     assert(ret == TRUE);
 
-    HGLRC glrc = wglCreateContext(dc);
-    assert(glrc);
+    HGLRC legacy_glrc = wglCreateContext(dc);
+    assert(legacy_glrc);
+
+    ret = wglMakeCurrent(dc, legacy_glrc);
+    assert(ret == TRUE);
+
+    #define WGL_CONTEXT_MAJOR_VERSION_ARB 0x2091
+    #define WGL_CONTEXT_MINOR_VERSION_ARB 0x2092
+    #define WGL_CONTEXT_PROFILE_MASK_ARB 0x9126
+    #define WGL_CONTEXT_CORE_PROFILE_BIT_ARB 0x00000001
+
+    typedef HGLRC(APIENTRY *PFNWGLCREATECONTEXTATTRIBSARBPROC)(HDC, HGLRC, const int *);
+    PFNWGLCREATECONTEXTATTRIBSARBPROC wglCreateContextAttribsARB = (PFNWGLCREATECONTEXTATTRIBSARBPROC)wglGetProcAddress("wglCreateContextAttribsARB");
+
+    int attributes[] = {
+      WGL_CONTEXT_MAJOR_VERSION_ARB, 3,
+      WGL_CONTEXT_MINOR_VERSION_ARB, 3,
+      WGL_CONTEXT_PROFILE_MASK_ARB, WGL_CONTEXT_CORE_PROFILE_BIT_ARB,
+      0
+    };
+    if(wglCreateContextAttribsARB)
+      glrc = wglCreateContextAttribsARB(dc, NULL, attributes);
+    if(!glrc) {
+      MessageBoxA(NULL, "OpenGL 3.3 is not supported", "Error!", MB_OK|MB_ICONERROR);
+      exit(1);
+    }
 
     ret = wglMakeCurrent(dc, glrc);
     assert(ret == TRUE);
+    wglDeleteContext(legacy_glrc);
   }
 
-  // NOTE(leo): Enable vsync
+  // NOTE(leo): Enable/disable vsync. Core contexts can't list extensions through glGetString, so just ask for the function
   {
-    const char *extensions = (char *)glGetString(GL_EXTENSIONS);
-
-    if(strstr(extensions, "WGL_EXT_swap_control") != NULL) {
-      typedef BOOL(APIENTRY *PFNWGLSWAPINTERVALPROC)(int);
-      PFNWGLSWAPINTERVALPROC wglSwapIntervalEXT = 0;
-      wglSwapIntervalEXT = (PFNWGLSWAPINTERVALPROC)wglGetProcAddress("wglSwapIntervalEXT");
+    typedef BOOL(APIENTRY *PFNWGLSWAPINTERVALPROC)(int);
+    PFNWGLSWAPINTERVALPROC wglSwapIntervalEXT = (PFNWGLSWAPINTERVALPROC)wglGetProcAddress("wglSwapIntervalEXT");
 
-      if(wglSwapIntervalEXT)
-        wglSwapIntervalEXT(1);
-    }
+    if(wglSwapIntervalEXT)
+      wglSwapIntervalEXT(enable_vsync ? 1 : 0);
   }
 
-  #define GL_STREAM_DRAW 0x88E0
   #define GL_VERTEX_SHADER 0x8B31
   #define GL_FRAGMENT_SHADER 0x8B30
   #define GL_COMPILE_STATUS 0x8B81
@@ -142,8 +377,7 @@ void win32_opengl_init(HDC dc)
   typedef char GLchar;
 
   typedef void (GLGENBUFFERSPROC) (GLsizei n, GLuint *buffers);
-  typedef void (GLBINDBUFFERPROC) (GLenum target, GLuint buffer);
-  typedef void (GLBUFFERDATAPROC) (GLenum target, GLsizeiptr size, const void *data, GLenum usage);
+  typedef void (GLGENVERTEXARRAYSPROC) (GLsizei n, GLuint *arrays);
   typedef GLuint(GLCREATESHADERPROC) (GLenum type);
   typedef void (GLSHADERSOURCEPROC) (GLuint shader, GLsizei count, const GLchar *const *string, const GLint *length);
   typedef void (GLCOMPILESHADERPROC) (GLuint shader);
@@ -153,15 +387,14 @@ void win32_opengl_init(HDC dc)
   typedef void (GLATTACHSHADERPROC) (GLuint program, GLuint shader);
   typedef void (GLLINKPROGRAMPROC) (GLuint program);
   typedef void (GLUSEPROGRAMPROC) (GLuint program);
-  typedef void (GLVERTEXATTRIBPOINTERPROC) (GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void *pointer);
   typedef void (GLENABLEVERTEXATTRIBARRAYPROC) (GLuint index);
-  typedef GLint(GLGETATTRIBLOCATIONPROC) (GLuint program, const GLchar *name);
+  typedef void (GLVERTEXATTRIBDIVISORPROC) (GLuint index, GLuint divisor);
+  typedef GLint(GLGETUNIFORMLOCATIONPROC) (GLuint program, const GLchar *name);
   typedef void (GLGETPROGRAMIVPROC) (GLuint program, GLenum pname, GLint *params);
   typedef void (GLGETPROGRAMINFOLOGPROC) (GLuint program, GLsizei bufSize, GLsizei *length, GLchar *infoLog);
 
   GLGENBUFFERSPROC *glGenBuffers = NULL;
-  GLBINDBUFFERPROC *glBindBuffer = NULL;
-  GLBUFFERDATAPROC *glBufferData = NULL;
+  GLGENVERTEXARRAYSPROC *glGenVertexArrays = NULL;
   GLCREATESHADERPROC *glCreateShader = NULL;
   GLSHADERSOURCEPROC *glShaderSource = NULL;
   GLCOMPILESHADERPROC *glCompileShader = NULL;
@@ -171,9 +404,9 @@ void win32_opengl_init(HDC dc)
   GLATTACHSHADERPROC *glAttachShader = NULL;
   GLLINKPROGRAMPROC *glLinkProgram = NULL;
   GLUSEPROGRAMPROC *glUseProgram = NULL;
-  GLVERTEXATTRIBPOINTERPROC *glVertexAttribPointer = NULL;
   GLENABLEVERTEXATTRIBARRAYPROC *glEnableVertexAttribArray = NULL;
-  GLGETATTRIBLOCATIONPROC *glGetAttribLocation = NULL;
+  GLVERTEXATTRIBDIVISORPROC *glVertexAttribDivisor = NULL;
+  GLGETUNIFORMLOCATIONPROC *glGetUniformLocation = NULL;
   GLGETPROGRAMIVPROC *glGetProgramiv = NULL;
   GLGETPROGRAMINFOLOGPROC *glGetProgramInfoLog = NULL;
 
@@ -188,9 +421,12 @@ void win32_opengl_init(HDC dc)
     } while(false)
 
     LOAD(glGenBuffers);
+    LOAD(glGenVertexArrays);
     LOAD(glBindBuffer);
+    LOAD(glBindVertexArray);
     LOAD(glBufferData);
-    LOAD(glBufferSubData);
+    LOAD(glMapBufferRange);
+    LOAD(glUnmapBuffer);
     LOAD(glCreateShader);
     LOAD(glShaderSource);
     LOAD(glCompileShader);
@@ -202,32 +438,63 @@ void win32_opengl_init(HDC dc)
     LOAD(glUseProgram);
     LOAD(glVertexAttribPointer);
     LOAD(glEnableVertexAttribArray);
-    LOAD(glGetAttribLocation);
+    LOAD(glVertexAttribDivisor);
+    LOAD(glDrawArraysInstanced);
+    LOAD(glGetUniformLocation);
+    LOAD(glUniform4f);
     LOAD(glGetProgramiv);
     LOAD(glGetProgramInfoLog);
 
     #undef LOAD
   }
 
-  // NOTE(leo): Create vertex buffer
+  // NOTE(leo): Create instance buffers
   {
-    GLuint vbo;
-
-    glGenBuffers(1, &vbo);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(global_vertex_buffer_data), NULL, GL_STREAM_DRAW);
+    GLuint vaos[2];
+    glGenVertexArrays(2, vaos);
+    global_opengl.static_vao = vaos[0];
+    global_opengl.ring_vao = vaos[1];
+
+    GLuint vbos[2];
+    glGenBuffers(2, vbos);
+    global_opengl.static_vbo = vbos[0];
+    global_opengl.ring_vbo = vbos[1];
+
+    global_opengl.static_vbo_size = sizeof(RectInstance)*RENDER_CMD_BUFFER_CHUNK_COUNT;
+    glBindBuffer(GL_ARRAY_BUFFER, global_opengl.static_vbo);
+    glBufferData(GL_ARRAY_BUFFER, global_opengl.static_vbo_size, NULL, GL_STREAM_DRAW);
+
+    global_opengl.ring_size = sizeof(RectInstance)*RENDER_CMD_BUFFER_CHUNK_COUNT*RECT_INSTANCE_RING_FRAME_COUNT;
+    glBindBuffer(GL_ARRAY_BUFFER, global_opengl.ring_vbo);
+    glBufferData(GL_ARRAY_BUFFER, global_opengl.ring_size, NULL, GL_STREAM_DRAW);
+
+    for(int i = 0; i < 2; i++) {
+      glBindVertexArray(vaos[i]);
+      glEnableVertexAttribArray(RECT_INSTANCE_POS_ATTRIBUTE);
+      glEnableVertexAttribArray(RECT_INSTANCE_DIM_ATTRIBUTE);
+      glEnableVertexAttribArray(RECT_INSTANCE_COLOR_ATTRIBUTE);
+      glVertexAttribDivisor(RECT_INSTANCE_POS_ATTRIBUTE, 1);
+      glVertexAttribDivisor(RECT_INSTANCE_DIM_ATTRIBUTE, 1);
+      glVertexAttribDivisor(RECT_INSTANCE_COLOR_ATTRIBUTE, 1);
+    }
   }
 
   // NOTE(leo): Create shaders
   {
+    // NOTE(leo): Triangle strip of 4 vertices per instance, corner taken from the vertex id
     const char *vertex_shader_code =
-      "#version 110\n"
-      "attribute vec2 position;"
-      "attribute vec4 color;"
+      "#version 330 core\n"
+      "uniform vec4 playing_area_transform;" // NOTE(leo): xy: offset, zw: scale
+      "layout(location = 0) in vec2 instance_pos;"
+      "layout(location = 1) in vec2 instance_dim;"
+      "layout(location = 2) in vec4 instance_color;"
+      "out vec4 color;"
       "void main()"
       "{"
-      "  gl_Position = vec4(position, 0.0, 1.0);"
-      "  gl_FrontColor = color;"
+      "  vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);"
+      "  vec2 position = (instance_pos + corner*instance_dim) / " RECT_INSTANCE_UNITS_STRING ";"
+      "  gl_Position = vec4(playing_area_transform.xy + playing_area_transform.zw*position, 0.0, 1.0);"
+      "  color = instance_color;"
       "}";
 
     GLuint vertex_shader = glCreateShader(GL_VERTEX_SHADER);
@@ -246,10 +513,12 @@ void win32_opengl_init(HDC dc)
       exit(1);
 
     const char *fragment_shader_code =
-      "#version 110\n"
+      "#version 330 core\n"
+      "in vec4 color;"
+      "out vec4 fragment_color;"
       "void main()"
       "{"
-      "  gl_FragColor = gl_Color;"
+      "  fragment_color = color;"
       "}";
 
     GLuint fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
@@ -282,19 +551,380 @@ void win32_opengl_init(HDC dc)
 
     glUseProgram(shader_program);
 
+    global_opengl.playing_area_transform_uniform = glGetUniformLocation(shader_program, "playing_area_transform");
+  }
+
+  return glrc;
+}
 
-    GLint position_attr = glGetAttribLocation(shader_program, "position");
-    glVertexAttribPointer(position_attr, FLOATS_PER_POSITION, GL_FLOAT, GL_FALSE, FLOATS_PER_VERTEX*sizeof(float), 0);
-    glEnableVertexAttribArray(position_attr);
+internal
+void win32_point_rect_instances(GLuint vao, GLuint vbo, size_t offset)
+{
+  glBindVertexArray(vao);
+  glBindBuffer(GL_ARRAY_BUFFER, vbo);
+  glVertexAttribPointer(RECT_INSTANCE_POS_ATTRIBUTE, 2, GL_SHORT, GL_FALSE, sizeof(RectInstance), (void *)(offset + offsetof(RectInstance, pos)));
+  glVertexAttribPointer(RECT_INSTANCE_DIM_ATTRIBUTE, 2, GL_UNSIGNED_SHORT, GL_FALSE, sizeof(RectInstance), (void *)(offset + offsetof(RectInstance, dim)));
+  glVertexAttribPointer(RECT_INSTANCE_COLOR_ATTRIBUTE, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(RectInstance), (void *)(offset + offsetof(RectInstance, color)));
+}
 
-    GLint color_attr = glGetAttribLocation(shader_program, "color");
-    glVertexAttribPointer(color_attr, FLOATS_PER_COLOR, GL_FLOAT, GL_FALSE, FLOATS_PER_VERTEX*sizeof(float), (const void *)(FLOATS_PER_POSITION*sizeof(float)));
-    glEnableVertexAttribArray(color_attr);
+void win32_opengl_render(RenderLayer *static_layer, RenderCmdBuffer *cmd_buffer, V2 window_client_dim)
+{
+  Win32OpenGL *gl = &global_opengl;
+  gl->upload_size = 0;
+
+  if(window_client_dim.x != gl->viewport_dim.x || window_client_dim.y != gl->viewport_dim.y) {
+    glViewport(0, 0, (GLsizei)window_client_dim.x, (GLsizei)window_client_dim.y);
+    gl->viewport_dim = window_client_dim;
+  }
+
+  glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+  glClear(GL_COLOR_BUFFER_BIT);
+
+  // NOTE(leo): Commands stay in playing area units, the shader maps them to the window
+  Win32Transform transform = win32_compute_playing_area_transform(window_client_dim);
+  glUniform4f(gl->playing_area_transform_uniform, transform.offset.x, transform.offset.y, transform.scale.x, transform.scale.y);
+
+  // NOTE(leo): Static layer. Only uploaded if it changed
+  if(static_layer->version != gl->static_version) {
+    gl->static_instance_count = static_layer->cmd_buffer.count;
+    size_t size = sizeof(RectInstance)*gl->static_instance_count;
+
+    glBindBuffer(GL_ARRAY_BUFFER, gl->static_vbo);
+    if(size > gl->static_vbo_size) {
+      size_t chunk_size = sizeof(RectInstance)*RENDER_CMD_BUFFER_CHUNK_COUNT;
+      gl->static_vbo_size = (size + chunk_size - 1)/chunk_size*chunk_size;
+      glBufferData(GL_ARRAY_BUFFER, gl->static_vbo_size, NULL, GL_STREAM_DRAW);
+    }
+    if(size) {
+      RectInstance *instances = glMapBufferRange(GL_ARRAY_BUFFER, 0, size, GL_MAP_WRITE_BIT|GL_MAP_INVALIDATE_BUFFER_BIT);
+      put_rect_instances(static_layer->cmd_buffer.commands, gl->static_instance_count, instances);
+      glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+    win32_point_rect_instances(gl->static_vao, gl->static_vbo, 0);
+
+    gl->static_version = static_layer->version;
+    gl->upload_size += size;
   }
+
+  if(gl->static_instance_count) {
+    glBindVertexArray(gl->static_vao);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, gl->static_instance_count);
+  }
+
+  // NOTE(leo): Per frame commands. Written straight into the ring buffer, unsynchronized, as the range being written was
+  // never handed to the gpu since the buffer was last orphaned
+  if(cmd_buffer->count) {
+    size_t size = sizeof(RectInstance)*cmd_buffer->count;
+
+    glBindBuffer(GL_ARRAY_BUFFER, gl->ring_vbo);
+    if(size > gl->ring_size) {
+      size_t chunk_size = sizeof(RectInstance)*RENDER_CMD_BUFFER_CHUNK_COUNT;
+      gl->ring_size = (size + chunk_size - 1)/chunk_size*chunk_size*RECT_INSTANCE_RING_FRAME_COUNT;
+      gl->ring_offset = gl->ring_size;
+    }
+    if(gl->ring_offset + size > gl->ring_size) {
+      glBufferData(GL_ARRAY_BUFFER, gl->ring_size, NULL, GL_STREAM_DRAW);
+      gl->ring_offset = 0;
+    }
+
+    RectInstance *instances = glMapBufferRange(GL_ARRAY_BUFFER, gl->ring_offset, size, GL_MAP_WRITE_BIT|GL_MAP_INVALIDATE_RANGE_BIT|GL_MAP_UNSYNCHRONIZED_BIT);
+    put_rect_instances(cmd_buffer->commands, cmd_buffer->count, instances);
+    glUnmapBuffer(GL_ARRAY_BUFFER);
+
+    win32_point_rect_instances(gl->ring_vao, gl->ring_vbo, gl->ring_offset);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, cmd_buffer->count);
+
+    gl->ring_offset += size;
+    gl->upload_size += size;
+  }
+}
+
+internal
+void win32_present_frame(Win32RenderFrame *frame, HDC dc)
+{
+  win32_opengl_render(&frame->static_layer, &frame->cmd_buffer, frame->window_client_dim);
+
+  SwapBuffers(dc);
+
+  char buffer[64];
+  wsprintfA(buffer, "%d ms, %d bytes uploaded\n", (int)(1000.0f * frame->dt), (int)global_opengl.upload_size);
+  OutputDebugStringA(buffer);
 }
 
+DWORD WINAPI win32_render_thread_proc(void *parameter)
+{
+  Win32RenderThread *render_thread = parameter;
+  wglMakeCurrent(render_thread->dc, render_thread->glrc);
+
+  for(;;) {
+    int frame_index;
+    while(!spsc_queue_pop(&render_thread->ready_frames, &frame_index)) {
+      if(render_thread->is_quitting)
+        return 0;
+      WaitForSingleObject(render_thread->ready_frames_event, INFINITE);
+    }
+
+    win32_present_frame(&global_render_frames[frame_index], render_thread->dc);
+
+    bool pushed = spsc_queue_push(&render_thread->free_frames, &frame_index);
+    assert(pushed);
+    SetEvent(render_thread->free_frames_event);
+  }
+}
+
+/*
+  Paces the main loop to a target frame time instead of running flat out.
+
+  Sleeps on a (high resolution, if available) waitable timer until shortly before the next frame is due, then spins
+  for the rest. How early it wakes up (spin_margin) follows the measured wakeup error of the timer: mean plus a few
+  deviations, so the spin tail stays as short as the timer allows.
+*/
+typedef struct Win32FrameScheduler {
+  LONGLONG timer_frequency;
+  LONGLONG target_frame_ticks; // NOTE(leo): 0: don't pace, vsync does
+  LONGLONG next_frame_time;
+
+  HANDLE timer;
+  bool is_high_resolution_timer;
+
+  // NOTE(leo): Wakeup error statistics, in seconds. Moving averages
+  F64 wakeup_error_mean;
+  F64 wakeup_error_deviation;
+  F64 wakeup_error_max;
+  F64 spin_margin;
+
+  int report_frame_count;
+} Win32FrameScheduler;
+
+#define WIN32_FRAME_SCHEDULER_MIN_SPIN_MARGIN 0.0002
+#define WIN32_FRAME_SCHEDULER_MAX_SPIN_MARGIN 0.004
+#define WIN32_IDLE_FRAME_TIME_MS 100
+
+internal
+void win32_frame_scheduler_init(Win32FrameScheduler *scheduler, int target_fps)
+{
+  LARGE_INTEGER frequency, now;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&now);
+
+  *scheduler = (Win32FrameScheduler){
+    .timer_frequency = frequency.QuadPart,
+    .target_frame_ticks = target_fps > 0 ? frequency.QuadPart/target_fps : 0,
+    .next_frame_time = now.QuadPart,
+    .spin_margin = WIN32_FRAME_SCHEDULER_MAX_SPIN_MARGIN,
+  };
+
+  scheduler->timer = CreateWaitableTimerExW(NULL, NULL, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+  scheduler->is_high_resolution_timer = scheduler->timer != NULL;
+  if(!scheduler->timer)
+    scheduler->timer = CreateWaitableTimerA(NULL, TRUE, NULL);
+  assert(scheduler->timer);
+}
+
+internal
+void win32_frame_scheduler_wait(Win32FrameScheduler *scheduler)
+{
+  if(!scheduler->target_frame_ticks)
+    return;
+
+  scheduler->next_frame_time += scheduler->target_frame_ticks;
+
+  LARGE_INTEGER now;
+  QueryPerformanceCounter(&now);
+
+  // NOTE(leo): Too late already, don't try to catch up with a burst of frames
+  if(now.QuadPart >= scheduler->next_frame_time) {
+    scheduler->next_frame_time = now.QuadPart;
+    return;
+  }
+
+  F64 remaining = (F64)(scheduler->next_frame_time - now.QuadPart)/(F64)scheduler->timer_frequency;
+  if(remaining > scheduler->spin_margin) {
+    F64 sleep_time = remaining - scheduler->spin_margin;
+    LONGLONG wake_time = now.QuadPart + (LONGLONG)(sleep_time*(F64)scheduler->timer_frequency);
+
+    LARGE_INTEGER due_time = { .QuadPart = -(LONGLONG)(sleep_time*10000000.0) }; // NOTE(leo): Relative, 100ns units
+    SetWaitableTimer(scheduler->timer, &due_time, 0, NULL, NULL, FALSE);
+    WaitForSingleObject(scheduler->timer, INFINITE);
+
+    // NOTE(leo): Track how late the timer wakes us up
+    QueryPerformanceCounter(&now);
+    F64 error = (F64)(now.QuadPart - wake_time)/(F64)scheduler->timer_frequency;
+    F64 deviation = fabs(error - scheduler->wakeup_error_mean);
+    scheduler->wakeup_error_mean += 0.05*(error - scheduler->wakeup_error_mean);
+    scheduler->wakeup_error_deviation += 0.05*(deviation - scheduler->wakeup_error_deviation);
+    if(error > scheduler->wakeup_error_max)
+      scheduler->wakeup_error_max = error;
+
+    F64 spin_margin = scheduler->wakeup_error_mean + 3.0*scheduler->wakeup_error_deviation;
+    if(spin_margin < WIN32_FRAME_SCHEDULER_MIN_SPIN_MARGIN)
+      spin_margin = WIN32_FRAME_SCHEDULER_MIN_SPIN_MARGIN;
+    if(spin_margin > WIN32_FRAME_SCHEDULER_MAX_SPIN_MARGIN)
+      spin_margin = WIN32_FRAME_SCHEDULER_MAX_SPIN_MARGIN;
+    scheduler->spin_margin = spin_margin;
+  }
+
+  // NOTE(leo): Spin for the rest
+  do {
+    YieldProcessor();
+    QueryPerformanceCounter(&now);
+  } while(now.QuadPart < scheduler->next_frame_time);
+
+  scheduler->report_frame_count++;
+  if(scheduler->report_frame_count*scheduler->target_frame_ticks >= scheduler->timer_frequency) {
+    char text[128];
+    wsprintfA(text, "Frame pacing: wakeup error mean %d us, max %d us, spin margin %d us%s\n",
+      (int)(scheduler->wakeup_error_mean*1000000.0), (int)(scheduler->wakeup_error_max*1000000.0),
+      (int)(scheduler->spin_margin*1000000.0), scheduler->is_high_resolution_timer ? "" : " (low resolution timer)");
+    OutputDebugStringA(text);
+    scheduler->report_frame_count = 0;
+    scheduler->wakeup_error_max = 0.0;
+  }
+}
+
+// NOTE(leo): Nothing to animate, so block until there is input (or a while has passed) instead of drawing frames. Wakes
+// up right away when a message arrives, so there is no hitch on refocus
+internal
+void win32_frame_scheduler_idle(Win32FrameScheduler *scheduler)
+{
+  MsgWaitForMultipleObjects(0, NULL, FALSE, WIN32_IDLE_FRAME_TIME_MS, QS_ALLINPUT);
+
+  LARGE_INTEGER now;
+  QueryPerformanceCounter(&now);
+  scheduler->next_frame_time = now.QuadPart;
+}
+
+// NOTE(leo): Value of "-name N" on the command line, or default_value
+internal
+int win32_int_argument(char *cmd_line, char *name, int default_value)
+{
+  char *argument = cmd_line ? strstr(cmd_line, name) : NULL;
+  if(!argument)
+    return default_value;
+  return atoi(argument + strlen(name));
+}
+
+// NOTE(leo): Value of "-name value" on the command line (up to the next space) copied into buffer. False if missing
+internal
+bool win32_string_argument(char *cmd_line, char *name, char *buffer, int buffer_size)
+{
+  char *argument = cmd_line ? strstr(cmd_line, name) : NULL;
+  if(!argument)
+    return false;
+  argument += strlen(name);
+  int length = 0;
+  while(argument[length] && argument[length] != ' ' && length < buffer_size - 1) {
+    buffer[length] = argument[length];
+    length++;
+  }
+  buffer[length] = 0;
+  return length > 0;
+}
+
+internal
+void win32_report_arena_usage(MemoryArena *arena, size_t *reported_high_water_mark, char *name)
+{
+  if(arena->high_water_mark > *reported_high_water_mark) {
+    *reported_high_water_mark = arena->high_water_mark;
+
+    char text[128];
+    wsprintfA(text, "%s arena high water mark: %d of %d bytes\n", name, (int)arena->high_water_mark, (int)arena->size);
+    OutputDebugStringA(text);
+  }
+}
+
+#define WIN32_RENDER_TRACE_CAPACITY 32768 // NOTE(leo): Commands, each layer. Frames with more are left out of the trace
+
+typedef struct Win32RenderTrace {
+  HANDLE file;
+  RenderTraceState encoder;
+} Win32RenderTrace;
+
+internal
+bool win32_open_render_trace(Win32RenderTrace *trace, char *path)
+{
+  HANDLE file = CreateFileA(path, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+  if(file == INVALID_HANDLE_VALUE)
+    return false;
+  size_t commands_size = sizeof(RectangleCmd)*WIN32_RENDER_TRACE_CAPACITY;
+  U8 *memory = VirtualAlloc(NULL, 2*commands_size, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+  if(!memory) {
+    CloseHandle(file);
+    return false;
+  }
+
+  RenderTraceHeader header = { .magic = RENDER_TRACE_MAGIC, .version = RENDER_TRACE_VERSION };
+  DWORD written;
+  WriteFile(file, &header, sizeof(header), &written, NULL);
+
+  trace->file = file;
+  render_trace_init(&trace->encoder, (RectangleCmd *)memory, (RectangleCmd *)(memory + commands_size), WIN32_RENDER_TRACE_CAPACITY);
+  return true;
+}
+
+// NOTE(leo): The frame is encoded into frame_arena, only as much as its commands can take
+internal
+void win32_write_render_trace(Win32RenderTrace *trace, MemoryArena *frame_arena, RenderLayer *static_layer, RenderCmdBuffer *cmd_buffer, V2 viewport, F32 dt)
+{
+  U8 *data = arena_push_size(frame_arena, render_trace_max_frame_size(static_layer->cmd_buffer.count, cmd_buffer->count), 4);
+  if(!data) {
+    OutputDebugStringA("Frame arena too small for the render trace, frame left out\n");
+    return;
+  }
+  U32 size = render_trace_encode(&trace->encoder, static_layer, cmd_buffer, viewport, dt, data);
+  if(!size) {
+    char text[128];
+    wsprintfA(text, "Frame too big for the render trace: %d commands\n", static_layer->cmd_buffer.count + cmd_buffer->count);
+    OutputDebugStringA(text);
+    return;
+  }
+  DWORD written;
+  WriteFile(trace->file, data, size, &written, NULL);
+}
+
+#define WIN32_DEFAULT_PERMANENT_MEMORY_MB 16
+#define WIN32_DEFAULT_FRAME_MEMORY_MB 16
+
 int WINAPI WinMain(HINSTANCE instance, HINSTANCE prev_instance, PSTR cmd_line, int cmd_show)
 {
+  // NOTE(leo): Game memory. Needs to exist before the window, which asks the game about the cursor right away
+  {
+    int permanent_mb = win32_int_argument(cmd_line, "-memory ", WIN32_DEFAULT_PERMANENT_MEMORY_MB);
+    int frame_mb = win32_int_argument(cmd_line, "-frame_memory ", WIN32_DEFAULT_FRAME_MEMORY_MB);
+    size_t min_permanent_size = win32_game_memory_min_size();
+    if(permanent_mb <= 0 || (size_t)permanent_mb*1024*1024 < min_permanent_size || frame_mb < 0) {
+      char text[128];
+      wsprintfA(text, "-memory needs at least %d MiB, -frame_memory can't be negative",
+        (int)((min_permanent_size + 1024*1024 - 1)/(1024*1024)));
+      MessageBoxA(NULL, text, "Error!", MB_OK|MB_ICONERROR);
+      exit(1);
+    }
+    size_t permanent_size = (size_t)permanent_mb*1024*1024;
+    size_t frame_size = (size_t)frame_mb*1024*1024;
+    U8 *memory = VirtualAlloc(NULL, permanent_size + frame_size, MEM_RESERVE|MEM_COMMIT, PAGE_READWRITE);
+    if(!memory) {
+      MessageBoxA(NULL, "Could not allocate game memory", "Error!", MB_OK|MB_ICONERROR);
+      exit(1);
+    }
+    global_game_memory.permanent_arena = arena_make(memory, permanent_size);
+    global_game_memory.frame_arena = arena_make(memory + permanent_size, frame_size);
+  }
+  // NOTE(leo): "-levels path" plays the levels of a level pack, from "-level N" on
+  {
+    char levels_path[MAX_PATH];
+    if(win32_string_argument(cmd_line, "-levels ", levels_path, sizeof(levels_path))
+      && !win32_open_level_pack(&global_game_memory, levels_path, win32_int_argument(cmd_line, "-level ", 0)))
+      OutputDebugStringA("Could not open level pack\n");
+  }
+  // NOTE(leo): "-endless N" goes on with generated levels (from seed N) after the first set instead of ending the game
+  if(cmd_line && strstr(cmd_line, "-endless") && !win32_start_level_generator(&global_game_memory, (U32)win32_int_argument(cmd_line, "-endless ", 0)))
+    OutputDebugStringA("Could not start level generator\n");
+  // NOTE(leo): "-scroll N" plays the endless scrolling brick field (from seed N) instead of sets of levels
+  if(cmd_line && strstr(cmd_line, "-scroll"))
+    win32_start_scrolling(&global_game_memory, (U32)win32_int_argument(cmd_line, "-scroll ", 0));
+  size_t reported_permanent_high_water_mark = 0;
+  size_t reported_frame_high_water_mark = 0;
+
   HWND main_window;
   {
     WNDCLASSA main_window_class = {
@@ -325,7 +955,65 @@ int WINAPI WinMain(HINSTANCE instance, HINSTANCE prev_instance, PSTR cmd_line, i
   HDC main_window_dc = GetDC(main_window);
   assert(main_window_dc);
 
-  win32_opengl_init(main_window_dc);
+  for(int frame_index = 0; frame_index < WIN32_RENDER_FRAME_COUNT; frame_index++) {
+    Win32RenderFrame *frame = &global_render_frames[frame_index];
+    frame->commands_memory = win32_reserve_buffer("Render commands", sizeof(RectangleCmd)*RENDER_CMD_BUFFER_MAX_COUNT, sizeof(RectangleCmd)*RENDER_CMD_BUFFER_CHUNK_COUNT);
+    frame->static_layer_memory = win32_reserve_buffer("Static layer commands", sizeof(RectangleCmd)*RENDER_CMD_BUFFER_MAX_COUNT, sizeof(RectangleCmd)*RENDER_CMD_BUFFER_CHUNK_COUNT);
+    frame->static_layer = (RenderLayer){
+      .cmd_buffer = win32_begin_cmd_buffer(&frame->static_layer_memory),
+      .version = 0,
+    };
+  }
+
+  // NOTE(leo): "-fps N" paces frames to N per second with the frame scheduler instead of vsync
+  int target_fps = win32_int_argument(cmd_line, "-fps ", 0);
+  Win32FrameScheduler frame_scheduler;
+  win32_frame_scheduler_init(&frame_scheduler, target_fps);
+
+  HGLRC glrc = win32_opengl_init(main_window_dc, target_fps <= 0);
+
+  // NOTE(leo): "-render_thread" overlaps building frame N+1 with drawing frame N, at the cost of one frame of latency
+  bool use_render_thread = cmd_line && strstr(cmd_line, "-render_thread") != NULL;
+  HANDLE render_thread_handle = NULL;
+  if(use_render_thread) {
+    Win32RenderThread *render_thread = &global_render_thread;
+    render_thread->dc = main_window_dc;
+    render_thread->glrc = glrc;
+    spsc_queue_init(&render_thread->free_frames, render_thread->free_frames_data, sizeof(int), WIN32_RENDER_FRAME_COUNT);
+    spsc_queue_init(&render_thread->ready_frames, render_thread->ready_frames_data, sizeof(int), WIN32_RENDER_FRAME_COUNT);
+    render_thread->free_frames_event = CreateEventA(NULL, FALSE, FALSE, NULL);
+    render_thread->ready_frames_event = CreateEventA(NULL, FALSE, FALSE, NULL);
+    for(int frame_index = 0; frame_index < WIN32_RENDER_FRAME_COUNT; frame_index++)
+      spsc_queue_push(&render_thread->free_frames, &frame_index);
+
+    // NOTE(leo): The context can only be current on one thread
+    wglMakeCurrent(NULL, NULL);
+    render_thread_handle = CreateThread(NULL, 0, win32_render_thread_proc, render_thread, 0, NULL);
+    assert(render_thread_handle);
+  }
+
+  // NOTE(leo): "-frame_ring" publishes every frame's render commands to shared memory for other processes (see
+  // frame_ring.h). The game never waits for them
+  FrameRing *frame_ring = NULL;
+  if(cmd_line && strstr(cmd_line, "-frame_ring") != NULL) {
+    HANDLE mapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, (DWORD)((U64)sizeof(FrameRing) >> 32),
+      (DWORD)sizeof(FrameRing), FRAME_RING_NAME);
+    if(mapping)
+      frame_ring = MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(FrameRing));
+    if(frame_ring)
+      frame_ring_init(frame_ring);
+    else
+      OutputDebugStringA("Could not create the frame ring\n");
+  }
+
+  // NOTE(leo): "-render_trace path" writes every frame's render commands to a file, for replaying through renderers
+  // offline (see render_trace.h)
+  Win32RenderTrace render_trace = { 0 };
+  {
+    char trace_path[MAX_PATH];
+    if(win32_string_argument(cmd_line, "-render_trace ", trace_path, sizeof(trace_path)) && !win32_open_render_trace(&render_trace, trace_path))
+      OutputDebugStringA("Could not open the render trace\n");
+  }
 
   LARGE_INTEGER last_time = { 0 };
   LARGE_INTEGER timer_frequency = { 0 };
@@ -333,13 +1021,42 @@ int WINAPI WinMain(HINSTANCE instance, HINSTANCE prev_instance, PSTR cmd_line, i
   QueryPerformanceCounter(&last_time);
   QueryPerformanceFrequency(&timer_frequency);
 
+  // NOTE(leo): Sleep(1) should actually sleep around a millisecond for the input thread
+  timeBeginPeriod(1);
+  spsc_queue_init(&global_input_thread.mouse_events, global_input_thread.mouse_events_data, sizeof(Win32MouseEvent), WIN32_MOUSE_EVENT_QUEUE_CAPACITY);
+  HANDLE input_thread_handle = CreateThread(NULL, 0, win32_input_thread_proc, &global_input_thread, 0, NULL);
+  assert(input_thread_handle);
+
+  // NOTE(leo): "-audio_wav path" records the mixed audio, otherwise it is mixed into a null sink
+  {
+    Win32AudioSink sink;
+    char wav_path[MAX_PATH];
+    if(!win32_string_argument(cmd_line, "-audio_wav ", wav_path, sizeof(wav_path)) || !win32_audio_open_wav_sink(&sink, wav_path))
+      win32_audio_null_sink(&sink);
+    if(!win32_audio_start(&global_audio, sink))
+      OutputDebugStringA("Could not start audio\n");
+  }
+
   global_running = true;
   while(global_running) {
+    // NOTE(leo): Pick the frame to fill. Waits for the render thread if it is still busy with all of them
+    int frame_index = 0;
+    if(use_render_thread) {
+      while(!spsc_queue_pop(&global_render_thread.free_frames, &frame_index))
+        WaitForSingleObject(global_render_thread.free_frames_event, INFINITE);
+    }
+    Win32RenderFrame *frame = &global_render_frames[frame_index];
+
     global_input.key_escape.was_down = global_input.key_escape.is_down;
+    global_input.key_escape.half_transition_count = 0;
     global_input.key_return.was_down = global_input.key_return.is_down;
+    global_input.key_return.half_transition_count = 0;
     global_input.key_space.was_down = global_input.key_space.is_down;
+    global_input.key_space.half_transition_count = 0;
     global_input.key_up.was_down = global_input.key_up.is_down;
+    global_input.key_up.half_transition_count = 0;
     global_input.key_down.was_down = global_input.key_down.is_down;
+    global_input.key_down.half_transition_count = 0;
 
     // NOTE(leo): Handle messages
     MSG message;
@@ -354,13 +1071,8 @@ int WINAPI WinMain(HINSTANCE instance, HINSTANCE prev_instance, PSTR cmd_line, i
     if(!global_running)
       break;
 
-    // NOTE(leo): Query mouse pos (required, as WM_MOUSEMOVE seems to be late when using SetCursorPos sometimes)
-    POINT mouse;
-    GetCursorPos(&mouse);
-    ScreenToClient(main_window, &mouse);
-    global_input.mouse = (V2){ mouse.x, mouse.y };
-
     // NOTE(leo): Calculate dt
+    LARGE_INTEGER frame_start_time = last_time;
     {
       LARGE_INTEGER now = { 0 };
       QueryPerformanceCounter(&now);
@@ -368,64 +1080,110 @@ int WINAPI WinMain(HINSTANCE instance, HINSTANCE prev_instance, PSTR cmd_line, i
       last_time = now;
     }
 
+    // NOTE(leo): Cursor movement since the last frame, timed relative to the start of this frame
+    global_input.frame_start_mouse = global_input.mouse;
+    global_input.mouse_sample_count = 0;
+    {
+      Win32MouseEvent event;
+      while(spsc_queue_pop(&global_input_thread.mouse_events, &event)) {
+        F32 time = (F32)(((F64)event.time-(F64)frame_start_time.QuadPart)/(F64)timer_frequency.QuadPart);
+        if(time < 0.0f)
+          time = 0.0f;
+        if(time > dt)
+          time = dt;
+
+        POINT client_position = event.position;
+        ScreenToClient(main_window, &client_position);
+        Win32MouseSample sample = { .time = time, .mouse = { client_position.x, client_position.y } };
+
+        // NOTE(leo): If there are more samples than fit, the last one keeps getting replaced by the newest
+        if(global_input.mouse_sample_count < WIN32_MAX_MOUSE_SAMPLE_COUNT)
+          global_input.mouse_samples[global_input.mouse_sample_count++] = sample;
+        else
+          global_input.mouse_samples[WIN32_MAX_MOUSE_SAMPLE_COUNT-1] = sample;
+      }
+
+      LONG dropped_event_count = InterlockedExchange(&global_input_thread.dropped_event_count, 0);
+      if(dropped_event_count) {
+        char text[64];
+        wsprintfA(text, "Dropped mouse events: %d\n", (int)dropped_event_count);
+        OutputDebugStringA(text);
+      }
+    }
+
+    // NOTE(leo): Query mouse pos (required, as WM_MOUSEMOVE seems to be late when using SetCursorPos sometimes). Also
+    // makes sure the frame ends up at the current position, even if the input thread hasn't seen it yet
+    POINT mouse;
+    GetCursorPos(&mouse);
+    ScreenToClient(main_window, &mouse);
+    global_input.mouse = (V2){ mouse.x, mouse.y };
+    if(global_input.mouse_sample_count < WIN32_MAX_MOUSE_SAMPLE_COUNT) {
+      bool has_moved = global_input.mouse_sample_count
+        ? global_input.mouse_samples[global_input.mouse_sample_count-1].mouse.x != global_input.mouse.x
+        : global_input.frame_start_mouse.x != global_input.mouse.x;
+      if(has_moved)
+        global_input.mouse_samples[global_input.mouse_sample_count++] = (Win32MouseSample){ .time = dt, .mouse = global_input.mouse };
+    }
+
     // NOTE(leo): Update game
-    RenderCmdBuffer cmd_buffer = {
-      .commands = &global_rectangle_commands_data[0],
-      .count = 0,
-      .capacity = RENDER_CMD_BUFFER_COUNT,
-    };
-    bool keep_running = win32_game_update(&global_game_memory, dt, &global_input, main_window, &cmd_buffer);
+    frame->cmd_buffer = win32_begin_cmd_buffer(&frame->commands_memory);
+    bool keep_running = win32_game_update(&global_game_memory, dt, &global_input, main_window, global_audio.thread ? &global_audio : NULL, &frame->static_layer, &frame->cmd_buffer);
     if(!keep_running)
       global_running = false;
+    frame->window_client_dim = global_window_client_dim;
+    frame->dt = dt;
+
+    win32_report_arena_usage(&global_game_memory.permanent_arena, &reported_permanent_high_water_mark, "Permanent");
+    win32_report_arena_usage(&global_game_memory.frame_arena, &reported_frame_high_water_mark, "Frame");
+
+    win32_track_buffer_usage(&frame->commands_memory, sizeof(RectangleCmd)*frame->cmd_buffer.count);
+    win32_track_buffer_usage(&frame->static_layer_memory, sizeof(RectangleCmd)*frame->static_layer.cmd_buffer.count);
+    if(frame->cmd_buffer.dropped_count || frame->static_layer.cmd_buffer.dropped_count) {
+      char text[128];
+      wsprintfA(text, "Dropped render commands: %d, static layer: %d\n", frame->cmd_buffer.dropped_count, frame->static_layer.cmd_buffer.dropped_count);
+      OutputDebugStringA(text);
+    }
 
-    // NOTE(leo): Draw game
-    glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-    glClear(GL_COLOR_BUFFER_BIT);
+    if(frame_ring && !frame_ring_publish(frame_ring, &frame->static_layer, &frame->cmd_buffer, frame->window_client_dim, dt)) {
+      char text[128];
+      wsprintfA(text, "Frame too big for the frame ring: %d commands\n", frame->static_layer.cmd_buffer.count + frame->cmd_buffer.count);
+      OutputDebugStringA(text);
+    }
+    if(render_trace.file)
+      win32_write_render_trace(&render_trace, &global_game_memory.frame_arena, &frame->static_layer, &frame->cmd_buffer, frame->window_client_dim, dt);
 
-    {
-      int rect_count = cmd_buffer.count;
-      float *cursor = &global_vertex_buffer_data[0];
-      for(int rect_index = 0; rect_index < rect_count; rect_index++) {
-        RectangleCmd rect_cmd = cmd_buffer.commands[rect_index];
-        Rect rect = rect_cmd.rect;
-        Color color = rect_cmd.color;
-
-        #define PUT_VERTEX(pos, color) do {\
-          *cursor++ = (pos).x; \
-          *cursor++ = (pos).y; \
-          *cursor++ = (color).r; \
-          *cursor++ = (color).g; \
-          *cursor++ = (color).b; \
-          *cursor++ = (color).a; \
-        } while(false)
-
-        V2 bottom_left = rect.pos;
-        V2 bottom_right = { rect.pos.x + rect.dim.x, rect.pos.y };
-        V2 top_left = { rect.pos.x, rect.pos.y + rect.dim.y };
-        V2 top_right = { rect.pos.x + rect.dim.x, rect.pos.y + rect.dim.y };
-
-        PUT_VERTEX(bottom_left, color);
-        PUT_VERTEX(bottom_right, color);
-        PUT_VERTEX(top_left, color);
-        PUT_VERTEX(bottom_right, color);
-        PUT_VERTEX(top_left, color);
-        PUT_VERTEX(top_right, color);
-
-        #undef PUT_VERTEX
-      }
+    // NOTE(leo): Draw game
+    if(use_render_thread) {
+      bool pushed = spsc_queue_push(&global_render_thread.ready_frames, &frame_index);
+      assert(pushed);
+      SetEvent(global_render_thread.ready_frames_event);
+    }
+    else {
+      win32_present_frame(frame, main_window_dc);
+    }
 
-      glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(float)*FLOATS_PER_RECT*rect_count, &global_vertex_buffer_data[0]);
-      glDrawArrays(GL_TRIANGLES, 0, TRIANGLES_PER_RECT*VERTICES_PER_TRIANGLE*rect_count);
+    if(!global_active || win32_game_is_idle(&global_game_memory)) {
+      win32_frame_scheduler_idle(&frame_scheduler);
+      // NOTE(leo): Time spent idle must not end up in the next dt
+      QueryPerformanceCounter(&last_time);
     }
+    else {
+      win32_frame_scheduler_wait(&frame_scheduler);
+    }
+  }
 
-    SwapBuffers(main_window_dc);
+  win32_audio_stop(&global_audio);
+  if(render_trace.file)
+    CloseHandle(render_trace.file);
 
-    if(!global_active)
-      Sleep(100);
+  global_input_thread.is_quitting = true;
+  WaitForSingleObject(input_thread_handle, INFINITE);
+  timeEndPeriod(1);
 
-    char buffer[42];
-    wsprintfA(buffer, "%d\n", (int)(1000.0f * dt));
-    OutputDebugStringA(buffer);
+  if(use_render_thread) {
+    global_render_thread.is_quitting = true;
+    SetEvent(global_render_thread.ready_frames_event);
+    WaitForSingleObject(render_thread_handle, INFINITE);
   }
 
   return 0;